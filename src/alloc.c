@@ -0,0 +1,1155 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if HAVE_DLADDR
+#include <dlfcn.h>
+#endif
+
+#include "arena.h"
+#include "hist.h"
+#include "opts.h"
+#include "out.h"
+#include "pool.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * number of blocks allocated in a single round before they are freed
+ */
+
+#define ALLOC_BATCH 1024
+
+/*
+ * size of memory that arena and pool take from system at once
+ */
+
+#define ALLOC_CHUNK (1024 * 1024)
+
+
+/* ==========================================================================
+    Executes 'expr' and records how long it took in latency histogram  of
+    operation 'op' of thread 't'
+   ========================================================================== */
+
+
+#define ALLOC_TIMED(t, op, expr)                                        \
+    do                                                                  \
+    {                                                                   \
+        ts(&(t)->start);                                                \
+        expr;                                                           \
+        ts(&(t)->finish);                                               \
+        ts_reset(&(t)->taken);                                          \
+        ts_add_diff(&(t)->taken, &(t)->start, &(t)->finish);            \
+        hist_add(&(t)->lat[op], ts2ns(&(t)->taken));                    \
+    }                                                                   \
+    while (0)
+
+
+/* ==== Private declarations ================================================ */
+
+
+struct alloc_thread;
+struct barrier;
+
+/*
+ * set of functions that implement allocator under test.  'local' is  set
+ * for allocators that are not thread safe, blocks allocated from them  are
+ * always freed by the thread that allocated them.
+ */
+
+struct alloc_ops
+{
+    const char  *name;
+    int          local;
+    void      *(*alloc)(struct alloc_thread *t, size_t size);
+    void      *(*zalloc)(struct alloc_thread *t, size_t size);
+    void      *(*resize)(struct alloc_thread *t, void *p, size_t old,
+                         size_t size);
+    void       (*release)(struct alloc_thread *t, void *p);
+    void       (*reset)(struct alloc_thread *t);
+};
+
+struct alloc_thread
+{
+    void                 *ptrs[ALLOC_BATCH];   /* blocks allocated in round */
+    size_t                lens[ALLOC_BATCH];   /* sizes of ptrs */
+    size_t                sizes[ALLOC_BATCH];  /* sizes for next batch */
+    const struct alloc_ops  *ops;              /* allocator under test */
+    struct arena          arena;               /* thread's bump allocator */
+    struct pool           pool;                /* thread's fixed size pool */
+    unsigned long         seed;                /* state of random generator */
+    unsigned long         rounds;              /* rounds to run in interval */
+    struct hist           lat[ALLOC_OP_MAX];   /* latency of each operation */
+    long                  live;                /* blocks allocated - freed */
+    struct alloc_thread  *peer;                /* thread we free blocks of */
+    struct ts             start;               /* timer for op start */
+    struct ts             finish;              /* timer for op finish */
+    struct ts             taken;               /* time taken by single op */
+#if HAVE_PTHREAD_H
+    struct barrier       *barrier;             /* syncs cross thread frees */
+    pthread_t             tid;                 /* id of the thread */
+    int                   cancel;              /* not all threads started */
+#endif
+};
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *op_names[ALLOC_OP_MAX] =
+{
+    "malloc",
+    "calloc",
+    "realloc",
+    "free"
+};
+
+static const char *dist_names[] =
+{
+    "fixed",
+    "uniform",
+    "pow2"
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    allocates 'size' bytes from system allocator (or whatever is
+    LD_PRELOADed)
+   ========================================================================== */
+
+
+static void *alloc_libc_malloc
+(
+    struct alloc_thread  *t,    /* calling thread, unused */
+    size_t                size  /* bytes to allocate */
+)
+{
+    (void)t;
+    return malloc(size);
+}
+
+
+/* ==========================================================================
+    allocates 'size' zeroed bytes from system allocator
+   ========================================================================== */
+
+
+static void *alloc_libc_calloc
+(
+    struct alloc_thread  *t,    /* calling thread, unused */
+    size_t                size  /* bytes to allocate */
+)
+{
+    (void)t;
+    return calloc(1, size);
+}
+
+
+/* ==========================================================================
+    resizes block 'p' to 'size' bytes with system allocator
+   ========================================================================== */
+
+
+static void *alloc_libc_realloc
+(
+    struct alloc_thread  *t,    /* calling thread, unused */
+    void                 *p,    /* block to resize */
+    size_t                old,  /* current size of 'p', unused */
+    size_t                size  /* new size of 'p' */
+)
+{
+    (void)t;
+    (void)old;
+    return realloc(p, size);
+}
+
+
+/* ==========================================================================
+    returns block 'p' to system allocator
+   ========================================================================== */
+
+
+static void alloc_libc_free
+(
+    struct alloc_thread  *t,    /* calling thread, unused */
+    void                 *p     /* block to free */
+)
+{
+    (void)t;
+    free(p);
+}
+
+
+/* ==========================================================================
+    does nothing, system allocator and pool have nothing to release at
+    the end of batch
+   ========================================================================== */
+
+
+static void alloc_libc_reset
+(
+    struct alloc_thread  *t     /* calling thread, unused */
+)
+{
+    (void)t;
+}
+
+
+/* ==========================================================================
+    allocates 'size' bytes from thread's arena, a bump pointer region
+    released all at once at the end of each batch
+   ========================================================================== */
+
+
+static void *alloc_arena_malloc
+(
+    struct alloc_thread  *t,    /* calling thread */
+    size_t                size  /* bytes to allocate */
+)
+{
+    return arena_alloc(&t->arena, size);
+}
+
+
+/* ==========================================================================
+    allocates 'size' zeroed bytes from thread's arena
+   ========================================================================== */
+
+
+static void *alloc_arena_calloc
+(
+    struct alloc_thread  *t,    /* calling thread */
+    size_t                size  /* bytes to allocate */
+)
+{
+    void                 *p;    /* allocated block */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if ((p = arena_alloc(&t->arena, size)) != NULL)
+    {
+        memset(p, 0, size);
+    }
+
+    return p;
+}
+
+
+/* ==========================================================================
+    resizes block 'p' of 'old' bytes to 'size' bytes in thread's arena
+   ========================================================================== */
+
+
+static void *alloc_arena_realloc
+(
+    struct alloc_thread  *t,    /* calling thread */
+    void                 *p,    /* block to resize */
+    size_t                old,  /* current size of 'p' */
+    size_t                size  /* new size of 'p' */
+)
+{
+    return arena_realloc(&t->arena, p, old, size);
+}
+
+
+/* ==========================================================================
+    does nothing, blocks of arena are released only all at once
+   ========================================================================== */
+
+
+static void alloc_arena_free
+(
+    struct alloc_thread  *t,    /* calling thread, unused */
+    void                 *p     /* block to free, unused */
+)
+{
+    (void)t;
+    (void)p;
+}
+
+
+/* ==========================================================================
+    releases all blocks of thread's arena at the end of batch
+   ========================================================================== */
+
+
+static void alloc_arena_reset
+(
+    struct alloc_thread  *t     /* calling thread */
+)
+{
+    arena_reset(&t->arena);
+}
+
+
+/* ==========================================================================
+    allocates object from thread's pool, every object is as big as the
+    biggest size distribution can return, so 'size' always fits
+   ========================================================================== */
+
+
+static void *alloc_pool_malloc
+(
+    struct alloc_thread  *t,    /* calling thread */
+    size_t                size  /* bytes to allocate, unused */
+)
+{
+    (void)size;
+    return pool_alloc(&t->pool);
+}
+
+
+/* ==========================================================================
+    allocates object from thread's pool, and zeroes its 'size' bytes
+   ========================================================================== */
+
+
+static void *alloc_pool_calloc
+(
+    struct alloc_thread  *t,    /* calling thread */
+    size_t                size  /* bytes to zero */
+)
+{
+    void                 *p;    /* allocated object */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if ((p = pool_alloc(&t->pool)) != NULL)
+    {
+        memset(p, 0, size);
+    }
+
+    return p;
+}
+
+
+/* ==========================================================================
+    resizes object 'p' of thread's pool, which never needs to be moved,
+    as every object is as big as the biggest allocation
+   ========================================================================== */
+
+
+static void *alloc_pool_realloc
+(
+    struct alloc_thread  *t,    /* calling thread */
+    void                 *p,    /* object to resize */
+    size_t                old,  /* current size of 'p', unused */
+    size_t                size  /* new size of 'p', unused */
+)
+{
+    (void)old;
+    (void)size;
+    return p ? p : pool_alloc(&t->pool);
+}
+
+
+/* ==========================================================================
+    returns object 'p' to thread's pool
+   ========================================================================== */
+
+
+static void alloc_pool_free
+(
+    struct alloc_thread  *t,  /* calling thread */
+    void                 *p   /* object to free */
+)
+{
+    pool_free(&t->pool, p);
+}
+
+
+static const struct alloc_ops allocators[] =
+{
+    {
+        "libc", 0,
+        alloc_libc_malloc, alloc_libc_calloc, alloc_libc_realloc,
+        alloc_libc_free, alloc_libc_reset
+    },
+    {
+        "arena", 1,
+        alloc_arena_malloc, alloc_arena_calloc, alloc_arena_realloc,
+        alloc_arena_free, alloc_arena_reset
+    },
+    {
+        "pool", 1,
+        alloc_pool_malloc, alloc_pool_calloc, alloc_pool_realloc,
+        alloc_pool_free, alloc_libc_reset
+    }
+};
+
+#define ALLOCATORS (sizeof(allocators) / sizeof(*allocators))
+
+
+/* ==========================================================================
+    returns number of power of two size classes, starting from 8, that fit
+    in configured block size
+   ========================================================================== */
+
+
+static unsigned alloc_pow2_classes(void)
+{
+    unsigned  n;  /* number of size classes */
+    size_t    s;  /* size of current class */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (n = 0, s = 8; s <= opts.block_size; s <<= 1, ++n);
+
+    return n;
+}
+
+
+/* ==========================================================================
+    returns random allocation size from distribution set in opts
+   ========================================================================== */
+
+
+static size_t alloc_size
+(
+    unsigned long  *seed  /* state of the random generator */
+)
+{
+    unsigned        n;    /* number of pow2 classes */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    switch (opts.dist)
+    {
+    case DIST_UNIFORM:
+        return rnd(seed) % opts.block_size + 1;
+
+    case DIST_POW2:
+        if ((n = alloc_pow2_classes()) == 0)
+        {
+            return opts.block_size;
+        }
+
+        return (size_t)8 << (rnd(seed) % n);
+
+    case DIST_FIXED:
+    default:
+        return opts.block_size;
+    }
+}
+
+
+/* ==========================================================================
+    returns average allocation size of distribution set in opts, so we can
+    tell how many rounds are needed to allocate requested number of bytes
+   ========================================================================== */
+
+
+static double alloc_mean_size(void)
+{
+    unsigned  n;     /* number of pow2 classes */
+    unsigned  i;     /* iterator for loop */
+    double    sum;   /* sum of all pow2 classes */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    switch (opts.dist)
+    {
+    case DIST_UNIFORM:
+        return (opts.block_size + 1) / 2.0;
+
+    case DIST_POW2:
+        if ((n = alloc_pow2_classes()) == 0)
+        {
+            return opts.block_size;
+        }
+
+        for (i = 0, sum = 0; i != n; ++i)
+        {
+            sum += (double)((size_t)8 << i);
+        }
+
+        return sum / n;
+
+    case DIST_FIXED:
+    default:
+        return opts.block_size;
+    }
+}
+
+
+/* ==========================================================================
+    fills sizes of next batch, this is done before timed region so random
+    generator does not add to allocator latency
+   ========================================================================== */
+
+
+static void alloc_sizes
+(
+    struct alloc_thread  *t  /* thread to generate sizes for */
+)
+{
+    size_t                k; /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (k = 0; k != ALLOC_BATCH; ++k)
+    {
+        t->sizes[k] = alloc_size(&t->seed);
+    }
+}
+
+
+/* ==========================================================================
+    waits until all threads reach this point.  No-op when running  in  one
+    thread only
+   ========================================================================== */
+
+
+static void alloc_sync
+(
+    struct alloc_thread  *t  /* calling thread */
+)
+{
+#if HAVE_PTHREAD_H
+    if (t->barrier)
+    {
+        barrier_wait(t->barrier);
+    }
+#else
+    (void)t;
+#endif
+}
+
+
+/* ==========================================================================
+    allocation workload of a single thread.  Each round thread allocates a
+    batch of blocks, reallocates them to new sizes, and then frees  blocks
+    allocated by its peer thread.  Same is repeated for calloc.  When  only
+    one thread is running, or allocator is thread local, thread frees  its
+    own blocks.
+   ========================================================================== */
+
+
+static void *alloc_worker
+(
+    void                    *arg   /* struct alloc_thread of this thread */
+)
+{
+    struct alloc_thread     *t;    /* this thread */
+    struct alloc_thread     *peer; /* thread whose blocks we free */
+    const struct alloc_ops  *ops;  /* allocator under test */
+    unsigned long            r;    /* current round */
+    size_t                   k;    /* iterator for loop */
+    void                    *p;    /* pointer returned by realloc */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    t = arg;
+    ops = t->ops;
+    peer = ops->local ? t : t->peer;
+
+    /*
+     * threads start together, and not at all when some of them couldn't
+     * be created, as we free blocks of our peer
+     */
+
+    alloc_sync(t);
+
+#if HAVE_PTHREAD_H
+    if (t->cancel)
+    {
+        return NULL;
+    }
+#endif
+
+    for (r = 0; r != t->rounds; ++r)
+    {
+        alloc_sizes(t);
+
+        for (k = 0; k != ALLOC_BATCH; ++k)
+        {
+            ALLOC_TIMED(t, ALLOC_MALLOC,
+                t->ptrs[k] = ops->alloc(t, t->sizes[k]));
+            t->lens[k] = t->sizes[k];
+            t->live += t->ptrs[k] != NULL;
+        }
+
+        alloc_sizes(t);
+
+        for (k = 0; k != ALLOC_BATCH; ++k)
+        {
+            ALLOC_TIMED(t, ALLOC_REALLOC,
+                p = ops->resize(t, t->ptrs[k], t->lens[k], t->sizes[k]));
+
+            if (p)
+            {
+                t->ptrs[k] = p;
+                t->lens[k] = t->sizes[k];
+            }
+        }
+
+        alloc_sync(t);
+
+        for (k = 0; k != ALLOC_BATCH; ++k)
+        {
+            ALLOC_TIMED(t, ALLOC_FREE, ops->release(peer, peer->ptrs[k]));
+            t->live -= peer->ptrs[k] != NULL;
+        }
+
+        ops->reset(t);
+
+        /*
+         * peer may still be freeing our blocks, we cannot overwrite  our
+         * pointers with new allocations until it is done
+         */
+
+        alloc_sync(t);
+        alloc_sizes(t);
+
+        for (k = 0; k != ALLOC_BATCH; ++k)
+        {
+            ALLOC_TIMED(t, ALLOC_CALLOC,
+                t->ptrs[k] = ops->zalloc(t, t->sizes[k]));
+            t->live += t->ptrs[k] != NULL;
+        }
+
+        alloc_sync(t);
+
+        for (k = 0; k != ALLOC_BATCH; ++k)
+        {
+            ALLOC_TIMED(t, ALLOC_FREE, ops->release(peer, peer->ptrs[k]));
+            t->live -= peer->ptrs[k] != NULL;
+        }
+
+        ops->reset(t);
+        alloc_sync(t);
+    }
+
+    return NULL;
+}
+
+
+/* ==========================================================================
+    prints name of the library that provides malloc(), so it is clear which
+    allocator is measured when memperf is run with LD_PRELOAD
+   ========================================================================== */
+
+
+static void alloc_print_allocator(void)
+{
+#if HAVE_DLADDR
+    Dl_info  info;  /* information about object that holds malloc */
+    void    *sym;   /* address of malloc that will be really called */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if ((sym = dlsym(RTLD_DEFAULT, "malloc")) != NULL &&
+        dladdr(sym, &info) != 0 && info.dli_fname != NULL)
+    {
+        printf("allocator: %s\n", info.dli_fname);
+        return;
+    }
+#endif
+
+    printf("allocator: unknown\n");
+}
+
+
+/* ==========================================================================
+    prints report for one allocator, 'lat' are latencies merged  from  all
+    threads.  'base' are latencies of libc, rate of other allocators is also
+    shown relative to it, so it is visible how much faster region based
+    allocation is.
+   ========================================================================== */
+
+
+static void alloc_report
+(
+    unsigned long            intvl, /* interval number, counted from 1 */
+    const struct alloc_ops  *ops,   /* allocator that was tested */
+    const struct hist       *lat,   /* latencies of all operations */
+    const struct hist       *base   /* latencies of libc allocator */
+)
+{
+    int                      op;    /* current operation */
+    double                   rate;  /* operations per second */
+    double                   brate; /* operations per second of libc */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (op = 0; op != ALLOC_OP_MAX; ++op)
+    {
+        rate = alloc_rate(&lat[op]);
+        brate = alloc_rate(&base[op]);
+
+        if (!out_text())
+        {
+            out_record("interval");
+            out_ulong("interval", intvl);
+            out_str("name", ops->name);
+            out_str("op", op_names[op]);
+            out_ulong("ops", lat[op].n);
+            out_double("rate_ops", rate);
+            out_ulong("p50_ns", hist_pct(&lat[op], 50));
+            out_ulong("p99_ns", hist_pct(&lat[op], 99));
+            out_ulong("p999_ns", hist_pct(&lat[op], 99.9));
+            out_ulong("max_ns", hist_pct(&lat[op], 100));
+            out_record_end();
+            continue;
+        }
+
+        printf("%-5s %-7s ops %8lu, rate %9lu ops/s, p50 %5lu ns, "
+               "p99 %6lu ns, p99.9 %6lu ns, max %7lu ns",
+               ops->name,
+               op_names[op],
+               lat[op].n,
+               (unsigned long)rate,
+               hist_pct(&lat[op], 50),
+               hist_pct(&lat[op], 99),
+               hist_pct(&lat[op], 99.9),
+               hist_pct(&lat[op], 100));
+
+        if (lat != base && brate > 0)
+        {
+            printf(", %6.2fx libc", rate / brate);
+        }
+
+        printf("\n");
+    }
+}
+
+
+/* ==========================================================================
+    runs one interval of workload with allocator 'ops' on all threads  and
+    merges their latencies into 'lat'
+
+    returns:
+             0      interval finished
+            -1      couldn't create threads
+   ========================================================================== */
+
+
+static int alloc_run
+(
+    struct alloc_thread     *threads,  /* per thread state */
+    const struct alloc_ops  *ops,      /* allocator to test */
+    struct hist             *lat       /* merged latencies will go here */
+)
+{
+    unsigned long            n;        /* iterator for loop */
+    unsigned long            k;        /* iterator for loop */
+    int                      op;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (n = 0; n != opts.threads; ++n)
+    {
+        threads[n].ops = ops;
+        threads[n].live = 0;
+#if HAVE_PTHREAD_H
+        threads[n].cancel = 0;
+#endif
+
+        for (op = 0; op != ALLOC_OP_MAX; ++op)
+        {
+            hist_reset(&threads[n].lat[op]);
+        }
+    }
+
+#if HAVE_PTHREAD_H
+    if (opts.threads > 1)
+    {
+        for (n = 0; n != opts.threads; ++n)
+        {
+            if (pthread_create(&threads[n].tid, NULL, alloc_worker,
+                               &threads[n]) != 0)
+            {
+                /*
+                 * threads that were already started wait for the rest on
+                 * barrier, release them with cancel flag set, so they quit
+                 * without touching blocks of threads that are not there
+                 */
+
+                fprintf(stderr, "Couldn't create thread\n");
+
+                for (k = 0; k != n; ++k)
+                {
+                    threads[k].cancel = 1;
+                }
+
+                barrier_resize(threads[0].barrier, n);
+
+                for (k = 0; k != n; ++k)
+                {
+                    pthread_join(threads[k].tid, NULL);
+                }
+
+                barrier_resize(threads[0].barrier, opts.threads);
+                return -1;
+            }
+        }
+
+        for (n = 0; n != opts.threads; ++n)
+        {
+            pthread_join(threads[n].tid, NULL);
+        }
+    }
+    else
+#endif
+    {
+        alloc_worker(&threads[0]);
+    }
+
+    for (op = 0; op != ALLOC_OP_MAX; ++op)
+    {
+        hist_reset(&lat[op]);
+
+        for (n = 0; n != opts.threads; ++n)
+        {
+            hist_merge(&lat[op], &threads[n].lat[op]);
+        }
+    }
+
+    return 0;
+}
+
+
+/* ==========================================================================
+    prepares 'threads' to run 'rounds' rounds each interval, freeing blocks
+    of the next thread, and synchronized on 'barrier' when there is more
+    than one of them
+   ========================================================================== */
+
+
+static void alloc_setup
+(
+    struct alloc_thread  *threads,  /* per thread state */
+    struct barrier       *barrier,  /* syncs cross thread frees */
+    unsigned long         rounds    /* rounds each thread runs */
+)
+{
+    unsigned long         n;        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (n = 0; n != opts.threads; ++n)
+    {
+        threads[n].seed = (time(NULL) ^ (n + 1) * 2654435761ul) | 1;
+        threads[n].rounds = rounds;
+        threads[n].peer = &threads[(n + 1) % opts.threads];
+        arena_init(&threads[n].arena, ALLOC_CHUNK);
+        pool_init(&threads[n].pool, opts.block_size, ALLOC_CHUNK);
+
+#if HAVE_PTHREAD_H
+        threads[n].barrier = opts.threads > 1 ? barrier : NULL;
+#else
+        (void)barrier;
+#endif
+    }
+}
+
+
+/* ==========================================================================
+    releases memory that arenas and pools of 'threads' took from system
+   ========================================================================== */
+
+
+static void alloc_teardown
+(
+    struct alloc_thread  *threads  /* per thread state */
+)
+{
+    unsigned long         n;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (n = 0; threads && n != opts.threads; ++n)
+    {
+        arena_destroy(&threads[n].arena);
+        pool_destroy(&threads[n].pool);
+    }
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    returns rate of operation recorded in 'lat' in operations per second.
+    Rate is computed from time spent inside allocator calls only and assumes
+    threads were running in parallel
+   ========================================================================== */
+
+
+double alloc_rate
+(
+    const struct hist  *lat  /* latencies of operation */
+)
+{
+    if (lat->sum <= 0)
+    {
+        return 0;
+    }
+
+    return lat->n / (lat->sum / opts.threads) * 1000000000.0;
+}
+
+
+/* ==========================================================================
+    runs 'rounds' rounds of workload with allocator 'name' on opts.threads
+    threads, with fresh arenas and pools.  Latencies of each operation are
+    merged into 'lat', and 'live' is set to number of blocks that were
+    allocated, but not handed back to allocator.
+
+    returns:
+             0      interval finished
+            -1      unknown allocator, or couldn't allocate memory or
+                    create threads
+   ========================================================================== */
+
+
+int alloc_interval
+(
+    const char           *name,     /* name of allocator to run */
+    unsigned long         rounds,   /* rounds each thread runs */
+    struct hist          *lat,      /* merged latencies will go here */
+    long                 *live      /* blocks that were not freed */
+)
+{
+    struct alloc_thread  *threads;  /* per thread state */
+    unsigned long         n;        /* iterator for loop */
+    size_t                a;        /* iterator for loop */
+    int                   rc;       /* return code */
+#if HAVE_PTHREAD_H
+    struct barrier        barrier;  /* syncs cross thread frees */
+#endif
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (a = 0; a != ALLOCATORS; ++a)
+    {
+        if (strcmp(allocators[a].name, name) == 0)
+        {
+            break;
+        }
+    }
+
+    if (a == ALLOCATORS)
+    {
+        return -1;
+    }
+
+#if HAVE_PTHREAD_H
+    if (opts.threads > 1 && barrier_init(&barrier, opts.threads) != 0)
+    {
+        return -1;
+    }
+#else
+    if (opts.threads > 1)
+    {
+        return -1;
+    }
+#endif
+
+    rc = -1;
+
+    if ((threads = calloc(opts.threads, sizeof(*threads))) == NULL)
+    {
+        goto error;
+    }
+
+#if HAVE_PTHREAD_H
+    alloc_setup(threads, &barrier, rounds);
+#else
+    alloc_setup(threads, NULL, rounds);
+#endif
+
+    if (alloc_run(threads, &allocators[a], lat) != 0)
+    {
+        goto error;
+    }
+
+    for (n = 0, *live = 0; n != opts.threads; ++n)
+    {
+        *live += threads[n].live;
+    }
+
+    rc = 0;
+
+error:
+    alloc_teardown(threads);
+
+#if HAVE_PTHREAD_H
+    if (opts.threads > 1)
+    {
+        barrier_destroy(&barrier);
+    }
+#endif
+
+    free(threads);
+    return rc;
+}
+
+
+/* ==========================================================================
+    measures throughput and latency of malloc, calloc, realloc  and  free.
+    Every interval allocates about  opts.report_intvl  bytes  with  sizes
+    taken from opts.dist distribution.  When more than one thread is  used,
+    blocks are freed by different thread than the one that allocated them.
+    Same workload is then run on built in arena and  pool  allocators,  to
+    show how much faster region based allocation could be.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory or create threads
+   ========================================================================== */
+
+
+int alloc_bench(void)
+{
+    struct alloc_thread  *threads;       /* per thread state */
+    struct hist          *lat;           /* latencies merged from threads */
+    struct stats          rate[ALLOCATORS * ALLOC_OP_MAX]; /* ops/s */
+    char                  name[32];      /* name of configuration */
+    unsigned long         rounds;        /* rounds each thread runs */
+    unsigned long         i;             /* iterator for loop */
+    size_t                a;             /* iterator for loop */
+    int                   op;            /* iterator for loop */
+    int                   rc;            /* return code */
+    struct jedec          jd_block_size; /* block size in jedec format */
+    struct jedec          jd_intvl;      /* report interval in jedec format */
+#if HAVE_PTHREAD_H
+    struct barrier        barrier;       /* syncs cross thread frees */
+#endif
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+#if HAVE_PTHREAD_H
+    if (opts.threads > 1 && barrier_init(&barrier, opts.threads) != 0)
+    {
+        fprintf(stderr, "Couldn't initialize thread barrier\n");
+        return -1;
+    }
+#else
+    if (opts.threads > 1)
+    {
+        fprintf(stderr, "Threads are not supported on this system\n");
+        return -1;
+    }
+#endif
+
+    rc = -1;
+
+    for (a = 0; a != ALLOCATORS * ALLOC_OP_MAX; ++a)
+    {
+        stats_init(&rate[a]);
+    }
+
+    lat = malloc(ALLOCATORS * ALLOC_OP_MAX * sizeof(*lat));
+    threads = calloc(opts.threads, sizeof(*threads));
+
+    if (lat == NULL || threads == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+        goto error;
+    }
+
+    rounds = opts.report_intvl /
+        (alloc_mean_size() * ALLOC_BATCH * opts.threads);
+    rounds = rounds ? rounds : 1;
+
+#if HAVE_PTHREAD_H
+    alloc_setup(threads, &barrier, rounds);
+#else
+    alloc_setup(threads, NULL, rounds);
+#endif
+
+    bytes2jedec(opts.block_size, &jd_block_size);
+    bytes2jedec(opts.report_intvl, &jd_intvl);
+
+    if (out_text())
+    {
+        alloc_print_allocator();
+        printf("distribution: %s, max size %lu %cB, report every %lu %cB, "
+               "threads %lu, iterations %lu\n",
+               dist_names[opts.dist],
+               jd_block_size.val,
+               jd_block_size.pre,
+               jd_intvl.val,
+               jd_intvl.pre,
+               opts.threads,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(rate, ALLOCATORS * ALLOC_OP_MAX, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (a = 0; a != ALLOCATORS; ++a)
+        {
+            if (alloc_run(threads, &allocators[a], &lat[a * ALLOC_OP_MAX]) != 0)
+            {
+                goto error;
+            }
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            alloc_report(i - opts.warmup + 1, &allocators[a],
+                         &lat[a * ALLOC_OP_MAX], lat);
+
+            for (op = 0; op != ALLOC_OP_MAX; ++op)
+            {
+                if (stats_add(&rate[a * ALLOC_OP_MAX + op],
+                              alloc_rate(&lat[a * ALLOC_OP_MAX + op])) != 0)
+                {
+                    fprintf(stderr, "Couldn't allocate memory for samples\n");
+                    goto error;
+                }
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of operation rate\n");
+    }
+
+    for (a = 0; a != ALLOCATORS; ++a)
+    {
+        for (op = 0; op != ALLOC_OP_MAX; ++op)
+        {
+            sprintf(name, "%s %s", allocators[a].name, op_names[op]);
+            stats_compute(&rate[a * ALLOC_OP_MAX + op], opts.outlier_mad);
+            stats_print(&rate[a * ALLOC_OP_MAX + op], name, "ops/s");
+        }
+    }
+
+    rc = 0;
+
+error:
+    alloc_teardown(threads);
+
+#if HAVE_PTHREAD_H
+    if (opts.threads > 1)
+    {
+        barrier_destroy(&barrier);
+    }
+#endif
+
+    for (a = 0; a != ALLOCATORS * ALLOC_OP_MAX; ++a)
+    {
+        stats_destroy(&rate[a]);
+    }
+
+    free(threads);
+    free(lat);
+    return rc;
+}
@@ -0,0 +1,26 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef ALLOC_H
+#define ALLOC_H 1
+
+#include "hist.h"
+
+enum alloc_op
+{
+    ALLOC_MALLOC,
+    ALLOC_CALLOC,
+    ALLOC_REALLOC,
+    ALLOC_FREE,
+    ALLOC_OP_MAX
+};
+
+double alloc_rate(const struct hist *lat);
+int alloc_interval(const char *name, unsigned long rounds, struct hist *lat,
+    long *live);
+int alloc_bench(void);
+
+#endif
@@ -0,0 +1,234 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* ==== Private macros ====================================================== */
+
+
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/*
+ * chunk header is padded, so data that follows it is aligned too
+ */
+
+#define CHUNK_HDR ALIGN_UP(sizeof(struct arena_chunk))
+#define CHUNK_DATA(c) ((unsigned char *)(c) + CHUNK_HDR)
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    allocates new chunk that can hold at least 'size' bytes and links it at
+    the end of chunk list
+   ========================================================================== */
+
+
+static struct arena_chunk *arena_grow
+(
+    struct arena        *a,     /* arena to grow */
+    size_t               size   /* bytes that new chunk must hold */
+)
+{
+    struct arena_chunk  *c;     /* new chunk */
+    struct arena_chunk  *tail;  /* last chunk on the list */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    size = size > a->chunk_size ? size : a->chunk_size;
+
+    if ((c = malloc(CHUNK_HDR + size)) == NULL)
+    {
+        return NULL;
+    }
+
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+
+    if (a->head == NULL)
+    {
+        a->head = c;
+        return c;
+    }
+
+    for (tail = a->head; tail->next; tail = tail->next);
+    tail->next = c;
+
+    return c;
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    initializes bump pointer arena.  Memory is taken from system in chunks
+    of 'chunk_size' bytes, and is kept until arena_destroy() is called
+   ========================================================================== */
+
+
+void arena_init
+(
+    struct arena  *a,          /* arena to initialize */
+    size_t         chunk_size  /* size of memory chunk taken from system */
+)
+{
+    a->head = NULL;
+    a->curr = NULL;
+    a->last = NULL;
+    a->chunk_size = chunk_size;
+}
+
+
+/* ==========================================================================
+    returns 'size' bytes of memory aligned to ARENA_ALIGN.   Memory  cannot
+    be freed on its own, it is released all at once with arena_reset().
+
+    returns:
+            pointer to allocated memory, or NULL when system is out of memory
+   ========================================================================== */
+
+
+void *arena_alloc
+(
+    struct arena        *a,     /* arena to allocate from */
+    size_t               size   /* bytes to allocate */
+)
+{
+    struct arena_chunk  *c;     /* chunk to allocate from */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    size = ALIGN_UP(size);
+
+    /*
+     * chunks are never freed on reset, so look for next one  that  fits
+     * before asking system for more memory
+     */
+
+    for (c = a->curr; c; c = c->next)
+    {
+        if (c->size - c->used >= size)
+        {
+            break;
+        }
+    }
+
+    if (c == NULL && (c = arena_grow(a, size)) == NULL)
+    {
+        return NULL;
+    }
+
+    a->curr = c;
+    a->last = CHUNK_DATA(c) + c->used;
+    c->used += size;
+
+    return a->last;
+}
+
+
+/* ==========================================================================
+    changes size of memory 'p' from 'old' to 'size' bytes.  If 'p' is  the
+    last allocation made in arena and there is room in chunk, memory  grows
+    in place, otherwise new memory is allocated and old content is  copied.
+    Old memory is not reclaimed until arena_reset().
+
+    returns:
+            pointer to resized memory, or NULL when system is out of memory
+   ========================================================================== */
+
+
+void *arena_realloc
+(
+    struct arena  *a,     /* arena that 'p' was allocated from */
+    void          *p,     /* memory to resize */
+    size_t         old,   /* current size of 'p' */
+    size_t         size   /* requested size of 'p' */
+)
+{
+    void          *np;    /* new memory */
+    size_t         used;  /* bytes used in chunk without 'p' */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (p == NULL)
+    {
+        return arena_alloc(a, size);
+    }
+
+    if (p == a->last)
+    {
+        used = (unsigned char *)p - CHUNK_DATA(a->curr);
+
+        if (a->curr->size - used >= ALIGN_UP(size))
+        {
+            a->curr->used = used + ALIGN_UP(size);
+            return p;
+        }
+    }
+
+    if ((np = arena_alloc(a, size)) == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(np, p, old < size ? old : size);
+    return np;
+}
+
+
+/* ==========================================================================
+    releases all memory allocated from arena at once.  Chunks are kept, so
+    next allocations are served without calling system allocator
+   ========================================================================== */
+
+
+void arena_reset
+(
+    struct arena        *a  /* arena to reset */
+)
+{
+    struct arena_chunk  *c; /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = a->head; c; c = c->next)
+    {
+        c->used = 0;
+    }
+
+    a->curr = a->head;
+    a->last = NULL;
+}
+
+
+/* ==========================================================================
+    returns all chunks of arena back to system
+   ========================================================================== */
+
+
+void arena_destroy
+(
+    struct arena        *a     /* arena to destroy */
+)
+{
+    struct arena_chunk  *c;    /* chunk being freed */
+    struct arena_chunk  *next; /* next chunk to free */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = a->head; c; c = next)
+    {
+        next = c->next;
+        free(c);
+    }
+
+    arena_init(a, a->chunk_size);
+}
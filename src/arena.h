@@ -0,0 +1,35 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef ARENA_H
+#define ARENA_H 1
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 16
+
+struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+};
+
+struct arena
+{
+    struct arena_chunk *head;
+    struct arena_chunk *curr;
+    size_t chunk_size;
+    void *last;
+};
+
+void arena_init(struct arena *a, size_t chunk_size);
+void *arena_alloc(struct arena *a, size_t size);
+void *arena_realloc(struct arena *a, void *p, size_t old, size_t size);
+void arena_reset(struct arena *a);
+void arena_destroy(struct arena *a);
+
+#endif
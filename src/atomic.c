@@ -0,0 +1,550 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "atomic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+
+
+/* ==== Private macros ====================================================== */
+
+
+/* ==========================================================================
+    runs 'expr' on operand 'p' t->ops times.  Specialized loop is generated
+    for each operation, so there is no branch between them.
+   ========================================================================== */
+
+
+#define ATOMIC_LOOP(expr)                                               \
+    for (i = 0; i != t->ops; ++i)                                       \
+    {                                                                   \
+        expr;                                                           \
+    }
+
+
+/* ==== Private declarations ================================================ */
+
+
+enum atomic_op
+{
+    OP_FETCH_ADD,
+    OP_CAS,
+    OP_XCHG,
+    OP_LOAD,
+    OP_STORE,
+    OP_MAX
+};
+
+struct atomic_thread
+{
+    volatile unsigned long  *p;        /* operand of the thread */
+    enum atomic_op           op;       /* operation to run */
+    unsigned long            ops;      /* number of operations to run */
+    unsigned long            v;        /* last value, keeps loads alive */
+    unsigned long            fails;    /* failed compare and swaps */
+    struct ts                taken;    /* time taken by all operations */
+    struct barrier          *barrier;  /* starts all threads at once */
+    int                      cancel;   /* not all threads started */
+    pthread_t                tid;      /* id of the thread */
+};
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *op_names[OP_MAX] =
+{
+    "fetch_add",
+    "cas",
+    "xchg",
+    "load",
+    "store"
+};
+
+static const char *place_names[ATOMIC_PLACES] =
+{
+    "shared",
+    "spread"
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    returns number of operations each thread runs, one per 64 bytes  of
+    report interval, so it scales with -r like other tests
+   ========================================================================== */
+
+
+static unsigned long atomic_ops(void)
+{
+    unsigned long  ops;  /* operations per thread */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    ops = (unsigned long)(opts.report_intvl / 64);
+    return ops ? ops : 1;
+}
+
+
+/* ==========================================================================
+    runs t->ops operations t->op on t->p, after all threads are  ready.
+    Load and store are sequentially consistent ones.  Without __atomic
+    builtins, store is plain store followed by full fence, and load is
+    plain load, which is what seq-cst load is on x86, but not on  weaker
+    architectures.  Compare and swap that lost race with another  thread
+    is counted in t->fails.
+   ========================================================================== */
+
+
+static void *atomic_worker
+(
+    void                  *arg     /* struct atomic_thread of this thread */
+)
+{
+    struct atomic_thread  *t;      /* this thread */
+    volatile unsigned long *p;     /* operand */
+    unsigned long          v;      /* value read from operand */
+    unsigned long          fails;  /* failed compare and swaps */
+    unsigned long          i;      /* iterator for loop */
+    struct ts              start;  /* timer indicating start of ops */
+    struct ts              finish; /* timer indicating end of ops */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    t = arg;
+    p = t->p;
+    v = 0;
+    fails = 0;
+
+    if (t->barrier)
+    {
+        barrier_wait(t->barrier);
+    }
+
+    if (t->cancel)
+    {
+        return NULL;
+    }
+
+    ts(&start);
+
+    switch (t->op)
+    {
+    case OP_FETCH_ADD:
+        ATOMIC_LOOP(v += __sync_fetch_and_add(p, 1));
+        break;
+
+    case OP_CAS:
+        ATOMIC_LOOP(v = *p;
+                    fails += !__sync_bool_compare_and_swap(p, v, v + 1));
+        break;
+
+    case OP_XCHG:
+        ATOMIC_LOOP(v += __sync_lock_test_and_set(p, i));
+        break;
+
+#if HAVE_ATOMIC_BUILTINS
+    case OP_LOAD:
+        ATOMIC_LOOP(v += __atomic_load_n(p, __ATOMIC_SEQ_CST));
+        break;
+
+    case OP_STORE:
+        ATOMIC_LOOP(__atomic_store_n(p, i, __ATOMIC_SEQ_CST));
+        break;
+#else
+    case OP_LOAD:
+        ATOMIC_LOOP(v += *p);
+        break;
+
+    case OP_STORE:
+        ATOMIC_LOOP(*p = i; __sync_synchronize());
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    ts(&finish);
+    ts_reset(&t->taken);
+    ts_add_diff(&t->taken, &start, &finish);
+    t->v = v;
+    t->fails = fails;
+
+    return NULL;
+}
+
+
+/* ==========================================================================
+    runs operation 'op' on 'n' threads, with operands placed as 'place'
+    in 'mem', and computes aggregate rate and mean latency of operation.
+    Only successful operations count in 'rate', while 'ns' is time of an
+    attempt, and 'fail' is fraction of attempts that failed.
+
+    returns:
+             0      operations done, 'rate', 'ns' and 'fail' are set
+            -1      couldn't start threads
+   ========================================================================== */
+
+
+static int atomic_run
+(
+    struct atomic_thread  *threads,  /* per thread state */
+    unsigned long          n,        /* number of threads */
+    enum atomic_op         op,       /* operation to run */
+    enum atomic_place      place,    /* where operands are */
+    unsigned char         *mem,      /* memory for operands */
+    double                *rate,     /* all threads ops/s */
+    double                *ns,       /* mean time of single op in ns */
+    double                *fail      /* fraction of failed ops */
+)
+{
+    struct barrier         barrier;  /* starts threads together */
+    unsigned long          ops;      /* operations per thread */
+    unsigned long          fails;    /* failed ops of all threads */
+    unsigned long          i;        /* iterator for loop */
+    unsigned long          k;        /* iterator for loop */
+    double                 sec;      /* time of slowest thread */
+    double                 sum;      /* sum of times of all threads */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    ops = atomic_ops();
+
+    if (n > 1 && barrier_init(&barrier, n) != 0)
+    {
+        fprintf(stderr, "Couldn't initialize thread barrier\n");
+        return -1;
+    }
+
+    for (i = 0; i != n; ++i)
+    {
+        threads[i].p = (volatile unsigned long *)
+            atomic_operand(mem, place == ATOMIC_PLACE_SPREAD, i);
+        threads[i].op = op;
+        threads[i].ops = ops;
+        threads[i].barrier = n > 1 ? &barrier : NULL;
+        threads[i].cancel = 0;
+    }
+
+    if (n == 1)
+    {
+        atomic_worker(&threads[0]);
+    }
+    else
+    {
+        for (i = 0; i != n; ++i)
+        {
+            if (pthread_create(&threads[i].tid, NULL, atomic_worker,
+                               &threads[i]) != 0)
+            {
+                /*
+                 * threads that were already started wait for the rest on
+                 * barrier, release them with cancel flag set, so they quit
+                 * without touching operands
+                 */
+
+                fprintf(stderr, "Couldn't create thread\n");
+
+                for (k = 0; k != i; ++k)
+                {
+                    threads[k].cancel = 1;
+                }
+
+                barrier_resize(&barrier, i);
+
+                for (k = 0; k != i; ++k)
+                {
+                    pthread_join(threads[k].tid, NULL);
+                }
+
+                barrier_destroy(&barrier);
+                return -1;
+            }
+        }
+
+        for (i = 0; i != n; ++i)
+        {
+            pthread_join(threads[i].tid, NULL);
+        }
+
+        barrier_destroy(&barrier);
+    }
+
+    /*
+     * threads run in parallel, so total time is time of the slowest one
+     */
+
+    for (i = 0, sec = 0, sum = 0, fails = 0; i != n; ++i)
+    {
+        fails += threads[i].fails;
+        sum += ts2sec(&threads[i].taken);
+        sec = ts2sec(&threads[i].taken) > sec ?
+            ts2sec(&threads[i].taken) : sec;
+    }
+
+    sec = sec > 0 ? sec : 1e-9;
+    *rate = ((double)n * ops - fails) / sec;
+    *ns = sum / n / ops * 1000000000.0;
+    *fail = fails / ((double)n * ops);
+    return 0;
+}
+
+
+/* ==========================================================================
+    prints rate and latency of operation 'op' run on 'n' threads  with
+    operands placed as 'place', and how many attempts failed, for compare
+    and swap
+   ========================================================================== */
+
+
+static void atomic_report
+(
+    unsigned long       intvl,  /* interval number, counted from 1 */
+    enum atomic_op      op,     /* operation that was run */
+    enum atomic_place   place,  /* where operands were */
+    unsigned long       n,      /* number of threads */
+    double              rate,   /* all threads ops/s */
+    double              ns,     /* mean time of single op in ns */
+    double              fail    /* fraction of failed ops */
+)
+{
+    if (!out_text())
+    {
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("op", op_names[op]);
+        out_str("place", place_names[place]);
+        out_ulong("nthreads", n);
+        out_double("rate_ops", rate);
+        out_double("ns_per_op", ns);
+        out_double("fail_ratio", fail);
+        out_record_end();
+        return;
+    }
+
+    printf("%-9s %-6s threads %4lu, rate %11lu ops/s, %8.2f ns/op",
+           op_names[op],
+           place_names[place],
+           n,
+           (unsigned long)rate,
+           ns);
+
+    if (op == OP_CAS)
+    {
+        printf(", failed %5.1f%%", fail * 100);
+    }
+
+    printf("\n");
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    decodes configuration 'c' into operation 'op', placement 'place' and
+    index 'k' of thread count.  Every operation runs alone first, where
+    shared and spread operands are the same thing, and then on each  of
+    'ncounts' - 1 thread counts with both placements.
+   ========================================================================== */
+
+
+void atomic_conf
+(
+    size_t   c,        /* configuration to decode */
+    size_t   ncounts,  /* number of thread counts */
+    int     *op,       /* operation of configuration */
+    int     *place,    /* placement of configuration */
+    size_t  *k         /* thread count of configuration */
+)
+{
+    size_t   per;      /* configurations of single operation */
+    size_t   j;        /* configuration within operation */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    per = 1 + ATOMIC_PLACES * (ncounts - 1);
+    *op = c / per;
+    j = c % per;
+
+    if (j == 0)
+    {
+        *place = ATOMIC_PLACE_SHARED;
+        *k = 0;
+        return;
+    }
+
+    *place = (j - 1) % ATOMIC_PLACES;
+    *k = 1 + (j - 1) / ATOMIC_PLACES;
+}
+
+
+/* ==========================================================================
+    returns operand of 'thread' in 'mem', which must have room for
+    ATOMIC_SPREAD bytes for every thread and ATOMIC_SPREAD more.  Operands
+    are aligned to ATOMIC_SPREAD, so shared one never straddles two lines.
+    When 'spread' is set, each thread gets its own, ATOMIC_SPREAD bytes
+    apart, otherwise all threads share the first one.
+   ========================================================================== */
+
+
+unsigned char *atomic_operand
+(
+    unsigned char  *mem,     /* memory for operands */
+    int             spread,  /* give each thread its own operand */
+    unsigned long   thread   /* number of thread */
+)
+{
+    mem += ATOMIC_SPREAD - (size_t)mem % ATOMIC_SPREAD;
+    return spread ? mem + thread * ATOMIC_SPREAD : mem;
+}
+
+
+/* ==========================================================================
+    measures throughput and latency of atomic fetch and add, compare  and
+    swap, exchange, and sequentially consistent load and store.  Each is
+    run on single thread, and when opts.threads is more than 1, contended
+    by that many threads, with operands on one shared cache line, or each
+    on its own line.  Placement means nothing for one thread, so it  runs
+    only once.  Every thread runs opts.report_intvl / 64 operations.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory or start threads
+   ========================================================================== */
+
+
+int atomic_bench(void)
+{
+    struct atomic_thread  *threads;    /* per thread state */
+    struct stats          *s;          /* ns/op of each configuration */
+    unsigned char         *line;       /* memory for operands */
+    unsigned long          counts[2];  /* thread counts to run */
+    unsigned long          i;          /* iterator for loop */
+    size_t                 nconf;      /* number of configurations */
+    size_t                 ncounts;    /* number of thread counts */
+    size_t                 c;          /* current configuration */
+    size_t                 k;          /* thread count of configuration */
+    int                    op;         /* operation of configuration */
+    int                    place;      /* placement of configuration */
+    double                 rate;       /* all threads ops/s */
+    double                 ns;         /* mean time of single op in ns */
+    double                 fail;       /* fraction of failed ops */
+    char                   name[48];   /* name of configuration */
+    int                    rc;         /* return code */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    counts[0] = 1;
+    counts[1] = opts.threads;
+    ncounts = opts.threads > 1 ? 2 : 1;
+    nconf = OP_MAX * (1 + ATOMIC_PLACES * (ncounts - 1));
+
+    threads = calloc(opts.threads, sizeof(*threads));
+    s = malloc(nconf * sizeof(*s));
+    line = malloc(opts.threads * ATOMIC_SPREAD + ATOMIC_SPREAD);
+
+    if (s)
+    {
+        for (c = 0; c != nconf; ++c)
+        {
+            stats_init(&s[c]);
+        }
+    }
+
+    if (threads == NULL || s == NULL || line == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+        goto error;
+    }
+
+    memset(line, 0, opts.threads * ATOMIC_SPREAD + ATOMIC_SPREAD);
+
+    if (out_text())
+    {
+        printf("operations per thread %lu, threads %lu, iterations %lu\n",
+               atomic_ops(),
+               opts.threads,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(s, nconf, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (c = 0; c != nconf; ++c)
+        {
+            atomic_conf(c, ncounts, &op, &place, &k);
+
+            if (atomic_run(threads, counts[k], op, place, line, &rate,
+                           &ns, &fail) != 0)
+            {
+                goto error;
+            }
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            atomic_report(i - opts.warmup + 1, op, place, counts[k], rate,
+                          ns, fail);
+
+            if (stats_add(&s[c], ns) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of time per operation\n");
+    }
+
+    for (c = 0; c != nconf; ++c)
+    {
+        atomic_conf(c, ncounts, &op, &place, &k);
+        sprintf(name, "%s %s %lu threads",
+                op_names[op],
+                place_names[place],
+                counts[k]);
+        stats_compute(&s[c], opts.outlier_mad);
+        stats_print(&s[c], name, "ns");
+    }
+
+    rc = 0;
+
+error:
+    for (c = 0; s && c != nconf; ++c)
+    {
+        stats_destroy(&s[c]);
+    }
+
+    free(threads);
+    free(line);
+    free(s);
+    return rc;
+}
+
+#endif
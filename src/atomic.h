@@ -0,0 +1,31 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef ATOMIC_H
+#define ATOMIC_H 1
+
+#include <stddef.h>
+
+/*
+ * distance between operands of threads, when they are spread across lines,
+ * two lines so adjacent line prefetcher doesn't pair them up
+ */
+
+#define ATOMIC_SPREAD 128
+
+enum atomic_place
+{
+    ATOMIC_PLACE_SHARED,
+    ATOMIC_PLACE_SPREAD,
+    ATOMIC_PLACES
+};
+
+void atomic_conf(size_t c, size_t ncounts, int *op, int *place, size_t *k);
+unsigned char *atomic_operand(unsigned char *mem, int spread,
+    unsigned long thread);
+int atomic_bench(void);
+
+#endif
@@ -0,0 +1,709 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base.h"
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * number of parts that key of configuration is built from
+ */
+
+#define BASE_KEY_PARTS 8
+
+
+/* ==== Private variables =================================================== */
+
+
+/*
+ * summary of single configuration loaded from baseline file
+ */
+
+struct base_entry
+{
+    char           key[BASE_KEY_MAX];  /* configuration, see base_key() */
+    double         mean;               /* mean of used samples */
+    double         stddev;             /* standard deviation of samples */
+    unsigned long  n;                  /* number of used samples */
+};
+
+static struct base_entry  *base_entries;
+static size_t              base_n;
+static size_t              base_size;
+
+/*
+ * set when baseline was loaded, and counters of configurations  that  were
+ * found in baseline and that regressed
+ */
+
+static int            base_loaded;
+static unsigned long  base_nmatched;
+static unsigned long  base_nregressed;
+
+/*
+ * line read from baseline file, json record can hold both keys and values
+ * of csv record, and csv header which is needed for  all  records  after
+ * it
+ */
+
+static char  base_line[2 * OUT_LINE_MAX + 64];
+static char  base_header[2 * OUT_LINE_MAX + 64];
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    joins 'BASE_KEY_PARTS' 'parts' into 'key', that is  configuration  of
+    the test and name of the configuration within it.  Clock is  not  part
+    of the key, as results do not depend on it.
+
+    returns:
+             0      key created
+            -1      key would not fit in BASE_KEY_MAX
+   ========================================================================== */
+
+
+static int base_key
+(
+    char               *key,    /* key will be stored here */
+    const char *const  *parts   /* parts of the key */
+)
+{
+    size_t              len;    /* length of key so far */
+    size_t              n;      /* length of current part */
+    int                 i;      /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (len = 0, i = 0; i != BASE_KEY_PARTS; ++i)
+    {
+        n = strlen(parts[i]);
+
+        if (len + n + 1 >= BASE_KEY_MAX)
+        {
+            return -1;
+        }
+
+        memcpy(key + len, parts[i], n);
+        len += n;
+        key[len++] = '|';
+    }
+
+    key[len - 1] = '\0';
+    return 0;
+}
+
+
+/* ==========================================================================
+    decodes json escape sequence, which starts with backslash at '*p', and
+    moves '*p' to its last character.  Control characters escaped  as
+    \u00XX are decoded, anything above single byte becomes '?'.
+
+    returns:
+            decoded character
+   ========================================================================== */
+
+
+static char base_unescape
+(
+    char         **p        /* backslash starting escape sequence */
+)
+{
+    char           hex[5];  /* hex digits of \u escape */
+    unsigned long  v;       /* value of \u escape */
+    int            i;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    ++*p;
+
+    switch (**p)
+    {
+    case 'n':
+        return '\n';
+
+    case 't':
+        return '\t';
+
+    case 'r':
+        return '\r';
+
+    case 'u':
+        for (i = 0; i != 4 && isxdigit((unsigned char)(*p)[i + 1]); ++i)
+        {
+            hex[i] = (*p)[i + 1];
+        }
+
+        if (i != 4)
+        {
+            return **p;
+        }
+
+        hex[4] = '\0';
+        *p += 4;
+        v = strtoul(hex, NULL, 16);
+        return v > 0xff ? '?' : (char)v;
+
+    default:
+        return **p;
+    }
+}
+
+
+/* ==========================================================================
+    unescapes, in place, quoted string that starts right after  opening
+    quote at 'p'.  Csv escapes quote by doubling it, json with backslash,
+    'csv' tells which one to expect.  '*end' is set right after closing
+    quote.
+
+    returns:
+            pointer to unescaped, nul terminated string
+   ========================================================================== */
+
+
+static char *base_string
+(
+    char   *p,    /* first character after opening quote */
+    char  **end,  /* position after closing quote will be stored here */
+    int     csv   /* string is from csv file */
+)
+{
+    char   *s;    /* start of string */
+    char   *w;    /* where next unescaped character goes */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (s = w = p; *p; ++p)
+    {
+        if (*p == '\\' && !csv && p[1])
+        {
+            *w++ = base_unescape(&p);
+        }
+        else if (*p == '"' && p[1] == '"' && csv)
+        {
+            *w++ = *++p;
+        }
+        else if (*p == '"')
+        {
+            ++p;
+            break;
+        }
+        else
+        {
+            *w++ = *p;
+        }
+    }
+
+    *end = p;
+    *w = '\0';
+    return s;
+}
+
+
+/* ==========================================================================
+    splits csv 'line' in place into at most BASE_FIELDS_MAX 'fields'
+
+    returns:
+            number of fields found
+   ========================================================================== */
+
+
+static int base_split_csv
+(
+    char   *line,    /* line to split */
+    char  **fields   /* pointers to fields will be stored here */
+)
+{
+    char   *p;       /* current position in line */
+    int     n;       /* number of fields */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    line[strcspn(line, "\r\n")] = '\0';
+
+    for (p = line, n = 0; n != BASE_FIELDS_MAX; )
+    {
+        if (*p == '"')
+        {
+            fields[n++] = base_string(p + 1, &p, 1);
+        }
+        else
+        {
+            fields[n++] = p;
+            p += strcspn(p, ",");
+        }
+
+        if (*p != ',')
+        {
+            *p = '\0';
+            break;
+        }
+
+        *p++ = '\0';
+    }
+
+    return n;
+}
+
+
+/* ==========================================================================
+    splits json object in 'line' in place into at most BASE_FIELDS_MAX
+    'keys' and 'vals'.  Only flat objects, as printed by  memperf,  are
+    understood.
+
+    returns:
+            number of fields found
+   ========================================================================== */
+
+
+static int base_split_json
+(
+    char   *line,   /* line to split */
+    char  **keys,   /* pointers to keys will be stored here */
+    char  **vals    /* pointers to values will be stored here */
+)
+{
+    char   *p;      /* current position in line */
+    int     n;      /* number of fields */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    p = strchr(line, '{') + 1;
+
+    for (n = 0; n != BASE_FIELDS_MAX; ++n)
+    {
+        p += strspn(p, " \t,");
+
+        if (*p != '"')
+        {
+            break;
+        }
+
+        keys[n] = base_string(p + 1, &p, 0);
+        p += strspn(p, " \t:");
+
+        if (*p == '"')
+        {
+            vals[n] = base_string(p + 1, &p, 0);
+            continue;
+        }
+
+        vals[n] = p;
+        p += strcspn(p, " \t,}\r\n");
+
+        if (*p == '\0')
+        {
+            return n + 1;
+        }
+
+        *p++ = '\0';
+    }
+
+    return n;
+}
+
+
+/* ==========================================================================
+    returns value of field 'key' from 'n' 'keys' and 'vals', or NULL  when
+    there is no such field
+   ========================================================================== */
+
+
+static const char *base_field
+(
+    char        **keys,  /* keys of record */
+    char        **vals,  /* values of record */
+    int           n,     /* number of fields in record */
+    const char   *key    /* key to look for */
+)
+{
+    int           i;     /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 0; i != n; ++i)
+    {
+        if (strcmp(keys[i], key) == 0)
+        {
+            return vals[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/* ==========================================================================
+    adds record of 'n' 'keys' and 'vals' to baseline, if it's summary  of
+    configuration.  Other records and incomplete ones are ignored.
+
+    returns:
+             0      record added or ignored
+            -1      couldn't allocate memory for record
+   ========================================================================== */
+
+
+static int base_add
+(
+    char               **keys,   /* keys of record */
+    char               **vals,   /* values of record */
+    int                  n       /* number of fields in record */
+)
+{
+    static const char   *names[BASE_KEY_PARTS] =
+    {
+        "test", "method", "block_size", "report_size", "cache_size",
+        "threads", "dist", "name"
+    };
+
+    const char          *parts[BASE_KEY_PARTS]; /* parts of key */
+    const char          *v;      /* value of field */
+    struct base_entry   *e;      /* entry to fill */
+    char                *ep;     /* end pointer of strtod */
+    size_t               size;   /* new number of entries */
+    int                  i;      /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    v = base_field(keys, vals, n, "record");
+
+    if (v == NULL || strcmp(v, "summary") != 0)
+    {
+        return 0;
+    }
+
+    for (i = 0; i != BASE_KEY_PARTS; ++i)
+    {
+        if ((parts[i] = base_field(keys, vals, n, names[i])) == NULL)
+        {
+            return 0;
+        }
+    }
+
+    if (base_n == base_size)
+    {
+        size = base_size ? base_size * 2 : 16;
+
+        if ((e = realloc(base_entries, size * sizeof(*e))) == NULL)
+        {
+            return -1;
+        }
+
+        base_entries = e;
+        base_size = size;
+    }
+
+    e = &base_entries[base_n];
+
+    if (base_key(e->key, parts) != 0)
+    {
+        return 0;
+    }
+
+    /*
+     * mean is required, without stddev and number of samples, difference
+     * will only be compared against threshold
+     */
+
+    if ((v = base_field(keys, vals, n, "mean")) == NULL ||
+        (e->mean = strtod(v, &ep), ep == v || *ep))
+    {
+        return 0;
+    }
+
+    v = base_field(keys, vals, n, "stddev");
+    e->stddev = v ? strtod(v, NULL) : 0;
+    v = base_field(keys, vals, n, "samples");
+    e->n = v ? strtoul(v, NULL, 10) : 0;
+
+    ++base_n;
+    return 0;
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    loads summary records from csv or json file at 'path', as printed  by
+    memperf with -o option.  Format is detected from  content  of  file.
+    Summaries are later compared against this run by base_compare().
+
+    returns:
+             0      baseline loaded
+            -1      couldn't open file, allocate memory or file has  no
+                    summary records
+   ========================================================================== */
+
+
+int base_load
+(
+    const char  *path                   /* path to baseline file */
+)
+{
+    FILE        *f;                     /* baseline file */
+    char        *keys[BASE_FIELDS_MAX]; /* keys of current record */
+    char        *vals[BASE_FIELDS_MAX]; /* values of current record */
+    char        *p;                     /* first non blank character */
+    int          nkeys;                 /* number of keys in csv header */
+    int          n;                     /* number of fields in record */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    base_destroy();
+
+    if ((f = fopen(path, "r")) == NULL)
+    {
+        fprintf(stderr, "Couldn't open baseline %s\n", path);
+        return -1;
+    }
+
+    nkeys = 0;
+
+    while (fgets(base_line, sizeof(base_line), f))
+    {
+        p = base_line + strspn(base_line, " \t");
+
+        if (*p == '{')
+        {
+            n = base_split_json(p, keys, vals);
+        }
+        else if (*p == '"' && nkeys)
+        {
+            n = base_split_csv(p, vals);
+            n = n < nkeys ? n : nkeys;
+        }
+        else if (*p != '[' && *p != ']' && *p != '\n' && *p != '\0')
+        {
+            /*
+             * csv header, it describes every following record until  next
+             * header
+             */
+
+            strcpy(base_header, p);
+            nkeys = base_split_csv(base_header, keys);
+            continue;
+        }
+        else
+        {
+            continue;
+        }
+
+        if (base_add(keys, vals, n) != 0)
+        {
+            fprintf(stderr, "Couldn't allocate memory for baseline\n");
+            fclose(f);
+            base_destroy();
+            return -1;
+        }
+    }
+
+    fclose(f);
+
+    if (base_n == 0)
+    {
+        fprintf(stderr, "Couldn't find any summary in baseline %s\n", path);
+        return -1;
+    }
+
+    base_loaded = 1;
+    return 0;
+}
+
+
+/* ==========================================================================
+    compares computed 's' of configuration 'name' against baseline  and
+    prints result.  Unit ending with "/s" means rate, where higher is better,
+    otherwise it's time and lower is better.  Configuration regresses,  when
+    its mean got worse by more than opts.regress percent  and  difference
+    is significant according to welch's t-test.  Does  nothing  when  no
+    baseline was loaded.
+   ========================================================================== */
+
+
+void base_compare
+(
+    const struct stats  *s,                  /* computed stats of this run */
+    const char          *name,               /* name of configuration */
+    const char          *unit                /* unit of samples */
+)
+{
+    char                 key[BASE_KEY_MAX];  /* key of configuration */
+    char                 num[4][32];         /* formatted numeric parts */
+    const char          *parts[BASE_KEY_PARTS]; /* parts of key */
+    const char          *status;             /* result of comparison */
+    struct base_entry   *e;                  /* baseline of configuration */
+    double               delta;              /* change of mean in percent */
+    double               worse;              /* delta, positive when worse */
+    size_t               len;                /* length of unit */
+    size_t               i;                  /* iterator for loop */
+    int                  sig;                /* difference is significant */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (!base_loaded)
+    {
+        return;
+    }
+
+    /*
+     * numbers are formatted the same way out module prints them, so  keys
+     * are equal for equal configurations
+     */
+
+    sprintf(num[0], "%lu", (unsigned long)opts.block_size);
+    sprintf(num[1], "%.17g", (double)opts.report_intvl);
+    sprintf(num[2], "%lu", (unsigned long)opts.cache_size);
+    sprintf(num[3], "%lu", opts.threads);
+    parts[0] = out_test_name();
+    parts[1] = out_method_name();
+    parts[2] = num[0];
+    parts[3] = num[1];
+    parts[4] = num[2];
+    parts[5] = num[3];
+    parts[6] = out_dist_name();
+    parts[7] = name;
+
+    e = NULL;
+
+    for (i = 0; base_key(key, parts) == 0 && i != base_n; ++i)
+    {
+        if (strcmp(base_entries[i].key, key) == 0)
+        {
+            e = &base_entries[i];
+            break;
+        }
+    }
+
+    if (e == NULL)
+    {
+        if (out_text())
+        {
+            printf("%-22s not in baseline\n", name);
+            return;
+        }
+
+        out_record("compare");
+        out_str("name", name);
+        out_str("unit", unit);
+        out_double("mean", s->mean);
+        out_str("status", "missing");
+        out_record_end();
+        return;
+    }
+
+    ++base_nmatched;
+    delta = e->mean ? (s->mean - e->mean) / fabs(e->mean) * 100 : 0;
+    len = strlen(unit);
+    worse = len >= 2 && strcmp(unit + len - 2, "/s") == 0 ? -delta : delta;
+    sig = stats_welch(s, e->mean, e->stddev, e->n);
+
+    if (!sig)
+    {
+        status = "no change";
+    }
+    else if (worse > opts.regress)
+    {
+        status = "regression";
+        ++base_nregressed;
+    }
+    else if (worse < 0)
+    {
+        status = "improvement";
+    }
+    else
+    {
+        status = "within threshold";
+    }
+
+    if (out_text())
+    {
+        printf("%-22s base %10.2f %s, delta %+8.2f%%, %s\n",
+               name,
+               e->mean,
+               unit,
+               delta,
+               status);
+        return;
+    }
+
+    out_record("compare");
+    out_str("name", name);
+    out_str("unit", unit);
+    out_double("mean", s->mean);
+    out_double("base_mean", e->mean);
+    out_double("base_stddev", e->stddev);
+    out_ulong("base_samples", e->n);
+    out_double("delta_pct", delta);
+    out_ulong("significant", sig);
+    out_str("status", status);
+    out_record_end();
+}
+
+
+/* ==========================================================================
+    turns return code 'rc' of a test into exit code of the program,  taking
+    comparison against baseline into account
+
+    returns:
+             0                      test passed, and nothing regressed
+             1                      test failed, or baseline was loaded
+                                    but no configuration of  this  run
+                                    was found in it
+             BASE_EXIT_REGRESSION   at least one configuration regressed
+   ========================================================================== */
+
+
+int base_status
+(
+    int  rc  /* return code of test */
+)
+{
+    if (rc != 0)
+    {
+        return 1;
+    }
+
+    if (!base_loaded)
+    {
+        return 0;
+    }
+
+    if (base_nmatched == 0)
+    {
+        fprintf(stderr, "Couldn't find configuration of this run in "
+                "baseline, use the same options as baseline run\n");
+        return 1;
+    }
+
+    return base_nregressed ? BASE_EXIT_REGRESSION : 0;
+}
+
+
+/* ==========================================================================
+    releases loaded baseline, and resets comparison results
+   ========================================================================== */
+
+
+void base_destroy(void)
+{
+    free(base_entries);
+    base_entries = NULL;
+    base_n = 0;
+    base_size = 0;
+    base_loaded = 0;
+    base_nmatched = 0;
+    base_nregressed = 0;
+}
@@ -0,0 +1,37 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef BASE_H
+#define BASE_H 1
+
+#include "stats.h"
+
+/*
+ * max length of key identifying configuration, that is test parameters
+ * and name of the configuration within a test
+ */
+
+#define BASE_KEY_MAX 256
+
+/*
+ * max number of fields in single record of baseline file
+ */
+
+#define BASE_FIELDS_MAX 64
+
+/*
+ * exit code of the program when any configuration  regressed,  distinct
+ * from codes returned on errors
+ */
+
+#define BASE_EXIT_REGRESSION 4
+
+int base_load(const char *path);
+void base_compare(const struct stats *s, const char *name, const char *unit);
+int base_status(int rc);
+void base_destroy(void);
+
+#endif
@@ -15,7 +15,13 @@
 #include <string.h>
 #include <time.h>
 
+#include "freq.h"
+#include "hist.h"
+#include "noise.h"
 #include "opts.h"
+#include "out.h"
+#include "pmc.h"
+#include "stats.h"
 #include "utils.h"
 
 
@@ -34,31 +40,52 @@
         {                                       \
             memcpy(f1, f2, opts.cache_size);    \
         }                                       \
-        ts(start)
+                                                \
+        if (pmc.n)                              \
+        {                                       \
+            pmc_enable(&pmc);                   \
+        }                                       \
+                                                \
+        ts(&start)
 
 #define BENCH_END()                             \
-    ts(finish);                                 \
-    ts_add_diff(taken, start, finish);          \
+    ts(&finish);                                \
+                                                \
+    if (pmc.n)                                  \
+    {                                           \
+        pmc_disable(&pmc);                      \
+    }                                           \
+                                                \
+    ts_add_diff(&taken, &start, &finish);       \
+    ts_reset(&block);                           \
+    ts_add_diff(&block, &start, &finish);       \
+    hist_add(&lat, ts2ns(&block));              \
 }
 
 /* ==== Private functions =================================================== */
 
 
 /* ==========================================================================
-    prints benchmark report to standard output
+    prints benchmark report to standard output, average rate is followed by
+    distribution of time it took to copy single block
    ========================================================================== */
 
 
 static void bench_report
 (
-    void*          taken,      /* time taken on data copying */
-    float          copied      /* number of bytes copied */
+    struct ts           *taken,      /* time taken on data copying */
+    float                copied,     /* number of bytes copied */
+    struct hist         *lat,        /* time of copying each block in ns */
+    const struct freq   *freq        /* effective frequency of interval */
 )
 {
-    struct jedec   jd_bps;     /* bytes per second in jedec format */
-    struct jedec   jd_copied;  /* number of bytes copied in jedec format */
-    unsigned long  us;         /* time taken copying data in microseconds */
-    float          bps;        /* bytes per second rate */
+    struct jedec         jd_bps;     /* bytes per second in jedec format */
+    struct jedec         jd_copied;  /* bytes copied in jedec format */
+    struct bench_lat     l;          /* percentiles of block copy time */
+    unsigned long        us;         /* time taken copying data in us */
+    double               cycles;     /* time taken copying in tsc cycles */
+    double               sec;        /* time taken copying in seconds */
+    float                bps;        /* bytes per second rate */
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     if ((us = ts2us(taken)) == 0)
@@ -72,18 +99,176 @@ static void bench_report
     bytes2jedec(bps, &jd_bps);
     bytes2jedec(copied, &jd_copied);
 
-    printf("copied %5lu %cB, in %5lu us, rate %5lu %cB/s\n",
+    printf("copied %5lu %cB, in %5lu us, ",
            jd_copied.val,
            jd_copied.pre,
-           us,
-           jd_bps.val,
-           jd_bps.pre);
+           us);
+
+    if ((cycles = ts2cycles(taken)) > 0)
+    {
+        printf("%10.0f cycles, ", cycles);
+    }
+
+    printf("rate %5lu %cB/s, ", jd_bps.val, jd_bps.pre);
+
+    if (freq->hz > 0 && (sec = ts2sec(taken)) > 0)
+    {
+        printf("%6.2f B/cycle at %.2f GHz (%s), ",
+               copied / sec / freq->hz,
+               freq->hz / 1000000000.0,
+               freq->source);
+    }
+
+    bench_latency(lat, &l);
+    printf("min %5lu, p50 %5lu, p90 %5lu, p99 %6lu, "
+           "p99.9 %6lu, max %7lu ns\n",
+           l.min, l.p50, l.p90, l.p99, l.p999, l.max);
+}
+
+
+/* ==========================================================================
+    prints values of counters 'pmc' per byte of 'copied' data
+   ========================================================================== */
+
+
+static void bench_report_pmc
+(
+    double              copied,  /* number of bytes copied */
+    const struct pmc   *pmc      /* counters of interval */
+)
+{
+    int                 i;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    printf("    per byte:");
+
+    for (i = 0; i != pmc->n; ++i)
+    {
+        printf("%s %s %.4g",
+               i ? "," : "",
+               pmc->abbr[i],
+               copied > 0 ? pmc->val[i] / copied : 0);
+    }
+
+    printf("\n");
+}
+
+
+/* ==========================================================================
+    prints what disturbed interval, that is judged as 'verdict'
+   ========================================================================== */
+
+
+static void bench_report_noise
+(
+    const struct noise  *noise,   /* noise of interval */
+    const char          *verdict  /* flagged or discarded */
+)
+{
+    printf("    noise: ctx-sw %ld voluntary, %ld preempted, migrations %ld, "
+           "faults %ld minor, %ld major, run delay %.0f us, %s\n",
+           noise->delta.vcsw,
+           noise->delta.ivcsw,
+           noise->delta.migrations,
+           noise->delta.minflt,
+           noise->delta.majflt,
+           noise->delta.run_delay / 1000,
+           verdict);
+}
+
+
+/* ==========================================================================
+    same as bench_report() but prints exact values as machine readable
+    record of interval 'intvl'
+   ========================================================================== */
+
+
+static void bench_record
+(
+    unsigned long        intvl,   /* interval number, counted from 1 */
+    struct ts           *taken,   /* time taken on data copying */
+    double               copied,  /* number of bytes copied */
+    struct hist         *lat,     /* time of copying each block in ns */
+    const struct pmc    *pmc,     /* counters of interval */
+    const struct freq   *freq,    /* effective frequency of interval */
+    const struct noise  *noise,   /* noise of interval */
+    const char          *verdict  /* judgement of noise, NULL if off */
+)
+{
+    struct bench_lat     l;       /* percentiles of block copy time */
+    char                 key[64]; /* name of counter field */
+    double               sec;     /* time taken on copying in seconds */
+    int                  i;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    sec = ts2sec(taken);
+
+    out_record("interval");
+    out_ulong("interval", intvl);
+    out_double("bytes", copied);
+    out_double("ns", sec * 1000000000.0);
+    out_double("cycles", ts2cycles(taken));
+    out_double("rate_bps", sec > 0 ? copied / sec : 0);
+    out_ulong("blocks", lat->n);
+    bench_latency(lat, &l);
+    out_ulong("min_ns", l.min);
+    out_ulong("p50_ns", l.p50);
+    out_ulong("p90_ns", l.p90);
+    out_ulong("p99_ns", l.p99);
+    out_ulong("p999_ns", l.p999);
+    out_ulong("max_ns", l.max);
+    out_double("freq_hz", freq->hz);
+    out_str("freq_source", freq->source);
+    out_double("bytes_per_cycle",
+               sec > 0 && freq->hz > 0 ? copied / sec / freq->hz : 0);
+
+    for (i = 0; i != pmc->n; ++i)
+    {
+        sprintf(key, "pmc_%s", pmc->name[i]);
+        out_double(key, pmc->val[i]);
+        sprintf(key, "pmc_%s_per_byte", pmc->name[i]);
+        out_double(key, copied > 0 ? pmc->val[i] / copied : 0);
+    }
+
+    if (verdict)
+    {
+        out_ulong("noise_vcsw", noise->delta.vcsw);
+        out_ulong("noise_ivcsw", noise->delta.ivcsw);
+        out_ulong("noise_migrations", noise->delta.migrations);
+        out_ulong("noise_minflt", noise->delta.minflt);
+        out_ulong("noise_majflt", noise->delta.majflt);
+        out_double("noise_run_delay_ns", noise->delta.run_delay);
+        out_str("noise", verdict);
+    }
+
+    out_record_end();
 }
 
 
 /* ==== Public functions ==================================================== */
 
 
+/* ==========================================================================
+    fills 'l' with percentiles of block copy time from histogram 'lat',
+    that every copy of interval was added to
+   ========================================================================== */
+
+
+void bench_latency
+(
+    const struct hist  *lat,  /* time of copying each block in ns */
+    struct bench_lat   *l     /* percentiles will be stored here */
+)
+{
+    l->min = hist_pct(lat, 0);
+    l->p50 = hist_pct(lat, 50);
+    l->p90 = hist_pct(lat, 90);
+    l->p99 = hist_pct(lat, 99);
+    l->p999 = hist_pct(lat, 99.9);
+    l->max = hist_pct(lat, 100);
+}
+
+
 /* ==========================================================================
     performs benchmark on pointers dst and src.  dst and src can be heap  or
     stack allocated.
@@ -98,10 +283,21 @@ int bench
     void         *f2                /* second pointer used to flush cpu cache */
 )
 {
-    void         *start;            /* timer indicating benchmark start */
-    void         *finish;           /* timer indicating benchmark finish */
-    void         *taken;            /* timer for time taken on benchmark */
-    float         bytes_copied;     /* bytes copied in * iteration */
+    struct ts     start;            /* timer indicating benchmark start */
+    struct ts     finish;           /* timer indicating benchmark finish */
+    struct ts     taken;            /* timer for time taken on benchmark */
+    struct ts     block;            /* time taken on single block copy */
+    struct hist   lat;              /* time of each block copy in ns */
+    struct ts     overhead;         /* time taken by reading clock */
+    struct stats  rate;             /* copy rate of each interval in MB/s */
+    struct pmc    pmc;              /* performance counters of interval */
+    struct freq   freq;             /* effective frequency of interval */
+    struct noise  noise;            /* what disturbed interval */
+    const char   *verdict;          /* judgement of noise of interval */
+    unsigned long nskip;            /* number of discarded intervals */
+    unsigned long nnoisy;           /* number of noisy intervals */
+    double        sec;              /* time taken on interval in seconds */
+    double        bytes_copied;     /* bytes copied in * iteration */
     size_t        loops;            /* loops needed to copy requested bytes */
     size_t        i;                /* iterator for loop */
     size_t        j;                /* iterator for loop */
@@ -110,21 +306,46 @@ int bench
     struct jedec  jd_report_intvl;  /* report interval value in jedec format */
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    start = ts_new();
-    finish = ts_new();
-    taken = ts_new();
-
+    stats_init(&rate);
     srand(time(NULL));
+
+    freq_open(&freq);
+
+    if (pmc_open(&pmc, opts.counters) != 0)
+    {
+        fprintf(stderr, "Couldn't open any performance counter, "
+                "continuing without them\n");
+    }
+
     loops = opts.report_intvl / opts.block_size;
     bytes2jedec(opts.block_size, &jd_block_size);
     bytes2jedec(opts.report_intvl, &jd_report_intvl);
 
-    printf("block size: %lu %cB, report every %lu %cB, iterations %lu\n",
-           jd_block_size.val,
-           jd_block_size.pre,
-           jd_report_intvl.val,
-           jd_report_intvl.pre,
-           opts.num_intvl);
+    if (out_text())
+    {
+        printf("block size: %lu %cB, report every %lu %cB, iterations %lu\n",
+               jd_block_size.val,
+               jd_block_size.pre,
+               jd_report_intvl.val,
+               jd_report_intvl.pre,
+               opts.num_intvl);
+
+        if (ts_tsc_hz() > 0)
+        {
+            printf("tsc frequency: %.0f MHz\n", ts_tsc_hz() / 1000000);
+        }
+
+        overhead.t = ts_overhead;
+        printf("timer overhead: %lu ns, subtracted from each block\n",
+               ts2ns(&overhead));
+
+        if (pmc.n)
+        {
+            printf("counters: %s\n", pmc.sw ?
+                   "software, pmu not available or not requested" :
+                   "hardware, user space only");
+        }
+    }
 
     /*
      * for systems that uses optimistic memory allocation (like linux) dst
@@ -137,9 +358,35 @@ int bench
 
     memcpy(dst, src, opts.block_size);
 
-    for (i = 0, j = 0; i != opts.num_intvl; ++i)
+    /*
+     * same goes for cache flushing buffers, otherwise first intervals
+     * would be flagged as noisy because of page faults
+     */
+
+    if (opts.cache_size)
     {
-        ts_reset(taken);
+        memcpy(f1, f2, opts.cache_size);
+    }
+
+    nskip = 0;
+    nnoisy = 0;
+
+    /*
+     * discarded intervals are not counted, so summary still gets requested
+     * number of them, but no more than twice that many are run in total
+     */
+
+    for (i = 0, j = 0; stats_next(&rate, 1, i - nskip); ++i)
+    {
+        ts_reset(&taken);
+        hist_reset(&lat);
+        pmc_reset(&pmc);
+        freq_begin(&freq);
+
+        if (opts.noise != NOISE_OFF)
+        {
+            noise_begin(&noise);
+        }
 
         switch (opts.method)
         {
@@ -171,13 +418,99 @@ int bench
             assert(0 && "test method not supported, should not get here");
         }
 
-        bytes_copied = (float)j * opts.block_size;
-        bench_report(taken, bytes_copied);
+        if (opts.noise != NOISE_OFF)
+        {
+            noise_end(&noise);
+        }
+
+        if (stats_warmup(i))
+        {
+            continue;
+        }
+
+        verdict = NULL;
+
+        if (opts.noise != NOISE_OFF)
+        {
+            verdict = "clean";
+
+            if (noise.noisy)
+            {
+                ++nnoisy;
+                verdict = "flagged";
+
+                if (opts.noise == NOISE_DISCARD && nskip < opts.num_intvl)
+                {
+                    verdict = "discarded";
+                }
+            }
+        }
+
+        bytes_copied = (double)j * opts.block_size;
+        sec = ts2sec(&taken);
+
+        if (pmc_read(&pmc) != 0)
+        {
+            pmc_close(&pmc);
+        }
+
+        freq_end(&freq, sec, &pmc);
+
+        if (out_text())
+        {
+            bench_report(&taken, bytes_copied, &lat, &freq);
+
+            if (pmc.n)
+            {
+                bench_report_pmc(bytes_copied, &pmc);
+            }
+
+            if (verdict && noise.noisy)
+            {
+                bench_report_noise(&noise, verdict);
+            }
+        }
+        else
+        {
+            bench_record(i - opts.warmup + 1, &taken, bytes_copied, &lat,
+                         &pmc, &freq, &noise, verdict);
+        }
+
+        if (verdict && strcmp(verdict, "discarded") == 0)
+        {
+            ++nskip;
+            continue;
+        }
+
+        sec = sec > 0 ? sec : 1e-9;
+
+        if (stats_add(&rate, bytes_copied / sec / (1024 * 1024)) != 0)
+        {
+            fprintf(stderr, "Couldn't allocate memory for samples\n");
+            stats_destroy(&rate);
+            pmc_close(&pmc);
+            freq_close(&freq);
+            return -1;
+        }
+    }
+
+    if (out_text())
+    {
+        if (nnoisy)
+        {
+            printf("noisy intervals: %lu, %lu of them discarded\n",
+                   nnoisy,
+                   nskip);
+        }
+
+        printf("summary of copy rate\n");
     }
 
-    free(start);
-    free(finish);
-    free(taken);
+    stats_compute(&rate, opts.outlier_mad);
+    stats_print(&rate, opts.method == METHOD_BBB ? "bbb" : "memcpy", "MB/s");
+    stats_destroy(&rate);
+    pmc_close(&pmc);
+    freq_close(&freq);
 
     return 0;
 }
@@ -9,6 +9,23 @@
 
 #include <stddef.h>
 
+#include "hist.h"
+
+/*
+ * percentiles of time, in ns, it took to copy single block in interval
+ */
+
+struct bench_lat
+{
+    unsigned long min;
+    unsigned long p50;
+    unsigned long p90;
+    unsigned long p99;
+    unsigned long p999;
+    unsigned long max;
+};
+
+void bench_latency(const struct hist *lat, struct bench_lat *l);
 int bench(void* dst, void* src, void *f1, void *f2);
 
 #endif
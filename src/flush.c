@@ -0,0 +1,488 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "flush.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_CPUID_H
+#include <cpuid.h>
+#endif
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+#if HAVE_CLFLUSH
+
+
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * clflushopt and clwb are encoded with 0x66 prefix on clflush and xsaveopt,
+ * so they can be emitted by assemblers that don't know them yet
+ */
+
+#define CLFLUSH(p)    __asm__ __volatile__("clflush (%0)" :: "r"(p) : "memory")
+#define CLFLUSHOPT(p) __asm__ __volatile__(".byte 0x66; clflush (%0)"       \
+                                           :: "r"(p) : "memory")
+#define CLWB(p)       __asm__ __volatile__(".byte 0x66; xsaveopt (%0)"      \
+                                           :: "r"(p) : "memory")
+#define SFENCE()      __asm__ __volatile__("sfence" ::: "memory")
+#define MFENCE()      __asm__ __volatile__("mfence" ::: "memory")
+#define NOFENCE()     do { } while (0)
+
+
+/* ==========================================================================
+    flushes every line of 'buf' with instruction 'insn' executing 'fence'
+    after every line.  Specialized loop is generated for each instruction
+    and fence, so no branch or call is made between flushes
+   ========================================================================== */
+
+
+#define FLUSH_LOOP(insn, fence)                                         \
+    for (p = buf; p < end; p += line)                                   \
+    {                                                                   \
+        insn(p);                                                        \
+        fence();                                                        \
+    }
+
+
+/* ==========================================================================
+    flushes 'buf' with instruction 'insn' and fence mode 'f'
+   ========================================================================== */
+
+
+#define FLUSH_PASS(insn, f)                                             \
+    switch (f)                                                          \
+    {                                                                   \
+    case FENCE_SFENCE_LINE: FLUSH_LOOP(insn, SFENCE); break;            \
+    case FENCE_MFENCE_LINE: FLUSH_LOOP(insn, MFENCE); break;            \
+    default: FLUSH_LOOP(insn, NOFENCE); break;                          \
+    }                                                                   \
+                                                                        \
+    if (f == FENCE_SFENCE_BATCH)                                        \
+    {                                                                   \
+        SFENCE();                                                       \
+    }                                                                   \
+    else if (f == FENCE_MFENCE_BATCH)                                   \
+    {                                                                   \
+        MFENCE();                                                       \
+    }
+
+
+/* ==== Private declarations ================================================ */
+
+
+enum flush_fence
+{
+    FENCE_NONE,
+    FENCE_SFENCE_LINE,
+    FENCE_SFENCE_BATCH,
+    FENCE_MFENCE_LINE,
+    FENCE_MFENCE_BATCH,
+    FENCE_MAX
+};
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *insn_names[FLUSH_INSN_MAX] =
+{
+    "clflush",
+    "clflushopt",
+    "clwb"
+};
+
+static const char *fence_names[FENCE_MAX] =
+{
+    "no fence",
+    "sfence/line",
+    "sfence/block",
+    "mfence/line",
+    "mfence/block"
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    checks if cpu supports instruction 'insn'
+   ========================================================================== */
+
+
+static int flush_supported
+(
+    enum flush_insn  insn  /* instruction to check */
+)
+{
+#if HAVE_CPUID_H
+    unsigned int     max;  /* highest cpuid leaf */
+    unsigned int     a;    /* eax register */
+    unsigned int     b;    /* ebx register */
+    unsigned int     c;    /* ecx register */
+    unsigned int     d;    /* edx register */
+    unsigned int     d1;   /* edx register of leaf 1 */
+    unsigned int     b7;   /* ebx register of leaf 7 */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    d1 = 0;
+    b7 = 0;
+
+    if ((max = __get_cpuid_max(0, NULL)) >= 1)
+    {
+        __cpuid(1, a, b, c, d1);
+    }
+
+    if (max >= 7)
+    {
+        __cpuid_count(7, 0, a, b7, c, d);
+    }
+
+    return flush_has(insn, max, d1, b7);
+#else
+    return flush_has(insn, 0, 0, 0);
+#endif
+}
+
+
+/* ==========================================================================
+    returns size of cache line flushed by single clflush
+   ========================================================================== */
+
+
+static size_t flush_line_size(void)
+{
+#if HAVE_CPUID_H
+    unsigned int  max;  /* highest cpuid leaf */
+    unsigned int  a;    /* eax register */
+    unsigned int  b;    /* ebx register */
+    unsigned int  c;    /* ecx register */
+    unsigned int  d;    /* edx register */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    b = 0;
+
+    if ((max = __get_cpuid_max(0, NULL)) >= 1)
+    {
+        __cpuid(1, a, b, c, d);
+    }
+
+    return flush_line(max, b);
+#else
+    return flush_line(0, 0);
+#endif
+}
+
+
+/* ==========================================================================
+    flushes every cache line of 'buf' once with instruction 'insn',  using
+    fence mode 'f'
+   ========================================================================== */
+
+
+static void flush_pass
+(
+    enum flush_insn    insn,  /* instruction to flush with */
+    enum flush_fence   f,     /* where to put fences */
+    unsigned char     *buf,   /* memory to flush */
+    size_t             line   /* size of cache line */
+)
+{
+    unsigned char     *p;     /* currently flushed line */
+    unsigned char     *end;   /* end of buffer */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    end = buf + opts.block_size;
+
+    switch (insn)
+    {
+    case FLUSH_CLFLUSH:
+        FLUSH_PASS(CLFLUSH, f);
+        break;
+
+    case FLUSH_CLFLUSHOPT:
+        FLUSH_PASS(CLFLUSHOPT, f);
+        break;
+
+    case FLUSH_CLWB:
+        FLUSH_PASS(CLWB, f);
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+/* ==========================================================================
+    prints result of flushing 'lines' cache lines in 'us' microseconds
+   ========================================================================== */
+
+
+static void flush_report
+(
+    unsigned long      intvl,  /* interval number, counted from 1 */
+    enum flush_insn    insn,   /* instruction that was used */
+    enum flush_fence   f,      /* fence mode that was used */
+    double             lines,  /* number of flushed lines */
+    double             sec     /* time spent on flushing in seconds */
+)
+{
+    if (!out_text())
+    {
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("insn", insn_names[insn]);
+        out_str("fence", fence_names[f]);
+        out_double("lines", lines);
+        out_double("ns", sec * 1000000000.0);
+        out_double("rate_lps", sec > 0 ? lines / sec : 0);
+        out_double("ns_per_line", sec * 1000000000.0 / lines);
+        out_record_end();
+        return;
+    }
+
+    /*
+     * short runs take less than a microsecond, so rates are computed from
+     * seconds, and not from whole microseconds
+     */
+
+    printf("%-10s %-12s lines %10lu, rate %10lu lines/s, %7.2f ns/line\n",
+           insn_names[insn],
+           fence_names[f],
+           (unsigned long)lines,
+           (unsigned long)(sec > 0 ? lines / sec : 0),
+           sec * 1000000000.0 / lines);
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    checks if instruction 'insn' is supported, from highest cpuid leaf
+    'max', edx of leaf 1 and ebx of leaf 7.  'max' is 0 when  cpuid  is
+    not available, then only clflush is assumed to work.
+
+    returns:
+            1       instruction is supported
+            0       it is not
+   ========================================================================== */
+
+
+int flush_has
+(
+    enum flush_insn  insn,  /* instruction to check */
+    unsigned int     max,   /* highest cpuid leaf, 0 without cpuid */
+    unsigned int     d1,    /* edx register of leaf 1 */
+    unsigned int     b7     /* ebx register of leaf 7 */
+)
+{
+    if (max == 0)
+    {
+        return insn == FLUSH_CLFLUSH;
+    }
+
+    if (insn == FLUSH_CLFLUSH)
+    {
+        return !!(d1 & (1u << 19));
+    }
+
+    if (max < 7)
+    {
+        return 0;
+    }
+
+    return insn == FLUSH_CLFLUSHOPT ? !!(b7 & (1u << 23)) : !!(b7 & (1u << 24));
+}
+
+
+/* ==========================================================================
+    returns size of cache line flushed by single clflush, from  highest
+    cpuid leaf 'max' and ebx of leaf 1, or 64 when cpuid doesn't tell
+   ========================================================================== */
+
+
+size_t flush_line
+(
+    unsigned int  max,  /* highest cpuid leaf, 0 without cpuid */
+    unsigned int  b1    /* ebx register of leaf 1 */
+)
+{
+    if (max >= 1 && ((b1 >> 8) & 0xff))
+    {
+        return ((b1 >> 8) & 0xff) * 8;
+    }
+
+    return 64;
+}
+
+
+/* ==========================================================================
+    measures throughput of cache line flush and write back instructions  -
+    clflush, clflushopt and clwb - with no fences, with fence after  every
+    line, and with single fence after whole block.  Block is dirtied before
+    each pass, so every flush has to write the line back to memory.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory
+   ========================================================================== */
+
+
+int flush_bench(void)
+{
+    unsigned char  *buf;            /* memory to flush */
+    struct ts       start;          /* timer indicating flush start */
+    struct ts       finish;         /* timer indicating flush finish */
+    struct ts       taken;          /* time taken on flushing */
+    struct stats    nspl[FLUSH_INSN_MAX * FENCE_MAX]; /* ns/line of configs */
+    struct stats   *s;              /* stats of current configuration */
+    char            name[32];       /* name of configuration */
+    size_t          line;           /* size of cache line */
+    size_t          nlines;         /* number of lines in block */
+    size_t          loops;          /* loops needed to flush report_intvl */
+    size_t          j;              /* iterator for loop */
+    unsigned long   i;              /* iterator for loop */
+    int             insn;           /* iterator for loop */
+    int             f;              /* iterator for loop */
+    int             rc;             /* return code */
+    struct jedec    jd_block_size;  /* block size in jedec format */
+    struct jedec    jd_intvl;       /* report interval in jedec format */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+
+    for (f = 0; f != FLUSH_INSN_MAX * FENCE_MAX; ++f)
+    {
+        stats_init(&nspl[f]);
+    }
+
+    line = flush_line_size();
+    nlines = (opts.block_size + line - 1) / line;
+    buf = malloc(opts.block_size);
+
+    if (buf == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate requested memory block\n");
+        goto error;
+    }
+
+    loops = opts.report_intvl / opts.block_size;
+    loops = loops ? loops : 1;
+    bytes2jedec(opts.block_size, &jd_block_size);
+    bytes2jedec(opts.report_intvl, &jd_intvl);
+
+    if (out_text())
+    {
+        printf("block size: %lu %cB, line size %lu, report every %lu %cB, "
+               "iterations %lu\n",
+               jd_block_size.val,
+               jd_block_size.pre,
+               (unsigned long)line,
+               jd_intvl.val,
+               jd_intvl.pre,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(nspl, FLUSH_INSN_MAX * FENCE_MAX, i); ++i)
+    {
+        for (insn = 0; insn != FLUSH_INSN_MAX; ++insn)
+        {
+            if (!flush_supported(insn))
+            {
+                if (out_text() && !stats_warmup(i))
+                {
+                    printf("%-10s not supported by cpu\n", insn_names[insn]);
+                }
+
+                continue;
+            }
+
+            for (f = 0; f != FENCE_MAX; ++f)
+            {
+                ts_reset(&taken);
+
+                for (j = 0; j != loops; ++j)
+                {
+                    /*
+                     * dirty lines so flush has to write them back, clean
+                     * lines are much cheaper to flush
+                     */
+
+                    memset(buf, (int)j, opts.block_size);
+
+                    ts(&start);
+                    flush_pass(insn, f, buf, line);
+                    ts(&finish);
+                    ts_add_diff(&taken, &start, &finish);
+                }
+
+                if (stats_warmup(i))
+                {
+                    continue;
+                }
+
+                flush_report(i - opts.warmup + 1, insn, f,
+                             (double)loops * nlines, ts2sec(&taken));
+                s = &nspl[insn * FENCE_MAX + f];
+
+                if (stats_add(s, ts2sec(&taken) * 1e9 / loops / nlines))
+                {
+                    fprintf(stderr, "Couldn't allocate memory for samples\n");
+                    goto error;
+                }
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of time per line\n");
+    }
+
+    for (insn = 0; insn != FLUSH_INSN_MAX; ++insn)
+    {
+        for (f = 0; f != FENCE_MAX; ++f)
+        {
+            s = &nspl[insn * FENCE_MAX + f];
+
+            if (s->n == 0)
+            {
+                continue;
+            }
+
+            sprintf(name, "%s %s", insn_names[insn], fence_names[f]);
+            stats_compute(s, opts.outlier_mad);
+            stats_print(s, name, "ns");
+        }
+    }
+
+    rc = 0;
+
+error:
+    for (f = 0; f != FLUSH_INSN_MAX * FENCE_MAX; ++f)
+    {
+        stats_destroy(&nspl[f]);
+    }
+
+    free(buf);
+    return rc;
+}
+
+#endif
@@ -0,0 +1,32 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef FLUSH_H
+#define FLUSH_H 1
+
+#include <stddef.h>
+
+#include "config.h"
+
+#if HAVE_CLFLUSH
+
+enum flush_insn
+{
+    FLUSH_CLFLUSH,
+    FLUSH_CLFLUSHOPT,
+    FLUSH_CLWB,
+    FLUSH_INSN_MAX
+};
+
+int flush_has(enum flush_insn insn, unsigned int max, unsigned int d1,
+    unsigned int b7);
+size_t flush_line(unsigned int max, unsigned int b1);
+
+#endif
+
+int flush_bench(void);
+
+#endif
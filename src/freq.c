@@ -0,0 +1,199 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+
+#if HAVE_SCHED_GETCPU
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freq.h"
+#include "pmc.h"
+#include "utils.h"
+
+
+/* ==== Private functions =================================================== */
+
+
+#if HAVE_SCHED_GETCPU && HAVE_UNSIGNED_LONG_LONG_INT
+
+/* ==========================================================================
+    reads 'aperf' and 'mperf' of cpu that 'f' has open
+
+    returns:
+             0      both msrs read
+            -1      msr device is not open or couldn't be read
+   ========================================================================== */
+
+
+static int freq_read_msr
+(
+    struct freq  *f,      /* msr device to read */
+    tick_t       *aperf,  /* actual cycles will be stored here */
+    tick_t       *mperf   /* reference cycles will be stored here */
+)
+{
+    if (f->fd < 0)
+    {
+        return -1;
+    }
+
+    if (pread(f->fd, aperf, sizeof(*aperf), FREQ_MSR_APERF) !=
+            sizeof(*aperf) ||
+        pread(f->fd, mperf, sizeof(*mperf), FREQ_MSR_MPERF) !=
+            sizeof(*mperf))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+#endif
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    initializes 'f', msr device is opened later, for cpu that interval
+    starts on
+   ========================================================================== */
+
+
+void freq_open
+(
+    struct freq  *f  /* frequency meter to initialize */
+)
+{
+    memset(f, 0, sizeof(*f));
+    f->fd = -1;
+    f->cpu = -1;
+    f->source = "none";
+}
+
+
+/* ==========================================================================
+    marks start of interval.  When msr device of cpu we run on  can  be
+    read (needs root and msr module), aperf and mperf are remembered.
+   ========================================================================== */
+
+
+void freq_begin
+(
+    struct freq  *f         /* frequency meter */
+)
+{
+#if HAVE_SCHED_GETCPU && HAVE_UNSIGNED_LONG_LONG_INT
+    char          path[64]; /* path to msr device */
+    int           cpu;      /* cpu we are running on */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if ((cpu = sched_getcpu()) < 0)
+    {
+        f->valid = 0;
+        return;
+    }
+
+    if (cpu != f->cpu)
+    {
+        /*
+         * scheduler moved us since last interval, msrs are per cpu
+         */
+
+        freq_close(f);
+        sprintf(path, "/dev/cpu/%d/msr", cpu);
+        f->fd = open(path, O_RDONLY);
+        f->cpu = cpu;
+    }
+
+    f->valid = freq_read_msr(f, &f->aperf, &f->mperf) == 0;
+#else
+    f->valid = 0;
+#endif
+}
+
+
+/* ==========================================================================
+    marks end of interval that took 'sec' seconds of measured  time,  and
+    computes effective frequency of cpu during it, from the best  source
+    available:
+
+        msr     tsc frequency scaled by aperf/mperf ratio, that is average
+                frequency cpu really run at while it was not idle
+        pmc     cycles counted by hardware counters in 'pmc' during 'sec'
+        tsc     nominal tsc frequency, it does not follow frequency changes
+                but still gives bytes per reference cycle
+        none    frequency is not known, f->hz is 0
+   ========================================================================== */
+
+
+void freq_end
+(
+    struct freq       *f,      /* frequency meter */
+    double             sec,    /* measured time of interval */
+    const struct pmc  *pmc     /* counters of interval, or NULL */
+)
+{
+#if HAVE_SCHED_GETCPU && HAVE_UNSIGNED_LONG_LONG_INT
+    tick_t             aperf;  /* actual cycles on interval end */
+    tick_t             mperf;  /* reference cycles on interval end */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (f->valid && ts_tsc_hz() > 0 && sched_getcpu() == f->cpu &&
+        freq_read_msr(f, &aperf, &mperf) == 0 && mperf != f->mperf)
+    {
+        f->hz = ts_tsc_hz() * (double)(aperf - f->aperf) /
+            (double)(mperf - f->mperf);
+        f->source = "msr";
+        return;
+    }
+#endif
+
+    if (pmc && pmc->n && !pmc->sw && sec > 0)
+    {
+        /*
+         * cycles is always leader of hardware group
+         */
+
+        f->hz = pmc->val[0] / sec;
+        f->source = "pmc";
+        return;
+    }
+
+    f->hz = ts_tsc_hz();
+    f->source = f->hz > 0 ? "tsc" : "none";
+}
+
+
+/* ==========================================================================
+    closes msr device opened by 'f'
+   ========================================================================== */
+
+
+void freq_close
+(
+    struct freq  *f  /* frequency meter to close */
+)
+{
+#if HAVE_SCHED_GETCPU
+    if (f->fd >= 0)
+    {
+        close(f->fd);
+    }
+#endif
+
+    f->fd = -1;
+    f->cpu = -1;
+}
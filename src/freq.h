@@ -0,0 +1,37 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef FREQ_H
+#define FREQ_H 1
+
+#include "pmc.h"
+#include "utils.h"
+
+/*
+ * addresses of x86 msrs that count actual and reference cycles while cpu
+ * is in c0 state
+ */
+
+#define FREQ_MSR_MPERF 0xe7
+#define FREQ_MSR_APERF 0xe8
+
+struct freq
+{
+    int fd;             /* msr device of cpu, -1 if not open */
+    int cpu;            /* cpu that fd belongs to */
+    int valid;          /* aperf and mperf were read on interval start */
+    tick_t aperf;       /* actual cycles on interval start */
+    tick_t mperf;       /* reference cycles on interval start */
+    double hz;          /* effective frequency of last interval, or 0 */
+    const char *source; /* where hz came from: msr, pmc, tsc or none */
+};
+
+void freq_open(struct freq *f);
+void freq_begin(struct freq *f);
+void freq_end(struct freq *f, double sec, const struct pmc *pmc);
+void freq_close(struct freq *f);
+
+#endif
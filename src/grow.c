@@ -0,0 +1,455 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "grow.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_MREMAP
+#include <sys/mman.h>
+#endif
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * size of buffer before first growth, buffer then doubles until it reaches
+ * block size
+ */
+
+#define GROW_START 4096
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *method_names[GROW_MAX] =
+{
+    "realloc",
+    "memcpy",
+#if HAVE_MREMAP
+    "mremap"
+#endif
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    updates peak rss of result 'r' with current rss of the process
+   ========================================================================== */
+
+
+static void grow_peak
+(
+    struct grow_result  *r    /* result to update */
+)
+{
+    size_t               now; /* current rss */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    now = rss();
+
+    if (now > r->base && now - r->base > r->peak)
+    {
+        r->peak = now - r->base;
+    }
+}
+
+
+/* ==========================================================================
+    allocates initial buffer of GROW_START bytes for method 'm'
+   ========================================================================== */
+
+
+static void *grow_new
+(
+    enum grow_method  m  /* method that will be used to grow buffer */
+)
+{
+#if HAVE_MREMAP
+    void             *p; /* mapped memory */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (m == GROW_MREMAP)
+    {
+        p = mmap(NULL, GROW_START, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        return p == MAP_FAILED ? NULL : p;
+    }
+#else
+    (void)m;
+#endif
+
+    return malloc(GROW_START);
+}
+
+
+/* ==========================================================================
+    releases buffer 'p' of 'size' bytes allocated for method 'm'
+   ========================================================================== */
+
+
+static void grow_free
+(
+    enum grow_method  m,    /* method that was used to grow buffer */
+    void             *p,    /* buffer to free */
+    size_t            size  /* current size of the buffer */
+)
+{
+#if HAVE_MREMAP
+    if (m == GROW_MREMAP)
+    {
+        munmap(p, size);
+        return;
+    }
+#else
+    (void)m;
+#endif
+
+    (void)size;
+    free(p);
+}
+
+
+/* ==========================================================================
+    returns nan, value of field that is not known
+   ========================================================================== */
+
+
+static double grow_unknown(void)
+{
+    volatile double  zero;  /* keeps compiler from folding 0 / 0 */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    zero = 0;
+    return zero / zero;
+}
+
+
+/* ==========================================================================
+    prints result of growing buffer with method 'm'
+   ========================================================================== */
+
+
+static void grow_report
+(
+    unsigned long        intvl,      /* interval number, counted from 1 */
+    enum grow_method     m,          /* method that was used */
+    struct grow_result  *r           /* result of the method */
+)
+{
+    unsigned long        grow_us;    /* time spent on resizing */
+    unsigned long        fill_us;    /* time spent on writing data */
+    struct jedec         jd_moved;   /* bytes moved in jedec format */
+    struct jedec         jd_copied;  /* bytes copied in jedec format */
+    struct jedec         jd_peak;    /* peak rss in jedec format */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (!out_text())
+    {
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("name", method_names[m]);
+        out_double("grow_ns", ts2sec(&r->grow) * 1000000000.0);
+        out_double("total_ns",
+                   (ts2sec(&r->grow) + ts2sec(&r->fill)) * 1000000000.0);
+        out_ulong("moves", r->moves);
+        out_ulong("moved", (unsigned long)r->moved);
+
+        /*
+         * unknown for realloc, null in json and empty in csv
+         */
+
+        out_double("copied", m == GROW_REALLOC ?
+                   grow_unknown() : (double)r->copied);
+        out_ulong("peak_rss", (unsigned long)r->peak);
+        out_record_end();
+        return;
+    }
+
+    grow_us = ts2us(&r->grow);
+    fill_us = ts2us(&r->fill);
+    bytes2jedec(r->moved, &jd_moved);
+    bytes2jedec(r->copied, &jd_copied);
+    bytes2jedec(r->peak, &jd_peak);
+
+    printf("%-7s grow %7lu us, total %7lu us, moves %3lu, moved %5lu %cB, ",
+           method_names[m],
+           grow_us,
+           grow_us + fill_us,
+           r->moves,
+           jd_moved.val,
+           jd_moved.pre);
+
+    if (m == GROW_REALLOC)
+    {
+        printf("copied     ?   ");
+    }
+    else
+    {
+        printf("copied %5lu %cB", jd_copied.val, jd_copied.pre);
+    }
+
+    printf(", peak rss %5lu %cB\n", jd_peak.val, jd_peak.pre);
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    grows buffer from GROW_START to opts.block_size, doubling it each  step
+    like vector would, and writes each newly appended part so  it  becomes
+    resident.  Resize and write times are stored in 'r' separately.  Peak
+    rss is sampled after every resize, and for memcpy also when both old
+    and new buffers are alive.  Copy that realloc does internally is not
+    seen, so its peak is lower bound.
+
+    returns:
+             0      buffer has grown to block size
+            -1      system is out of memory
+   ========================================================================== */
+
+
+int grow_run
+(
+    enum grow_method     m,      /* method to grow buffer with */
+    struct grow_result  *r       /* results will be stored here */
+)
+{
+    unsigned char       *p;      /* buffer that is grown */
+    unsigned char       *np;     /* buffer after resize */
+    size_t               size;   /* current size of buffer */
+    size_t               nsize;  /* size of buffer after resize */
+    struct ts            start;  /* timer indicating operation start */
+    struct ts            finish; /* timer indicating operation finish */
+    int                  rc;     /* return code */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    p = NULL;
+
+    ts_reset(&r->grow);
+    ts_reset(&r->fill);
+    r->moves = 0;
+    r->moved = 0;
+    r->copied = 0;
+    r->peak = 0;
+    r->base = rss();
+
+    size = GROW_START;
+
+    if ((p = grow_new(m)) == NULL)
+    {
+        goto error;
+    }
+
+    ts(&start);
+    memset(p, 0x5a, size);
+    ts(&finish);
+    ts_add_diff(&r->fill, &start, &finish);
+
+    while (size < opts.block_size)
+    {
+        nsize = size * 2 < opts.block_size ? size * 2 : opts.block_size;
+
+        ts(&start);
+
+        switch (m)
+        {
+        case GROW_REALLOC:
+            np = realloc(p, nsize);
+            break;
+
+        case GROW_COPY:
+            if ((np = malloc(nsize)) != NULL)
+            {
+                memcpy(np, p, size);
+            }
+
+            break;
+
+#if HAVE_MREMAP
+        case GROW_MREMAP:
+            np = mremap(p, size, nsize, MREMAP_MAYMOVE);
+            np = (void *)np == MAP_FAILED ? NULL : np;
+            break;
+#endif
+
+        default:
+            np = NULL;
+        }
+
+        ts(&finish);
+        ts_add_diff(&r->grow, &start, &finish);
+
+        if (np == NULL)
+        {
+            goto error;
+        }
+
+        if (m == GROW_COPY)
+        {
+            /*
+             * this is the moment when both old and new buffers are  alive,
+             * so rss is at its highest
+             */
+
+            grow_peak(r);
+
+            ts(&start);
+            free(p);
+            ts(&finish);
+            ts_add_diff(&r->grow, &start, &finish);
+        }
+
+        /*
+         * mremap moves pages by changing page tables, data is not copied,
+         * and realloc may do either, so only memcpy is sure to copy
+         */
+
+        if (np != p)
+        {
+            ++r->moves;
+            r->moved += size;
+        }
+
+        if (m == GROW_COPY)
+        {
+            r->copied += size;
+        }
+
+        p = np;
+
+        ts(&start);
+        memset(p + size, 0x5a, nsize - size);
+        ts(&finish);
+        ts_add_diff(&r->fill, &start, &finish);
+
+        grow_peak(r);
+        size = nsize;
+    }
+
+    rc = 0;
+
+error:
+    if (p)
+    {
+        grow_free(m, p, size);
+    }
+
+    return rc;
+}
+
+
+/* ==========================================================================
+    measures cost of growing a buffer geometrically up  to  block  size,  as
+    vector or log buffer would, with realloc, with  malloc  +  memcpy  +
+    free, and with mremap when available.  For each method time spent  on
+    resizing, total time with writing appended data, bytes that  had  to
+    be copied and peak rss over rss from before the test are reported.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory
+   ========================================================================== */
+
+
+int grow_bench(void)
+{
+    struct grow_result  r;              /* result of single method */
+    struct stats        total[GROW_MAX];/* total time of each method in us */
+    double              sec;            /* total time of method in seconds */
+    unsigned long       i;              /* iterator for loop */
+    int                 m;              /* iterator for loop */
+    int                 rc;             /* return code */
+    struct jedec        jd_block_size;  /* block size in jedec format */
+    struct jedec        jd_start;       /* start size in jedec format */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    bytes2jedec(opts.block_size, &jd_block_size);
+    bytes2jedec(GROW_START, &jd_start);
+
+    for (m = 0; m != GROW_MAX; ++m)
+    {
+        stats_init(&total[m]);
+    }
+
+    if (out_text())
+    {
+        printf("grow from %lu %cB to %lu %cB, iterations %lu\n",
+               jd_start.val,
+               jd_start.pre,
+               jd_block_size.val,
+               jd_block_size.pre,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(total, GROW_MAX, i); ++i)
+    {
+        for (m = 0; m != GROW_MAX; ++m)
+        {
+            if (grow_run(m, &r) != 0)
+            {
+                fprintf(stderr, "Couldn't grow buffer with %s\n",
+                        method_names[m]);
+                goto error;
+            }
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            grow_report(i - opts.warmup + 1, m, &r);
+
+            sec = ts2sec(&r.grow) + ts2sec(&r.fill);
+
+            if (stats_add(&total[m], sec * 1000000) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of total time\n");
+    }
+
+    for (m = 0; m != GROW_MAX; ++m)
+    {
+        stats_compute(&total[m], opts.outlier_mad);
+        stats_print(&total[m], method_names[m], "us");
+    }
+
+    rc = 0;
+
+error:
+    for (m = 0; m != GROW_MAX; ++m)
+    {
+        stats_destroy(&total[m]);
+    }
+
+    return rc;
+}
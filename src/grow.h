@@ -0,0 +1,39 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef GROW_H
+#define GROW_H 1
+
+#include <stddef.h>
+
+#include "config.h"
+#include "utils.h"
+
+enum grow_method
+{
+    GROW_REALLOC,
+    GROW_COPY,
+#if HAVE_MREMAP
+    GROW_MREMAP,
+#endif
+    GROW_MAX
+};
+
+struct grow_result
+{
+    struct ts       grow;    /* time spent on resizing buffer */
+    struct ts       fill;    /* time spent on writing appended data */
+    unsigned long   moves;   /* number of times buffer changed address */
+    size_t          moved;   /* bytes in buffer, when it changed address */
+    size_t          copied;  /* bytes copied, not known for realloc */
+    size_t          base;    /* rss before test started */
+    size_t          peak;    /* biggest rss over base seen during test */
+};
+
+int grow_run(enum grow_method m, struct grow_result *r);
+int grow_bench(void);
+
+#endif
@@ -0,0 +1,215 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "hist.h"
+
+#include <string.h>
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    returns index of bucket in which value 'v' should be stored
+   ========================================================================== */
+
+
+static size_t hist_idx
+(
+    unsigned long  v  /* value to find bucket for */
+)
+{
+    unsigned       e; /* index of the most significant bit in 'v' */
+    unsigned long  m; /* HIST_SUB_BITS bits right after the msb */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (v < 2 * HIST_SUB)
+    {
+        return v;
+    }
+
+    for (e = HIST_SUB_BITS + 1; (v >> e) > 1; ++e);
+
+    m = (v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1);
+
+    return 2 * HIST_SUB + (e - HIST_SUB_BITS - 1) * HIST_SUB + m;
+}
+
+
+/* ==========================================================================
+    returns value that represents bucket 'i' - that is middle of the  range
+    of values that are stored in that bucket
+   ========================================================================== */
+
+
+static unsigned long hist_val
+(
+    size_t    i  /* index of the bucket */
+)
+{
+    unsigned  e; /* index of the most significant bit of bucket values */
+    size_t    m; /* linear sub bucket within power of two range */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (i < 2 * HIST_SUB)
+    {
+        return i;
+    }
+
+    e = (i - 2 * HIST_SUB) / HIST_SUB + HIST_SUB_BITS + 1;
+    m = (i - 2 * HIST_SUB) % HIST_SUB;
+
+    return ((unsigned long)(HIST_SUB + m) << (e - HIST_SUB_BITS)) +
+        (1ul << (e - HIST_SUB_BITS)) / 2;
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    clears histogram, so it can be used to record new set of values
+   ========================================================================== */
+
+
+void hist_reset
+(
+    struct hist  *h  /* histogram to reset */
+)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = (unsigned long)-1;
+}
+
+
+/* ==========================================================================
+    records single value 'v' in histogram 'h'
+   ========================================================================== */
+
+
+void hist_add
+(
+    struct hist    *h,  /* histogram to record value in */
+    unsigned long   v   /* value to record */
+)
+{
+    ++h->count[hist_idx(v)];
+    ++h->n;
+    h->sum += v;
+
+    if (v < h->min)
+    {
+        h->min = v;
+    }
+
+    if (v > h->max)
+    {
+        h->max = v;
+    }
+}
+
+
+/* ==========================================================================
+    adds all values recorded in 'src' into 'dst'
+   ========================================================================== */
+
+
+void hist_merge
+(
+    struct hist        *dst,  /* histogram to merge values into */
+    const struct hist  *src   /* histogram to take values from */
+)
+{
+    size_t              i;    /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 0; i != HIST_BUCKETS; ++i)
+    {
+        dst->count[i] += src->count[i];
+    }
+
+    dst->n += src->n;
+    dst->sum += src->sum;
+
+    if (src->min < dst->min)
+    {
+        dst->min = src->min;
+    }
+
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+}
+
+
+/* ==========================================================================
+    returns value below which 'pct' percent of recorded values  fall.   For
+    'pct' 0 and 100 exact minimum and maximum are returned, for  any  other
+    value result is accurate to the resolution of the histogram.  0 will be
+    returned when nothing has been recorded yet.
+   ========================================================================== */
+
+
+unsigned long hist_pct
+(
+    const struct hist  *h,     /* histogram to compute percentile from */
+    double              pct    /* percentile to compute 0 - 100 */
+)
+{
+    double              rank;  /* number of values that must fall below */
+    unsigned long       cum;   /* cumulative count of values */
+    unsigned long       v;     /* value of found bucket */
+    size_t              i;     /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (h->n == 0)
+    {
+        return 0;
+    }
+
+    if (pct <= 0)
+    {
+        return h->min;
+    }
+
+    if (pct >= 100)
+    {
+        return h->max;
+    }
+
+    rank = pct / 100 * h->n;
+
+    for (i = 0, cum = 0; i != HIST_BUCKETS; ++i)
+    {
+        if ((cum += h->count[i]) >= rank)
+        {
+            break;
+        }
+    }
+
+    v = hist_val(i);
+
+    /*
+     * middle of the bucket may be outside of values that were  really
+     * recorded, clamp it so p99 is never reported bigger than max
+     */
+
+    if (v < h->min)
+    {
+        return h->min;
+    }
+
+    if (v > h->max)
+    {
+        return h->max;
+    }
+
+    return v;
+}
@@ -0,0 +1,37 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef HIST_H
+#define HIST_H 1
+
+#include <limits.h>
+
+/*
+ * every power of two range is split into HIST_SUB linear buckets, so value
+ * stored in histogram is never off by more than 1/HIST_SUB of its value.
+ * Values smaller than 2 * HIST_SUB are stored exactly.
+ */
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (2 * HIST_SUB + \
+    (sizeof(unsigned long) * CHAR_BIT - HIST_SUB_BITS - 1) * HIST_SUB)
+
+struct hist
+{
+    unsigned long count[HIST_BUCKETS];
+    unsigned long n;
+    unsigned long min;
+    unsigned long max;
+    double sum;
+};
+
+void hist_reset(struct hist *h);
+void hist_add(struct hist *h, unsigned long v);
+void hist_merge(struct hist *dst, const struct hist *src);
+unsigned long hist_pct(const struct hist *h, double pct);
+
+#endif
@@ -0,0 +1,614 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "loaded.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+#if HAVE_PTHREAD_H
+
+
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * bytes read by bandwidth thread between delays
+ */
+
+#define LOADED_CHUNK 4096
+
+/*
+ * number of points on the curve, idle one is first
+ */
+
+#define LOADED_POINTS (sizeof(loaded_delays) / sizeof(*loaded_delays) + 1)
+
+
+/* ==== Private declarations ================================================ */
+
+
+struct loaded_thread
+{
+    unsigned char    *buf;      /* buffer thread reads */
+    unsigned long     delay;    /* spins between chunks */
+    double            bytes;    /* bytes read until stopped */
+    unsigned long     sum;      /* sum of read data, so reads are not lost */
+    volatile int     *stop;     /* set when latency probe is done */
+    struct barrier   *barrier;  /* starts all threads at once */
+    pthread_t         tid;      /* id of the thread */
+};
+
+
+/* ==== Private variables =================================================== */
+
+
+/*
+ * spins of delay loop after each chunk, from light load down to 0, which
+ * is as much bandwidth as threads can inject
+ */
+
+static const unsigned long loaded_delays[] =
+{
+    20000, 10000, 5000, 2500, 1200, 600, 300, 150, 50, 0
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    returns name of point 'p' on the curve, like "idle" or "delay 300",
+    in 'name'
+   ========================================================================== */
+
+
+static const char *loaded_name
+(
+    size_t   p,     /* point on the curve */
+    char    *name   /* buffer for the name */
+)
+{
+    if (p == 0)
+    {
+        return strcpy(name, "idle");
+    }
+
+    sprintf(name, "delay %lu", loaded_delays[p - 1]);
+    return name;
+}
+
+
+/* ==========================================================================
+    follows 'loads' pointers starting from 'p'.  Each load depends on the
+    previous one, so they can't overlap and time of the loop is latency.
+
+    returns:
+            pointer chase ended on, so compiler can't drop the loop
+   ========================================================================== */
+
+
+static void **loaded_chase
+(
+    void           **p,     /* start of the chain */
+    unsigned long    loads  /* number of loads to do */
+)
+{
+    while (loads--)
+    {
+        p = (void **)*p;
+    }
+
+    return p;
+}
+
+
+/* ==========================================================================
+    bandwidth thread, reads its buffer chunk by chunk, spinning  t->delay
+    times after each chunk, until latency probe is done
+   ========================================================================== */
+
+
+static void *loaded_worker
+(
+    void                  *arg   /* struct loaded_thread of this thread */
+)
+{
+    struct loaded_thread  *t;    /* this thread */
+    const unsigned long   *p;    /* current word */
+    const unsigned long   *end;  /* end of chunk */
+    volatile unsigned long k;    /* delay loop counter */
+    size_t                 off;  /* offset of chunk in buffer */
+    unsigned long          sum;  /* sum of read words */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    t = arg;
+    sum = 0;
+    off = 0;
+    barrier_wait(t->barrier);
+
+    while (!*t->stop)
+    {
+        p = (const unsigned long *)(t->buf + off);
+        end = (const unsigned long *)(t->buf + off + LOADED_CHUNK);
+
+        for (; p != end; ++p)
+        {
+            sum += *p;
+        }
+
+        t->bytes += LOADED_CHUNK;
+        off = off + 2 * LOADED_CHUNK > opts.block_size ? 0 :
+            off + LOADED_CHUNK;
+
+        for (k = t->delay; k; --k);
+    }
+
+    t->sum = sum;
+    return NULL;
+}
+
+
+/* ==========================================================================
+    initializes 'attr' of bandwidth threads.  They spin until probe is
+    done, so they get normal policy, and not SCHED_FIFO inherited from -q,
+    at which they would never give their cpu back to the probe.
+
+    returns:
+             0      attributes initialized
+            -1      couldn't initialize attributes
+   ========================================================================== */
+
+
+static int loaded_attr
+(
+    pthread_attr_t      *attr  /* attributes to initialize */
+)
+{
+#if defined(PTHREAD_EXPLICIT_SCHED) && defined(SCHED_OTHER)
+    struct sched_param   sp;   /* priority of normal policy */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+#endif
+
+    if (pthread_attr_init(attr) != 0)
+    {
+        return -1;
+    }
+
+#if defined(PTHREAD_EXPLICIT_SCHED) && defined(SCHED_OTHER)
+    memset(&sp, 0, sizeof(sp));
+
+    if (pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED) != 0 ||
+        pthread_attr_setschedpolicy(attr, SCHED_OTHER) != 0 ||
+        pthread_attr_setschedparam(attr, &sp) != 0)
+    {
+        pthread_attr_destroy(attr);
+        return -1;
+    }
+#endif
+
+    return 0;
+}
+
+
+/* ==========================================================================
+    measures one point of the curve.  'nthreads' bandwidth threads  read
+    with 'delay', while calling thread chases pointers  from  'chain'.   No
+    thread is started for idle point, when 'nthreads' is 0.
+
+    returns:
+             0      point measured, 'lat' and 'bw' are set
+            -1      couldn't create threads
+   ========================================================================== */
+
+
+static int loaded_point
+(
+    struct loaded_thread  *threads,   /* bandwidth threads */
+    unsigned long          nthreads,  /* number of bandwidth threads */
+    unsigned long          delay,     /* spins between chunks */
+    void                 **chain,     /* pointer chain to chase */
+    unsigned long          loads,     /* number of loads to do */
+    double                *lat,       /* latency of load in ns */
+    double                *bw         /* bandwidth of threads in MB/s */
+)
+{
+    struct barrier         barrier;   /* starts threads with the probe */
+    pthread_attr_t         attr;      /* attributes of threads */
+    volatile int           stop;      /* tells threads to stop */
+    struct ts              start;     /* timer indicating chase start */
+    struct ts              finish;    /* timer indicating chase finish */
+    struct ts              taken;     /* time taken by the chase */
+    double                 bytes;     /* bytes read by all threads */
+    double                 sec;       /* time taken in seconds */
+    unsigned long          n;         /* iterator for loop */
+    unsigned long          k;         /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (loaded_attr(&attr) != 0)
+    {
+        fprintf(stderr, "Couldn't initialize thread attributes\n");
+        return -1;
+    }
+
+    if (barrier_init(&barrier, nthreads + 1) != 0)
+    {
+        fprintf(stderr, "Couldn't initialize thread barrier\n");
+        pthread_attr_destroy(&attr);
+        return -1;
+    }
+
+    stop = 0;
+
+    for (n = 0; n != nthreads; ++n)
+    {
+        threads[n].delay = delay;
+        threads[n].bytes = 0;
+        threads[n].stop = &stop;
+        threads[n].barrier = &barrier;
+
+        if (pthread_create(&threads[n].tid, &attr, loaded_worker,
+                           &threads[n]) != 0)
+        {
+            /*
+             * threads that were already started wait for the rest on
+             * barrier, release them with stop already set, so they quit
+             * without reading anything
+             */
+
+            fprintf(stderr, "Couldn't create thread\n");
+            stop = 1;
+            barrier_resize(&barrier, n);
+
+            for (k = 0; k != n; ++k)
+            {
+                pthread_join(threads[k].tid, NULL);
+            }
+
+            barrier_destroy(&barrier);
+            pthread_attr_destroy(&attr);
+            return -1;
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+    barrier_wait(&barrier);
+
+    ts_reset(&taken);
+    ts(&start);
+    chain = loaded_chase(chain, loads);
+    ts(&finish);
+    ts_add_diff(&taken, &start, &finish);
+    stop = 1;
+
+    for (n = 0, bytes = 0; n != nthreads; ++n)
+    {
+        pthread_join(threads[n].tid, NULL);
+        bytes += threads[n].bytes;
+    }
+
+    barrier_destroy(&barrier);
+
+    /*
+     * chain is never NULL, this only keeps the chase from being optimized
+     * away
+     */
+
+    sec = ts2sec(&taken) + (chain == NULL);
+    sec = sec > 0 ? sec : 1e-9;
+    *lat = sec * 1000000000.0 / loads;
+    *bw = bytes / sec / (1024 * 1024);
+    return 0;
+}
+
+
+/* ==========================================================================
+    prints result of point 'p' of the curve
+   ========================================================================== */
+
+
+static void loaded_report
+(
+    unsigned long  intvl,    /* interval number, counted from 1 */
+    size_t         p,        /* point on the curve */
+    double         lat,      /* latency of load in ns */
+    double         bw        /* bandwidth of threads in MB/s */
+)
+{
+    char           name[32]; /* name of the point */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    loaded_name(p, name);
+
+    if (!out_text())
+    {
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("name", name);
+        out_ulong("delay", p ? loaded_delays[p - 1] : 0);
+        out_double("bandwidth_mbps", bw);
+        out_double("latency_ns", lat);
+        out_record_end();
+        return;
+    }
+
+    printf("%-11s bandwidth %8lu MB/s, latency %8.2f ns\n",
+           name,
+           (unsigned long)bw,
+           lat);
+}
+
+
+/* ==========================================================================
+    prints latency versus bandwidth curve from means of all intervals
+   ========================================================================== */
+
+
+static void loaded_curve
+(
+    const struct stats  *s         /* latency and bandwidth of each point */
+)
+{
+    char                 name[32]; /* name of the point */
+    size_t               p;        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (out_text())
+    {
+        printf("loaded latency curve\n");
+        printf("%-11s %14s %12s\n", "point", "bandwidth MB/s", "latency ns");
+    }
+
+    for (p = 0; p != LOADED_POINTS; ++p)
+    {
+        loaded_name(p, name);
+
+        if (!out_text())
+        {
+            out_record("curve");
+            out_str("name", name);
+            out_ulong("delay", p ? loaded_delays[p - 1] : 0);
+            out_double("bandwidth_mbps", s[2 * p + 1].mean);
+            out_double("latency_ns", s[2 * p].mean);
+            out_record_end();
+            continue;
+        }
+
+        printf("%-11s %14lu %12.2f\n",
+               name,
+               (unsigned long)s[2 * p + 1].mean,
+               s[2 * p].mean);
+    }
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    links cache lines of 'buf' into single cycle in random order,  so  the
+    chase defeats hardware prefetchers and every load misses.   Sattolo's
+    shuffle is used, as it always gives one cycle over all lines.
+
+    returns:
+            first pointer of the cycle
+   ========================================================================== */
+
+
+void **loaded_chain
+(
+    unsigned char  *buf,     /* buffer to link */
+    size_t          nlines   /* number of lines in buffer */
+)
+{
+    size_t         *order;   /* order in which lines are visited */
+    unsigned long   seed;    /* state of random generator */
+    size_t          i;       /* iterator for loop */
+    size_t          j;       /* line to swap with */
+    size_t          t;       /* temporary for swap */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if ((order = malloc(nlines * sizeof(*order))) == NULL)
+    {
+        return NULL;
+    }
+
+    for (i = 0; i != nlines; ++i)
+    {
+        order[i] = i;
+    }
+
+    seed = (unsigned long)time(NULL) | 1;
+
+    for (i = nlines - 1; i != 0; --i)
+    {
+        j = rnd(&seed) % i;
+        t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    for (i = 0; i != nlines; ++i)
+    {
+        *(void **)(buf + order[i] * LOADED_LINE) =
+            buf + order[(i + 1) % nlines] * LOADED_LINE;
+    }
+
+    free(order);
+    return (void **)buf;
+}
+
+
+/* ==========================================================================
+    measures loaded latency, like Intel MLC does.  Calling thread  chases
+    pointers through opts.block_size buffer in random order, while opts.threads
+    bandwidth threads read their own opts.block_size buffers, throttled  by
+    delay loop after every chunk.  Delay is swept from idle (no  bandwidth
+    threads) down to 0, so the curve goes up to saturation.  Each  interval
+    does about opts.report_intvl / LOADED_LINE loads on every point.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory or create threads
+   ========================================================================== */
+
+
+int loaded_bench(void)
+{
+    struct loaded_thread  *threads;       /* bandwidth threads */
+    struct stats           s[2 * LOADED_POINTS]; /* latency and bandwidth */
+    unsigned char         *buf;           /* buffer for the chase */
+    void                 **chain;         /* start of pointer chain */
+    char                   name[48];      /* name of configuration */
+    char                   pname[32];     /* name of point */
+    unsigned long          loads;         /* loads in single point */
+    unsigned long          n;             /* iterator for loop */
+    unsigned long          i;             /* iterator for loop */
+    size_t                 p;             /* iterator for loop */
+    double                 lat;           /* latency of load in ns */
+    double                 bw;            /* bandwidth of threads in MB/s */
+    int                    rc;            /* return code */
+    struct jedec           jd_block_size; /* block size in jedec format */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    threads = NULL;
+    buf = NULL;
+
+    for (p = 0; p != 2 * LOADED_POINTS; ++p)
+    {
+        stats_init(&s[p]);
+    }
+
+    if (opts.block_size < 2 * LOADED_CHUNK)
+    {
+        fprintf(stderr, "Block size must be at least %d bytes\n",
+                2 * LOADED_CHUNK);
+        goto error;
+    }
+
+    threads = calloc(opts.threads, sizeof(*threads));
+    buf = malloc(opts.block_size);
+
+    if (threads == NULL || buf == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+        goto error;
+    }
+
+    for (n = 0; n != opts.threads; ++n)
+    {
+        if ((threads[n].buf = malloc(opts.block_size)) == NULL)
+        {
+            fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+            goto error;
+        }
+
+        memset(threads[n].buf, (int)n, opts.block_size);
+    }
+
+    if ((chain = loaded_chain(buf, opts.block_size / LOADED_LINE)) == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+        goto error;
+    }
+
+    loads = opts.report_intvl / LOADED_LINE;
+    loads = loads ? loads : 1;
+    bytes2jedec(opts.block_size, &jd_block_size);
+
+    if (out_text())
+    {
+        printf("block size: %lu %cB, bandwidth threads %lu, loads %lu, "
+               "iterations %lu\n",
+               jd_block_size.val,
+               jd_block_size.pre,
+               opts.threads,
+               loads,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(s, 2 * LOADED_POINTS, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (p = 0; p != LOADED_POINTS; ++p)
+        {
+            if (loaded_point(threads, p ? opts.threads : 0,
+                             p ? loaded_delays[p - 1] : 0,
+                             chain, loads, &lat, &bw) != 0)
+            {
+                goto error;
+            }
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            loaded_report(i - opts.warmup + 1, p, lat, bw);
+
+            if (stats_add(&s[2 * p], lat) != 0 ||
+                stats_add(&s[2 * p + 1], bw) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of latency and bandwidth\n");
+    }
+
+    for (p = 0; p != LOADED_POINTS; ++p)
+    {
+        loaded_name(p, pname);
+        sprintf(name, "%s latency", pname);
+        stats_compute(&s[2 * p], opts.outlier_mad);
+        stats_print(&s[2 * p], name, "ns");
+
+        sprintf(name, "%s bandwidth", pname);
+        stats_compute(&s[2 * p + 1], opts.outlier_mad);
+        stats_print(&s[2 * p + 1], name, "MB/s");
+    }
+
+    loaded_curve(s);
+    rc = 0;
+
+error:
+    for (n = 0; threads && n != opts.threads; ++n)
+    {
+        free(threads[n].buf);
+    }
+
+    for (p = 0; p != 2 * LOADED_POINTS; ++p)
+    {
+        stats_destroy(&s[p]);
+    }
+
+    free(threads);
+    free(buf);
+    return rc;
+}
+
+#endif
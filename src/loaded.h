@@ -0,0 +1,22 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef LOADED_H
+#define LOADED_H 1
+
+#include <stddef.h>
+
+/*
+ * distance between pointers in chase buffer, every load goes to another
+ * cache line
+ */
+
+#define LOADED_LINE 64
+
+void **loaded_chain(unsigned char *buf, size_t nlines);
+int loaded_bench(void);
+
+#endif
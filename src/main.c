@@ -10,8 +10,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc.h"
+#include "atomic.h"
+#include "base.h"
 #include "bench.h"
+#include "flush.h"
+#include "grow.h"
+#include "loaded.h"
+#include "neighbour.h"
 #include "opts.h"
+#include "out.h"
+#include "overlap.h"
+#include "pcopy.h"
+#include "quiet.h"
+#include "replay.h"
+#include "roofline.h"
+#include "scale.h"
+#include "small.h"
+#include "utils.h"
+#include "zero.h"
 
 
 int main
@@ -42,6 +59,86 @@ int main
         return -rc;
     }
 
+    if (opts.baseline && base_load(opts.baseline) != 0)
+    {
+        return 1;
+    }
+
+    atexit(base_destroy);
+
+    /*
+     * out_end() closes machine readable output, no matter which way  the
+     * test exits
+     */
+
+    out_begin();
+    atexit(out_end);
+
+    /*
+     * quiet system before clock is calibrated, so calibration already
+     * runs on cpu that test will run on
+     */
+
+    if (opts.quiet)
+    {
+        quiet_setup();
+    }
+
+    ts_init();
+
+    switch (opts.test)
+    {
+    case TEST_ALLOC:
+        return base_status(alloc_bench());
+
+    case TEST_GROW:
+        return base_status(grow_bench());
+
+    case TEST_ZERO:
+        return base_status(zero_bench());
+
+    case TEST_OVERLAP:
+        return base_status(overlap_bench());
+
+    case TEST_ROOFLINE:
+        return base_status(roofline_bench());
+
+    case TEST_SMALL:
+        return base_status(small_bench());
+
+    case TEST_REPLAY:
+        return base_status(replay_bench());
+
+#if HAVE_CLFLUSH
+    case TEST_FLUSH:
+        return base_status(flush_bench());
+#endif
+
+#if HAVE_PTHREAD_H
+    case TEST_LOADED:
+        return base_status(loaded_bench());
+
+    case TEST_SCALE:
+        return base_status(scale_bench());
+
+    case TEST_PCOPY:
+        return base_status(pcopy_bench());
+#endif
+
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+    case TEST_ATOMIC:
+        return base_status(atomic_bench());
+#endif
+
+#if HAVE_FORK
+    case TEST_NEIGHBOUR:
+        return base_status(neighbour_bench());
+#endif
+
+    default:
+        break;
+    }
+
     dst = malloc(opts.block_size);
     src = malloc(opts.block_size);
 
@@ -51,10 +148,11 @@ int main
     if (dst == NULL || src == NULL || f1 == NULL || f2 == NULL)
     {
         fprintf(stderr, "Couldn't allocate requested memory block\n");
+        rc = -1;
         goto error;
     }
 
-    bench(dst, src, f1, f2);
+    rc = bench(dst, src, f1, f2);
 
 error:
     free(dst);
@@ -62,5 +160,5 @@ error:
     free(f1);
     free(f2);
 
-    return 0;
+    return base_status(rc);
 }
@@ -0,0 +1,1014 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/*
+ * fortified headers define mem functions as inline wrappers, that would
+ * collide with interposed ones defined here
+ */
+
+#undef _FORTIFY_SOURCE
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "memtrace.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tracehist.h"
+#include "utils.h"
+
+
+/* ==== Private declarations ================================================ */
+
+
+enum memtrace_fn
+{
+    FN_MEMCPY,
+    FN_MEMMOVE,
+    FN_MEMSET,
+    FN_MAX
+};
+
+struct memtrace_caller
+{
+    void           *pc;     /* address call was made from */
+    int             fn;     /* function that was called */
+    unsigned long   calls;  /* number of calls from 'pc' */
+    double          bytes;  /* bytes processed by calls from 'pc' */
+};
+
+/*
+ * counters of single thread.  They are mmaped, not allocated with malloc,
+ * which may call interposed functions.  When thread exits, its counters
+ * are merged into memtrace_all, zeroed and put on free list, to be  used
+ * by next thread that is started.
+ */
+
+struct memtrace_thread
+{
+    struct memtrace_thread  *next;       /* next counters of all threads */
+    struct memtrace_thread  *next_free;  /* next free counters */
+
+    /*
+     * calls of each function, by size bucket and alignment class
+     */
+
+    unsigned long            count[FN_MAX][MEMTRACE_SIZES][MEMTRACE_ALIGNS];
+    unsigned long            calls[FN_MAX];  /* calls of each function */
+    double                   bytes[FN_MAX];  /* bytes of each function */
+    tick_t                   ticks[FN_MAX];  /* time spent in function */
+    struct memtrace_caller   callers[MEMTRACE_CALLERS]; /* top callers */
+    unsigned long            lost;       /* calls that didn't fit callers */
+};
+
+typedef void *(*copy_fn)(void *, const void *, size_t);
+typedef void *(*set_fn)(void *, int, size_t);
+
+#ifdef __GLIBC__
+extern void __chk_fail(void);
+#endif
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *fn_names[FN_MAX] =
+{
+    "memcpy",
+    "memmove",
+    "memset"
+};
+
+static copy_fn real_memcpy;
+static copy_fn real_memmove;
+static set_fn real_memset;
+
+/*
+ * set while real functions are looked up, as dlsym() may copy memory on
+ * its own, and set at exit, after which nothing is counted anymore
+ */
+
+static int memtrace_resolving;
+static volatile int memtrace_off;
+
+/*
+ * counters of all threads that run now, or did run, and those  that  are
+ * free, counters of threads that exited, and number of threads that made
+ * a call.  memtrace_lock guards free list and memtrace_all.
+ */
+
+static struct memtrace_thread *memtrace_threads;
+static struct memtrace_thread *memtrace_free;
+static struct memtrace_thread memtrace_all;
+static unsigned long memtrace_nthreads;
+static volatile int memtrace_lock;
+
+/*
+ * key that calls memtrace_thread_exit() when thread exits, set when key
+ * could be created
+ */
+
+static pthread_key_t memtrace_key;
+static int memtrace_key_ok;
+
+/*
+ * counters of this thread, and flag that stops thread from counting its
+ * calls, while counters are being created, or after  they  were  given
+ * back.  initial-exec model keeps tls access from calling into libc.
+ */
+
+static __thread struct memtrace_thread *memtrace_self
+    __attribute__((tls_model("initial-exec")));
+static __thread int memtrace_busy
+    __attribute__((tls_model("initial-exec")));
+
+/*
+ * timer and wall clock at load time, to turn ticks into time at exit
+ */
+
+static tick_t memtrace_tick0;
+static double memtrace_sec0;
+
+/*
+ * copy of stderr, taken at load time, as programs may close stderr  in
+ * their atexit handlers, which run before we write report
+ */
+
+static int memtrace_stderr = -1;
+
+static char memtrace_buf[1024];
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    returns current value of timer.  Unlike memperf timers, tsc is  read
+    without fences, so it costs as little as possible in hot path.
+   ========================================================================== */
+
+
+static tick_t memtrace_tick(void)
+{
+#if HAVE_RDTSC
+    unsigned  lo;  /* lower 32 bits of counter */
+    unsigned  hi;  /* upper 32 bits of counter */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return (tick_t)hi << 32 | lo;
+#elif HAVE_CLOCK_GETTIME
+    struct timespec  tp;  /* current time */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (tick_t)tp.tv_sec * 1000000000 + tp.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+
+/* ==========================================================================
+    returns wall clock in seconds, from unspecified point in time
+   ========================================================================== */
+
+
+static double memtrace_sec(void)
+{
+#if HAVE_CLOCK_GETTIME
+    struct timespec  tp;  /* current time */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec + tp.tv_nsec / 1e9;
+#else
+    return (double)time(NULL);
+#endif
+}
+
+
+/* ==========================================================================
+    copies memory byte by byte, also when regions overlap.  Used only until
+    real functions are found.  Pointers are volatile, so compiler doesn't
+    turn the loop back into a call to memcpy.
+   ========================================================================== */
+
+
+static void *memtrace_bbb
+(
+    void                    *dst,  /* where to copy */
+    const void              *src,  /* what to copy */
+    size_t                   n     /* number of bytes to copy */
+)
+{
+    volatile unsigned char  *d;    /* 'dst' as bytes */
+    const unsigned char     *s;    /* 'src' as bytes */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    d = dst;
+    s = src;
+
+    if ((const void *)d < src)
+    {
+        while (n--)
+        {
+            *d++ = *s++;
+        }
+    }
+    else
+    {
+        while (n--)
+        {
+            d[n] = s[n];
+        }
+    }
+
+    return dst;
+}
+
+
+/* ==========================================================================
+    fills memory byte by byte, used only until real functions are found
+   ========================================================================== */
+
+
+static void *memtrace_fill
+(
+    void                    *dst,  /* memory to fill */
+    int                      c,    /* value to fill with */
+    size_t                   n     /* number of bytes to fill */
+)
+{
+    volatile unsigned char  *d;    /* 'dst' as bytes */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (d = dst; n--; ++d)
+    {
+        *d = (unsigned char)c;
+    }
+
+    return dst;
+}
+
+
+/* ==========================================================================
+    looks up real functions, that are next in search order after us
+   ========================================================================== */
+
+
+static void memtrace_resolve(void)
+{
+    if (memtrace_resolving)
+    {
+        return;
+    }
+
+    memtrace_resolving = 1;
+    *(void **)&real_memcpy = dlsym(RTLD_NEXT, "memcpy");
+    *(void **)&real_memmove = dlsym(RTLD_NEXT, "memmove");
+    *(void **)&real_memset = dlsym(RTLD_NEXT, "memset");
+    memtrace_resolving = 0;
+}
+
+
+/* ==========================================================================
+    spins until memtrace_lock is taken.  Lock is held only while threads
+    start, exit, and at exit, so it is never contended in hot path.
+   ========================================================================== */
+
+
+static void memtrace_lock_take(void)
+{
+    while (__sync_lock_test_and_set(&memtrace_lock, 1))
+    {
+        while (memtrace_lock);
+    }
+}
+
+
+/* ==========================================================================
+    releases memtrace_lock
+   ========================================================================== */
+
+
+static void memtrace_lock_give(void)
+{
+    __sync_lock_release(&memtrace_lock);
+}
+
+
+/* ==========================================================================
+    returns counters of calling thread.  On the first call, they are taken
+    from free list, or created when it is empty.  mmap() doesn't copy
+    memory, but thread is marked as busy anyway, so counters are never
+    created twice.
+
+    returns:
+            counters of thread, or NULL when they couldn't be created, or
+            thread already gave them back
+   ========================================================================== */
+
+
+static struct memtrace_thread *memtrace_thread(void)
+{
+    struct memtrace_thread  *t;  /* counters of thread */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (memtrace_self || memtrace_busy)
+    {
+        return memtrace_self;
+    }
+
+    memtrace_busy = 1;
+    memtrace_lock_take();
+
+    if ((t = memtrace_free) != NULL)
+    {
+        memtrace_free = t->next_free;
+    }
+
+    memtrace_lock_give();
+
+    if (t == NULL)
+    {
+        t = mmap(NULL, sizeof(*t), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (t == MAP_FAILED)
+        {
+            /*
+             * thread stays busy, and its calls are never counted
+             */
+
+            return NULL;
+        }
+
+        do
+        {
+            t->next = memtrace_threads;
+        }
+        while (!__sync_bool_compare_and_swap(&memtrace_threads, t->next, t));
+    }
+
+    /*
+     * without key, counters are not given back when thread exits, but they
+     * are still counted at exit
+     */
+
+    if (memtrace_key_ok)
+    {
+        pthread_setspecific(memtrace_key, t);
+    }
+
+    __sync_fetch_and_add(&memtrace_nthreads, 1);
+    memtrace_self = t;
+    memtrace_busy = 0;
+    return t;
+}
+
+
+/* ==========================================================================
+    adds 'calls' and 'bytes' of 'fn' called from 'pc', to 'callers' table
+    of 'size' slots, probing up to 'probes' slots.
+
+    returns:
+             0      call added
+            -1      there was no free slot for caller
+   ========================================================================== */
+
+
+static int memtrace_caller_add
+(
+    struct memtrace_caller  *callers,  /* table of callers */
+    size_t                   size,     /* slots in 'callers' */
+    size_t                   probes,   /* max slots to probe */
+    void                    *pc,       /* address of caller */
+    int                      fn,       /* called function */
+    unsigned long            calls,    /* number of calls to add */
+    double                   bytes     /* number of bytes to add */
+)
+{
+    struct memtrace_caller  *c;        /* current slot */
+    size_t                   h;        /* first slot to probe */
+    size_t                   i;        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    h = ((size_t)pc >> 2) * 31 + fn;
+
+    for (i = 0; i != probes; ++i)
+    {
+        c = &callers[(h + i) % size];
+
+        if (c->pc == NULL)
+        {
+            c->pc = pc;
+            c->fn = fn;
+        }
+
+        if (c->pc == pc && c->fn == fn)
+        {
+            c->calls += calls;
+            c->bytes += bytes;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+/* ==========================================================================
+    adds counters 'from' to counters 'to'
+   ========================================================================== */
+
+
+static void memtrace_merge
+(
+    struct memtrace_thread        *to,    /* counters to add to */
+    const struct memtrace_thread  *from   /* counters to add */
+)
+{
+    size_t                         b;     /* current size bucket */
+    size_t                         i;     /* iterator for loop */
+    int                            a;     /* current alignment class */
+    int                            fn;    /* current function */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (fn = 0; fn != FN_MAX; ++fn)
+    {
+        for (b = 0; b != MEMTRACE_SIZES; ++b)
+        {
+            for (a = 0; a != MEMTRACE_ALIGNS; ++a)
+            {
+                to->count[fn][b][a] += from->count[fn][b][a];
+            }
+        }
+
+        to->calls[fn] += from->calls[fn];
+        to->bytes[fn] += from->bytes[fn];
+        to->ticks[fn] += from->ticks[fn];
+    }
+
+    for (i = 0; i != MEMTRACE_CALLERS; ++i)
+    {
+        if (from->callers[i].pc && memtrace_caller_add(to->callers,
+            MEMTRACE_CALLERS, MEMTRACE_CALLERS, from->callers[i].pc,
+            from->callers[i].fn, from->callers[i].calls,
+            from->callers[i].bytes))
+        {
+            to->lost += from->callers[i].calls;
+        }
+    }
+
+    to->lost += from->lost;
+}
+
+
+/* ==========================================================================
+    called when thread exits, merges its counters 'arg' into memtrace_all
+    and puts them, zeroed, on free list.  Calls thread makes after that,
+    from other destructors, are not counted.
+   ========================================================================== */
+
+
+static void memtrace_thread_exit
+(
+    void                    *arg   /* counters of exiting thread */
+)
+{
+    struct memtrace_thread  *t;    /* counters of exiting thread */
+    struct memtrace_thread  *next; /* next counters on the list */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    t = arg;
+    memtrace_busy = 1;
+    memtrace_self = NULL;
+
+    memtrace_lock_take();
+
+    if (!memtrace_off)
+    {
+        memtrace_merge(&memtrace_all, t);
+
+        /*
+         * link to list of all counters must survive zeroing
+         */
+
+        next = t->next;
+        real_memset(t, 0, sizeof(*t));
+        t->next = next;
+        t->next_free = memtrace_free;
+        memtrace_free = t;
+    }
+
+    memtrace_lock_give();
+}
+
+
+/* ==========================================================================
+    called in child after fork.  Child inherits counters of parent, which
+    parent reports itself, so they are all zeroed, and child starts  with
+    clean report.  Only calling thread exists in child, counters of other
+    threads are put on free list, and lock, which another thread of parent
+    may have held, is released.
+   ========================================================================== */
+
+
+static void memtrace_fork_child(void)
+{
+    struct memtrace_thread  *t;     /* current counters */
+    struct memtrace_thread  *next;  /* next counters on the list */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    memtrace_lock = 0;
+    memtrace_free = NULL;
+    memtrace_nthreads = 0;
+    real_memset(&memtrace_all, 0, sizeof(memtrace_all));
+
+    for (t = memtrace_threads; t; t = next)
+    {
+        next = t->next;
+        real_memset(t, 0, sizeof(*t));
+        t->next = next;
+
+        if (t != memtrace_self)
+        {
+            t->next_free = memtrace_free;
+            memtrace_free = t;
+        }
+    }
+
+    if (memtrace_self)
+    {
+        if (memtrace_key_ok)
+        {
+            pthread_setspecific(memtrace_key, memtrace_self);
+        }
+
+        memtrace_nthreads = 1;
+    }
+
+    memtrace_tick0 = memtrace_tick();
+    memtrace_sec0 = memtrace_sec();
+}
+
+
+/* ==========================================================================
+    calls real function 'fn'
+   ========================================================================== */
+
+
+static void *memtrace_real
+(
+    int          fn,   /* function to call */
+    void        *dst,  /* destination */
+    const void  *src,  /* source, for copies */
+    int          c,    /* value to fill with, for memset */
+    size_t       n     /* number of bytes */
+)
+{
+    switch (fn)
+    {
+    case FN_MEMCPY:
+        return real_memcpy(dst, src, n);
+
+    case FN_MEMMOVE:
+        return real_memmove(dst, src, n);
+
+    default:
+        return real_memset(dst, c, n);
+    }
+}
+
+
+/* ==========================================================================
+    calls real function 'fn' and counts the call in counters of  calling
+    thread.  Until real functions are found, byte by byte versions  are
+    used, and calls are not counted.
+   ========================================================================== */
+
+
+static void *memtrace_call
+(
+    int                      fn,   /* function to call */
+    void                    *dst,  /* destination */
+    const void              *src,  /* source, for copies */
+    int                      c,    /* value to fill with, for memset */
+    size_t                   n,    /* number of bytes */
+    void                    *pc    /* address of caller */
+)
+{
+    struct memtrace_thread  *t;    /* counters of calling thread */
+    tick_t                   t0;   /* timer before call */
+    tick_t                   t1;   /* timer after call */
+    void                    *r;    /* return value of real function */
+    size_t                   b;    /* size bucket of call */
+    int                      a;    /* alignment class of call */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (real_memcpy == NULL || real_memmove == NULL || real_memset == NULL)
+    {
+        memtrace_resolve();
+
+        if (real_memcpy == NULL || real_memmove == NULL ||
+            real_memset == NULL)
+        {
+            return fn == FN_MEMSET ?
+                memtrace_fill(dst, c, n) : memtrace_bbb(dst, src, n);
+        }
+    }
+
+    if (memtrace_off || (t = memtrace_thread()) == NULL)
+    {
+        return memtrace_real(fn, dst, src, c, n);
+    }
+
+    t0 = memtrace_tick();
+    r = memtrace_real(fn, dst, src, c, n);
+    t1 = memtrace_tick();
+
+    /*
+     * copies are as aligned as the less aligned of their pointers
+     */
+
+    b = tracehist_bucket(n);
+    a = tracehist_align(fn == FN_MEMSET ?
+                        (size_t)dst : (size_t)dst | (size_t)src);
+
+    t->count[fn][b][a]++;
+    t->calls[fn]++;
+    t->bytes[fn] += n;
+    t->ticks[fn] += t1 - t0;
+
+    if (memtrace_caller_add(t->callers, MEMTRACE_CALLERS, 8, pc, fn, 1, n))
+    {
+        t->lost++;
+    }
+
+    return r;
+}
+
+
+/* ==========================================================================
+    formats message and writes it to 'fd'.  Output doesn't go through stdio
+    buffers, which may be already gone at exit.
+   ========================================================================== */
+
+
+static void memtrace_print
+(
+    int          fd,   /* file to write to */
+    const char  *fmt,  /* format of message */
+    ...                /* arguments of format */
+)
+{
+    va_list      ap;   /* arguments of format */
+    int          n;    /* length of message */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    va_start(ap, fmt);
+    n = vsprintf(memtrace_buf, fmt, ap);
+    va_end(ap);
+
+    if (n > 0)
+    {
+        (void)write(fd, memtrace_buf, n);
+    }
+}
+
+
+/* ==========================================================================
+    prints up to MEMTRACE_TOP callers with most calls from 'callers',  with
+    symbol names when they can be found
+   ========================================================================== */
+
+
+static void memtrace_callers
+(
+    int                      fd,       /* file to write to */
+    struct memtrace_caller  *callers,  /* all callers, destroyed */
+    size_t                   size      /* slots in 'callers' */
+)
+{
+    struct memtrace_caller  *top;      /* caller with most calls */
+#if HAVE_DLADDR
+    Dl_info                  info;     /* symbol of caller */
+#endif
+    size_t                   i;        /* iterator for loop */
+    int                      k;        /* number of printed callers */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    memtrace_print(fd, "# top callers\n# %-8s %14s %16s  %s\n",
+                   "function", "calls", "bytes", "caller");
+
+    for (k = 0; k != MEMTRACE_TOP; ++k)
+    {
+        for (i = 0, top = NULL; i != size; ++i)
+        {
+            if (callers[i].calls && (top == NULL ||
+                callers[i].calls > top->calls))
+            {
+                top = &callers[i];
+            }
+        }
+
+        if (top == NULL)
+        {
+            break;
+        }
+
+        memtrace_print(fd, "# %-8s %14lu %16.0f  %p",
+                       fn_names[top->fn], top->calls, top->bytes, top->pc);
+
+#if HAVE_DLADDR
+        if (dladdr(top->pc, &info) && info.dli_fname)
+        {
+            if (info.dli_sname)
+            {
+                memtrace_print(fd, " %.256s+0x%lx",
+                               info.dli_sname,
+                               (unsigned long)((char *)top->pc -
+                                               (char *)info.dli_saddr));
+            }
+
+            memtrace_print(fd, " (%.512s)", info.dli_fname);
+        }
+#endif
+
+        memtrace_print(fd, "\n");
+        top->calls = 0;
+    }
+}
+
+
+/* ==========================================================================
+    looks up real functions, creates key that gives counters back when
+    thread exits, makes forked child start with clean counters, and starts
+    the clock, when library is loaded
+   ========================================================================== */
+
+
+static void memtrace_init(void) __attribute__((constructor));
+static void memtrace_init(void)
+{
+    memtrace_resolve();
+    memtrace_key_ok =
+        pthread_key_create(&memtrace_key, memtrace_thread_exit) == 0;
+    pthread_atfork(NULL, NULL, memtrace_fork_child);
+    memtrace_stderr = dup(STDERR_FILENO);
+    memtrace_tick0 = memtrace_tick();
+    memtrace_sec0 = memtrace_sec();
+}
+
+
+/* ==========================================================================
+    merges counters of threads that still run into counters of those that
+    exited, and writes report at exit.  Report goes to MEMTRACE_ENV_OUT.<pid>
+    file, or to stderr when variable isn't set.  Every line is a comment,
+    except for size, alignment and count lines of memcpy and memmove,  so
+    report can be given to memperf -treplay -u.
+   ========================================================================== */
+
+
+static void memtrace_dump(void) __attribute__((destructor));
+static void memtrace_dump(void)
+{
+    struct memtrace_thread  *all;      /* counters of all threads */
+    struct memtrace_thread  *t;        /* current thread */
+    unsigned long            cnt;      /* count of current bucket */
+    unsigned long            zero;     /* copies of 0 bytes */
+    const char              *out;      /* path of report */
+    char                     path[1024]; /* path of report with pid */
+    char                     line[TRACEHIST_LINE_MAX]; /* histogram line */
+    double                   sec;      /* time since load */
+    double                   hz;       /* frequency of timer */
+    size_t                   b;        /* current size bucket */
+    int                      a;        /* current alignment class */
+    int                      fn;       /* current function */
+    int                      fd;       /* file to write report to */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    sec = memtrace_sec() - memtrace_sec0;
+    hz = sec > 0 ? (memtrace_tick() - memtrace_tick0) / sec : 0;
+    all = &memtrace_all;
+
+    /*
+     * counters on free list are zeroed, so they add nothing.  Threads that
+     * exit from now on, keep their counters.
+     */
+
+    memtrace_lock_take();
+    memtrace_off = 1;
+
+    for (t = memtrace_threads; t; t = t->next)
+    {
+        memtrace_merge(all, t);
+    }
+
+    memtrace_lock_give();
+
+    fd = memtrace_stderr;
+
+    if ((out = getenv(MEMTRACE_ENV_OUT)) != NULL)
+    {
+        sprintf(path, "%.1000s.%lu", out, (unsigned long)getpid());
+
+        if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        {
+            fd = memtrace_stderr;
+        }
+    }
+
+    memtrace_print(fd, "# memtrace of pid %lu, %lu threads, %.3f s\n",
+                   (unsigned long)getpid(), memtrace_nthreads, sec);
+    memtrace_print(fd, "# %-8s %14s %16s %12s %10s\n",
+                   "function", "calls", "bytes", "time ms", "ns/call");
+
+    for (fn = 0; fn != FN_MAX; ++fn)
+    {
+        memtrace_print(fd, "# %-8s %14lu %16.0f %12.3f %10.1f\n",
+                       fn_names[fn],
+                       all->calls[fn],
+                       all->bytes[fn],
+                       hz > 0 ? all->ticks[fn] / hz * 1e3 : 0,
+                       hz > 0 && all->calls[fn] ?
+                       all->ticks[fn] / hz * 1e9 / all->calls[fn] : 0);
+    }
+
+    memtrace_print(fd, "# time is summed over threads\n");
+    memtrace_callers(fd, all->callers, MEMTRACE_CALLERS);
+
+    if (all->lost)
+    {
+        memtrace_print(fd, "# %lu calls came from callers, that didn't fit "
+                       "in table\n", all->lost);
+    }
+
+    memtrace_print(fd, "# memcpy and memmove as size, alignment and count, "
+                   "size is lower bound of bucket\n");
+
+    for (b = 0, zero = 0; b != MEMTRACE_SIZES; ++b)
+    {
+        for (a = 0; a != MEMTRACE_ALIGNS; ++a)
+        {
+            cnt = all->count[FN_MEMCPY][b][a] + all->count[FN_MEMMOVE][b][a];
+
+            if (b == 0)
+            {
+                zero += cnt;
+            }
+            else if (cnt)
+            {
+                tracehist_line(line, b, a, cnt);
+                memtrace_print(fd, "%s", line);
+            }
+        }
+    }
+
+    if (zero)
+    {
+        memtrace_print(fd, "# %lu copies of 0 bytes are not listed\n", zero);
+    }
+
+    memtrace_print(fd, "# memset as size, alignment and count\n");
+
+    for (b = 0; b != MEMTRACE_SIZES; ++b)
+    {
+        for (a = 0; a != MEMTRACE_ALIGNS; ++a)
+        {
+            if (all->count[FN_MEMSET][b][a])
+            {
+                tracehist_line(line, b, a, all->count[FN_MEMSET][b][a]);
+                memtrace_print(fd, "# %s", line);
+            }
+        }
+    }
+
+    if (fd != memtrace_stderr)
+    {
+        close(fd);
+    }
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    interposed functions, they do what libc ones do, and count the call
+   ========================================================================== */
+
+
+void *memcpy
+(
+    void        *dst,  /* where to copy */
+    const void  *src,  /* what to copy */
+    size_t       n     /* number of bytes to copy */
+)
+{
+    return memtrace_call(FN_MEMCPY, dst, src, 0, n,
+                         __builtin_return_address(0));
+}
+
+
+void *memmove
+(
+    void        *dst,  /* where to copy */
+    const void  *src,  /* what to copy */
+    size_t       n     /* number of bytes to copy */
+)
+{
+    return memtrace_call(FN_MEMMOVE, dst, src, 0, n,
+                         __builtin_return_address(0));
+}
+
+
+void *memset
+(
+    void        *dst,  /* memory to fill */
+    int          c,    /* value to fill with */
+    size_t       n     /* number of bytes to fill */
+)
+{
+    return memtrace_call(FN_MEMSET, dst, NULL, c, n,
+                         __builtin_return_address(0));
+}
+
+
+#ifdef __GLIBC__
+
+/* ==========================================================================
+    checked versions, that binaries built with _FORTIFY_SOURCE call.  libc
+    calls its own copy of function from them, which we couldn't see.
+   ========================================================================== */
+
+
+void *__memcpy_chk
+(
+    void        *dst,     /* where to copy */
+    const void  *src,     /* what to copy */
+    size_t       n,       /* number of bytes to copy */
+    size_t       dstlen   /* size of 'dst' */
+)
+{
+    if (n > dstlen)
+    {
+        __chk_fail();
+    }
+
+    return memtrace_call(FN_MEMCPY, dst, src, 0, n,
+                         __builtin_return_address(0));
+}
+
+
+void *__memmove_chk
+(
+    void        *dst,     /* where to copy */
+    const void  *src,     /* what to copy */
+    size_t       n,       /* number of bytes to copy */
+    size_t       dstlen   /* size of 'dst' */
+)
+{
+    if (n > dstlen)
+    {
+        __chk_fail();
+    }
+
+    return memtrace_call(FN_MEMMOVE, dst, src, 0, n,
+                         __builtin_return_address(0));
+}
+
+
+void *__memset_chk
+(
+    void        *dst,     /* memory to fill */
+    int          c,       /* value to fill with */
+    size_t       n,       /* number of bytes to fill */
+    size_t       dstlen   /* size of 'dst' */
+)
+{
+    if (n > dstlen)
+    {
+        __chk_fail();
+    }
+
+    return memtrace_call(FN_MEMSET, dst, NULL, c, n,
+                         __builtin_return_address(0));
+}
+
+#endif
@@ -0,0 +1,43 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef MEMTRACE_H
+#define MEMTRACE_H 1
+
+/*
+ * sizes up to MEMTRACE_EXACT are counted each on its own, bigger ones in
+ * MEMTRACE_SUBS buckets per power of 2, up to 2^(MEMTRACE_OCTAVES + 8)
+ */
+
+#define MEMTRACE_EXACT 256
+#define MEMTRACE_OCTAVES 32
+#define MEMTRACE_SUBS 4
+#define MEMTRACE_SIZES \
+    (MEMTRACE_EXACT + 1 + MEMTRACE_OCTAVES * MEMTRACE_SUBS)
+
+/*
+ * alignments of 1, 2, 4... up to 64 bytes, anything more aligned than
+ * cache line is counted as 64
+ */
+
+#define MEMTRACE_ALIGNS 7
+
+/*
+ * slots for callers in table of each thread, and number of them printed
+ * at exit
+ */
+
+#define MEMTRACE_CALLERS 1024
+#define MEMTRACE_TOP 20
+
+/*
+ * environment variable with path of file, report is written to, stderr
+ * is used when it is not set
+ */
+
+#define MEMTRACE_ENV_OUT "MEMTRACE_OUT"
+
+#endif
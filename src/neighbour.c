@@ -0,0 +1,671 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "neighbour.h"
+
+#if HAVE_FORK
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#if (HAVE_SCHED_GETCPU && HAVE_SCHED_SETAFFINITY) || HAVE_SCHED_SETSCHEDULER
+#include <sched.h>
+#endif
+
+#if HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist.h"
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+#if HAVE_FORK
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *flood_names[FLOOD_MAX] =
+{
+    "none",
+    "read",
+    "write",
+    "copy"
+};
+
+/*
+ * read flood stores its sum here, so reads can't be optimized away
+ */
+
+static volatile unsigned long neighbour_sink;
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    floods memory with 'flood' until process is killed.  Runs in forked
+    aggressor process, and never returns.
+   ========================================================================== */
+
+
+static void neighbour_aggressor
+(
+    enum neighbour_flood    flood,  /* what to flood memory with */
+    unsigned char          *buf     /* NEIGHBOUR_FLOOD_SIZE buffer */
+)
+{
+    const unsigned long    *p;      /* current word */
+    const unsigned long    *end;    /* end of buffer */
+    unsigned long           sum;    /* sum of read words */
+    int                     c;      /* byte to write */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    end = (const unsigned long *)(buf + NEIGHBOUR_FLOOD_SIZE);
+
+    for (c = 0;; ++c)
+    {
+        switch (flood)
+        {
+        case FLOOD_READ:
+            for (p = (const unsigned long *)buf, sum = 0; p != end; ++p)
+            {
+                sum += *p;
+            }
+
+            neighbour_sink = sum;
+            break;
+
+        case FLOOD_WRITE:
+            memset(buf, c, NEIGHBOUR_FLOOD_SIZE);
+            break;
+
+        case FLOOD_COPY:
+            memcpy(buf + NEIGHBOUR_FLOOD_SIZE / 2, buf,
+                   NEIGHBOUR_FLOOD_SIZE / 2);
+            break;
+
+        default:
+            _exit(0);
+        }
+    }
+}
+
+
+/* ==========================================================================
+    copies opts.report_intvl bytes in opts.block_size blocks with opts.method,
+    adding time of each block to 'lat'
+
+    returns:
+            time taken by all copies in seconds
+   ========================================================================== */
+
+
+static double neighbour_victim
+(
+    unsigned char  *dst,     /* destination of copy */
+    unsigned char  *src,     /* source of copy */
+    struct hist    *lat      /* time of each block in ns */
+)
+{
+    struct ts       start;   /* timer indicating block start */
+    struct ts       finish;  /* timer indicating block finish */
+    struct ts       taken;   /* time taken by all blocks */
+    struct ts       block;   /* time taken by single block */
+    size_t          loops;   /* number of blocks to copy */
+    size_t          j;       /* iterator for loop */
+    size_t          k;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    loops = opts.report_intvl / opts.block_size;
+    loops = loops ? loops : 1;
+    ts_reset(&taken);
+
+    for (j = 0; j != loops; ++j)
+    {
+        ts(&start);
+
+        if (opts.method == METHOD_BBB)
+        {
+            for (k = 0; k != opts.block_size; ++k)
+            {
+                dst[k] = src[k];
+            }
+        }
+        else
+        {
+            memcpy(dst, src, opts.block_size);
+        }
+
+        ts(&finish);
+        ts_add_diff(&taken, &start, &finish);
+        ts_reset(&block);
+        ts_add_diff(&block, &start, &finish);
+        hist_add(lat, ts2ns(&block));
+    }
+
+    return ts2sec(&taken);
+}
+
+
+/* ==========================================================================
+    prints result of victim run next to aggressors flooding with 'flood'
+   ========================================================================== */
+
+
+static void neighbour_report
+(
+    unsigned long          intvl,  /* interval number, counted from 1 */
+    enum neighbour_flood   flood,  /* what aggressors flooded with */
+    double                 rate,   /* victim copy rate in MB/s */
+    const struct hist     *lat     /* time of each block in ns */
+)
+{
+    if (!out_text())
+    {
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("aggressor", flood_names[flood]);
+        out_double("rate_mbps", rate);
+        out_ulong("p50_ns", hist_pct(lat, 50));
+        out_ulong("p90_ns", hist_pct(lat, 90));
+        out_ulong("p99_ns", hist_pct(lat, 99));
+        out_ulong("p999_ns", hist_pct(lat, 99.9));
+        out_ulong("max_ns", hist_pct(lat, 100));
+        out_record_end();
+        return;
+    }
+
+    printf("%-5s rate %8lu MB/s, p50 %6lu, p90 %6lu, p99 %7lu, "
+           "p99.9 %7lu, max %8lu ns\n",
+           flood_names[flood],
+           (unsigned long)rate,
+           hist_pct(lat, 50),
+           hist_pct(lat, 90),
+           hist_pct(lat, 99),
+           hist_pct(lat, 99.9),
+           hist_pct(lat, 100));
+}
+
+
+/* ==========================================================================
+    returns change of 'v' against 'base' in percent
+   ========================================================================== */
+
+
+static double neighbour_change
+(
+    double  v,     /* value under aggressors */
+    double  base   /* value without aggressors */
+)
+{
+    return base > 0 ? (v - base) / base * 100 : 0;
+}
+
+
+/* ==========================================================================
+    prints change of victim rate and percentiles of  block  time  of  each
+    aggressor type, against run without aggressors.  'lat' holds block
+    times of all intervals.
+   ========================================================================== */
+
+
+static void neighbour_degradation
+(
+    const struct stats   *rate,  /* victim rate of each aggressor type */
+    const struct hist    *lat    /* block times of each aggressor type */
+)
+{
+    static const double   pcts[] = { 50, 90, 99, 99.9 };
+    static const char    *keys[] = { "p50", "p90", "p99", "p999" };
+    char                  key[32];  /* name of field */
+    int                   f;        /* iterator for loop */
+    size_t                p;        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (out_text())
+    {
+        printf("change against no aggressors\n");
+    }
+
+    for (f = FLOOD_NONE + 1; f != FLOOD_MAX; ++f)
+    {
+        if (!out_text())
+        {
+            out_record("degradation");
+            out_str("aggressor", flood_names[f]);
+            out_double("rate_pct",
+                       neighbour_change(rate[f].mean, rate[FLOOD_NONE].mean));
+
+            for (p = 0; p != sizeof(pcts) / sizeof(*pcts); ++p)
+            {
+                sprintf(key, "%s_pct", keys[p]);
+                out_double(key, neighbour_change(
+                    hist_pct(&lat[f], pcts[p]),
+                    hist_pct(&lat[FLOOD_NONE], pcts[p])));
+            }
+
+            out_record_end();
+            continue;
+        }
+
+        printf("%-5s rate %+7.2f%%", flood_names[f],
+               neighbour_change(rate[f].mean, rate[FLOOD_NONE].mean));
+
+        for (p = 0; p != sizeof(pcts) / sizeof(*pcts); ++p)
+        {
+            printf(", %s %+8.2f%%", keys[p], neighbour_change(
+                hist_pct(&lat[f], pcts[p]),
+                hist_pct(&lat[FLOOD_NONE], pcts[p])));
+        }
+
+        printf("\n");
+    }
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    pins calling process to cpu it runs on now, and stores cpus that  are
+    left for aggressors in 'others'.  Does nothing unless opts.place asks
+    for it.
+
+    returns:
+            number of cpus left for aggressors, 0 when they are not pinned
+   ========================================================================== */
+
+
+int neighbour_pin
+(
+    int          *others,  /* cpus for aggressors */
+    int           max      /* max number of cpus in 'others' */
+)
+{
+#if HAVE_SCHED_GETCPU && HAVE_SCHED_SETAFFINITY && defined(CPU_SET)
+    cpu_set_t     set;     /* cpus we are allowed to run on */
+    cpu_set_t     self;    /* cpu victim is pinned to */
+    int           cpu;     /* cpu victim runs on */
+    int           n;       /* number of cpus in others */
+    int           i;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (opts.place != PLACE_OTHER)
+    {
+        return 0;
+    }
+
+    if ((cpu = sched_getcpu()) < 0 ||
+        sched_getaffinity(0, sizeof(set), &set) != 0)
+    {
+        fprintf(stderr, "Couldn't get cpu affinity, aggressors not pinned\n");
+        return 0;
+    }
+
+    for (i = 0, n = 0; i != CPU_SETSIZE && n != max; ++i)
+    {
+        if (i != cpu && CPU_ISSET(i, &set))
+        {
+            others[n++] = i;
+        }
+    }
+
+    if (n == 0)
+    {
+        fprintf(stderr, "No cpu left for aggressors, they are not pinned\n");
+        return 0;
+    }
+
+    CPU_ZERO(&self);
+    CPU_SET(cpu, &self);
+
+    if (sched_setaffinity(0, sizeof(self), &self) != 0)
+    {
+        fprintf(stderr, "Couldn't pin victim to cpu %d, aggressors not "
+                "pinned\n", cpu);
+        return 0;
+    }
+
+    return n;
+#else
+    (void)others;
+    (void)max;
+
+    if (opts.place == PLACE_OTHER)
+    {
+        fprintf(stderr, "Cpu pinning not supported, aggressors not pinned\n");
+    }
+
+    return 0;
+#endif
+}
+
+
+/* ==========================================================================
+    kills and reaps first 'n' aggressors in 'pids'
+   ========================================================================== */
+
+
+void neighbour_stop
+(
+    pid_t          *pids,  /* aggressor processes */
+    unsigned long   n      /* number of aggressors to stop */
+)
+{
+    unsigned long   i;     /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 0; i != n; ++i)
+    {
+        kill(pids[i], SIGKILL);
+    }
+
+    for (i = 0; i != n; ++i)
+    {
+        while (waitpid(pids[i], NULL, 0) == -1 && errno == EINTR);
+    }
+}
+
+
+/* ==========================================================================
+    forks opts.threads aggressors flooding memory with 'flood',  pinned
+    round robin to 'ncpus' 'cpus', if there are any.  Returns only after
+    all of them touched their buffers and started flooding.
+
+    returns:
+             0      all aggressors are running
+            -1      couldn't fork or start aggressor, none is left running
+   ========================================================================== */
+
+
+int neighbour_start
+(
+    enum neighbour_flood   flood,   /* what aggressors flood memory with */
+    pid_t                 *pids,    /* pids of aggressors go here */
+    const int             *cpus,    /* cpus for aggressors */
+    int                    ncpus    /* number of cpus, 0 to not pin */
+)
+{
+    unsigned char         *buf;     /* buffer of aggressor */
+    unsigned long          n;       /* iterator for loop */
+    int                    fds[2];  /* aggressors report readiness here */
+    char                   c;       /* readiness byte */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (pipe(fds) != 0)
+    {
+        fprintf(stderr, "Couldn't create pipe for aggressors\n");
+        return -1;
+    }
+
+    /*
+     * anything buffered would be printed again by each child
+     */
+
+    fflush(stdout);
+
+    for (n = 0; n != opts.threads; ++n)
+    {
+        if ((pids[n] = fork()) == -1)
+        {
+            fprintf(stderr, "Couldn't fork aggressor\n");
+            neighbour_stop(pids, n);
+            close(fds[0]);
+            close(fds[1]);
+            return -1;
+        }
+
+        if (pids[n] != 0)
+        {
+            continue;
+        }
+
+        /*
+         * aggressor, it must never get back to the benchmark
+         */
+
+        close(fds[0]);
+
+#if HAVE_DECL_PR_SET_PDEATHSIG
+        prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0);
+#endif
+
+#if HAVE_SCHED_SETSCHEDULER && defined(SCHED_OTHER)
+        {
+            struct sched_param  sp;  /* priority of normal policy */
+            /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+            /*
+             * aggressor never stops on its own, with SCHED_FIFO inherited
+             * from -q it would never give its cpu back to victim
+             */
+
+            memset(&sp, 0, sizeof(sp));
+            sched_setscheduler(0, SCHED_OTHER, &sp);
+        }
+#endif
+
+#if HAVE_SCHED_GETCPU && HAVE_SCHED_SETAFFINITY && defined(CPU_SET)
+        if (ncpus)
+        {
+            cpu_set_t  set;  /* cpu aggressor is pinned to */
+            /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+            CPU_ZERO(&set);
+            CPU_SET(cpus[n % ncpus], &set);
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+#else
+        (void)cpus;
+        (void)ncpus;
+#endif
+
+        if ((buf = malloc(NEIGHBOUR_FLOOD_SIZE)) == NULL)
+        {
+            _exit(1);
+        }
+
+        memset(buf, 0x55, NEIGHBOUR_FLOOD_SIZE);
+        c = 0;
+
+        if (write(fds[1], &c, 1) != 1)
+        {
+            _exit(1);
+        }
+
+        close(fds[1]);
+        neighbour_aggressor(flood, buf);
+        _exit(0);
+    }
+
+    close(fds[1]);
+
+    for (n = 0; n != opts.threads; ++n)
+    {
+        if (read(fds[0], &c, 1) != 1)
+        {
+            fprintf(stderr, "Aggressor failed to start\n");
+            neighbour_stop(pids, opts.threads);
+            close(fds[0]);
+            return -1;
+        }
+    }
+
+    close(fds[0]);
+    return 0;
+}
+
+
+/* ==========================================================================
+    measures interference between processes.  Victim, that is this process,
+    copies opts.block_size blocks with opts.method, while opts.threads forked
+    aggressors flood their own memory with reads, writes or copies.  Victim
+    runs without aggressors first, each interval, so rate and percentiles
+    of block copy time can be compared.  With opts.place  set  to  other,
+    victim is pinned to cpu it runs on, and aggressors to the remaining ones.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory or start aggressors
+   ========================================================================== */
+
+
+int neighbour_bench(void)
+{
+    struct stats     rate[FLOOD_MAX];  /* victim rate under each flood */
+    struct hist     *lat;              /* block times, last and all */
+    unsigned char   *dst;              /* destination of victim copy */
+    unsigned char   *src;              /* source of victim copy */
+    pid_t           *pids;             /* aggressor processes */
+    int             *cpus;             /* cpus for aggressors */
+    char             name[32];         /* name of configuration */
+    unsigned long    i;                /* iterator for loop */
+    double           sec;              /* time taken by victim */
+    double           mbps;             /* victim rate in MB/s */
+    int              ncpus;            /* number of cpus for aggressors */
+    int              f;                /* iterator for loop */
+    int              rc;               /* return code */
+    struct jedec     jd_block_size;    /* block size in jedec format */
+    struct jedec     jd_intvl;         /* report interval in jedec format */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+
+    for (f = 0; f != FLOOD_MAX; ++f)
+    {
+        stats_init(&rate[f]);
+    }
+
+    /*
+     * lat[FLOOD_MAX] is for current interval, rest accumulates  all  of
+     * them for each flood
+     */
+
+    lat = malloc((FLOOD_MAX + 1) * sizeof(*lat));
+    pids = malloc(opts.threads * sizeof(*pids));
+    cpus = malloc(opts.threads * sizeof(*cpus));
+    dst = malloc(opts.block_size);
+    src = malloc(opts.block_size);
+
+    if (lat == NULL || pids == NULL || cpus == NULL || dst == NULL ||
+        src == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+        goto error;
+    }
+
+    for (f = 0; f != FLOOD_MAX; ++f)
+    {
+        hist_reset(&lat[f]);
+    }
+
+    memset(src, 0x55, opts.block_size);
+    memcpy(dst, src, opts.block_size);
+    ncpus = neighbour_pin(cpus, (int)opts.threads);
+    bytes2jedec(opts.block_size, &jd_block_size);
+    bytes2jedec(opts.report_intvl, &jd_intvl);
+
+    if (out_text())
+    {
+        printf("block size: %lu %cB, report every %lu %cB, aggressors %lu "
+               "%s, iterations %lu\n",
+               jd_block_size.val,
+               jd_block_size.pre,
+               jd_intvl.val,
+               jd_intvl.pre,
+               opts.threads,
+               ncpus ? "pinned to other cpus" : "not pinned",
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(rate, FLOOD_MAX, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (f = 0; f != FLOOD_MAX; ++f)
+        {
+            if (f != FLOOD_NONE &&
+                neighbour_start(f, pids, cpus, ncpus) != 0)
+            {
+                goto error;
+            }
+
+            hist_reset(&lat[FLOOD_MAX]);
+            sec = neighbour_victim(dst, src, &lat[FLOOD_MAX]);
+
+            if (f != FLOOD_NONE)
+            {
+                neighbour_stop(pids, opts.threads);
+            }
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            sec = sec > 0 ? sec : 1e-9;
+            mbps = lat[FLOOD_MAX].n * (double)opts.block_size / sec /
+                (1024 * 1024);
+            neighbour_report(i - opts.warmup + 1, f, mbps, &lat[FLOOD_MAX]);
+            hist_merge(&lat[f], &lat[FLOOD_MAX]);
+
+            if (stats_add(&rate[f], mbps) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of victim copy rate\n");
+    }
+
+    for (f = 0; f != FLOOD_MAX; ++f)
+    {
+        sprintf(name, "aggressor %s", flood_names[f]);
+        stats_compute(&rate[f], opts.outlier_mad);
+        stats_print(&rate[f], name, "MB/s");
+    }
+
+    neighbour_degradation(rate, lat);
+    rc = 0;
+
+error:
+    for (f = 0; f != FLOOD_MAX; ++f)
+    {
+        stats_destroy(&rate[f]);
+    }
+
+    free(lat);
+    free(pids);
+    free(cpus);
+    free(dst);
+    free(src);
+    return rc;
+}
+
+#endif
@@ -0,0 +1,41 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef NEIGHBOUR_H
+#define NEIGHBOUR_H 1
+
+#include "config.h"
+
+#if HAVE_FORK
+#include <sys/types.h>
+#endif
+
+/*
+ * size of buffer each aggressor floods, it has to be well over last level
+ * cache, so floods really go to memory
+ */
+
+#define NEIGHBOUR_FLOOD_SIZE (64 * 1024 * 1024)
+
+#if HAVE_FORK
+enum neighbour_flood
+{
+    FLOOD_NONE,
+    FLOOD_READ,
+    FLOOD_WRITE,
+    FLOOD_COPY,
+    FLOOD_MAX
+};
+
+int neighbour_pin(int *others, int max);
+int neighbour_start(enum neighbour_flood flood, pid_t *pids, const int *cpus,
+    int ncpus);
+void neighbour_stop(pid_t *pids, unsigned long n);
+#endif
+
+int neighbour_bench(void);
+
+#endif
@@ -0,0 +1,219 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+
+#if HAVE_GETRUSAGE
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+#if HAVE_SCHED_GETCPU
+#include <sched.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "noise.h"
+#include "utils.h"
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    reads number of cpu migrations of this thread from /proc/self/sched,
+    which is only there when kernel has scheduler debugging enabled
+
+    returns:
+            number of migrations, or -1 when it can't be read
+   ========================================================================== */
+
+
+static long noise_migrations(void)
+{
+    FILE  *f;          /* /proc/self/sched */
+    char   line[128];  /* single line of the file */
+    char  *v;          /* value of field */
+    long   n;          /* number of migrations */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if ((f = fopen("/proc/self/sched", "r")) == NULL)
+    {
+        return -1;
+    }
+
+    n = -1;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        if (strncmp(line, "se.nr_migrations", 16) == 0 &&
+            (v = strchr(line, ':')) != NULL)
+        {
+            n = strtol(v + 1, NULL, 10);
+            break;
+        }
+    }
+
+    fclose(f);
+    return n;
+}
+
+
+/* ==========================================================================
+    takes sample of context switches and page faults into 's'.  They  stay
+    at 0 when getrusage() is not available, so they never flag interval.
+   ========================================================================== */
+
+
+static void noise_rusage
+(
+    struct noise_sample  *s   /* sample will be stored here */
+)
+{
+#if HAVE_GETRUSAGE
+    struct rusage         ru; /* resource usage of thread */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * bench runs in main thread, so whole process is the same  as  thread
+     * where thread usage is not available
+     */
+
+#ifdef RUSAGE_THREAD
+    if (getrusage(RUSAGE_THREAD, &ru) == 0)
+#else
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+#endif
+    {
+        s->vcsw = ru.ru_nvcsw;
+        s->ivcsw = ru.ru_nivcsw;
+        s->minflt = ru.ru_minflt;
+        s->majflt = ru.ru_majflt;
+    }
+#else
+    (void)s;
+#endif
+}
+
+
+/* ==========================================================================
+    takes sample of scheduler statistics into 's', missing  ones  are  set
+    so they never flag interval
+   ========================================================================== */
+
+
+static void noise_sched
+(
+    struct noise_sample  *s   /* sample will be stored here */
+)
+{
+    FILE                 *f;  /* /proc/self/schedstat */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * schedstat holds time on cpu, time waiting on runqueue and number of
+     * timeslices, all we need is time we wanted to run but couldn't
+     */
+
+    if ((f = fopen("/proc/self/schedstat", "r")) != NULL)
+    {
+        if (fscanf(f, "%*f %lf", &s->run_delay) != 1)
+        {
+            s->run_delay = 0;
+        }
+
+        fclose(f);
+    }
+
+    s->migrations = noise_migrations();
+
+#if HAVE_SCHED_GETCPU
+    s->cpu = sched_getcpu();
+#else
+    s->cpu = -1;
+#endif
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    marks start of interval, should be called outside of measured code,
+    as it reads files in /proc
+   ========================================================================== */
+
+
+void noise_begin
+(
+    struct noise  *n  /* noise of interval */
+)
+{
+    /*
+     * reading /proc may allocate memory and fault, so getrusage() is the
+     * last thing done here, and the first thing in noise_end()
+     */
+
+    memset(&n->start, 0, sizeof(n->start));
+    memset(&n->delta, 0, sizeof(n->delta));
+    noise_sched(&n->start);
+    noise_rusage(&n->start);
+    n->noisy = 0;
+}
+
+
+/* ==========================================================================
+    marks end of interval, and computes what happened during it.  Interval
+    is noisy when thread was switched out, migrated or page faulted.
+   ========================================================================== */
+
+
+void noise_end
+(
+    struct noise         *n    /* noise of interval */
+)
+{
+    struct noise_sample   e;   /* sample on interval end */
+    struct noise_sample  *s;   /* sample on interval start */
+    struct noise_sample  *d;   /* difference between them */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    memset(&e, 0, sizeof(e));
+    noise_rusage(&e);
+    noise_sched(&e);
+    s = &n->start;
+    d = &n->delta;
+
+    d->vcsw = e.vcsw - s->vcsw;
+    d->ivcsw = e.ivcsw - s->ivcsw;
+    d->minflt = e.minflt - s->minflt;
+    d->majflt = e.majflt - s->majflt;
+    d->run_delay = e.run_delay - s->run_delay;
+    d->cpu = e.cpu;
+
+    if (e.migrations >= 0 && s->migrations >= 0)
+    {
+        d->migrations = e.migrations - s->migrations;
+    }
+    else
+    {
+        /*
+         * no scheduler debug info, we can only tell if we ended  on  other
+         * cpu than we started, migrations there and back are not seen
+         */
+
+        d->migrations = e.cpu != s->cpu;
+    }
+
+    n->noisy = d->vcsw || d->ivcsw || d->minflt || d->majflt ||
+        d->migrations;
+}
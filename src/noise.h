@@ -0,0 +1,36 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef NOISE_H
+#define NOISE_H 1
+
+/*
+ * counters of events that disturb measurement, all of them are taken
+ * from the kernel, so sampling them costs few syscalls per interval
+ */
+
+struct noise_sample
+{
+    long vcsw;          /* voluntary context switches */
+    long ivcsw;         /* involuntary context switches, preemptions */
+    long minflt;        /* minor page faults */
+    long majflt;        /* major page faults */
+    long migrations;    /* cpu migrations */
+    double run_delay;   /* ns spent waiting on runqueue */
+    int cpu;            /* cpu we run on, or -1 if not known */
+};
+
+struct noise
+{
+    struct noise_sample start;  /* sample on interval start */
+    struct noise_sample delta;  /* events that happened during interval */
+    int noisy;                  /* any event happened during interval */
+};
+
+void noise_begin(struct noise *n);
+void noise_end(struct noise *n);
+
+#endif
@@ -58,8 +58,24 @@ static void opts_reset(void)
     opts.block_size = 16 * 1024;
     opts.report_intvl = 100 * 1024 * 1024;
     opts.num_intvl = 10;
+    opts.warmup = 0;
+    opts.outlier_mad = 0;
+    opts.ci_target = 0;
+    opts.baseline = NULL;
+    opts.replay = NULL;
+    opts.regress = 5;
     opts.method = METHOD_MEMCPY;
     opts.cache_size = 1 * 1024 * 1024;
+    opts.threads = 1;
+    opts.threads_set = 0;
+    opts.test = TEST_COPY;
+    opts.dist = DIST_UNIFORM;
+    opts.output = OUT_TEXT;
+    opts.counters = CNT_NONE;
+    opts.noise = NOISE_FLAG;
+    opts.quiet = 0;
+    opts.place = PLACE_ANY;
+    opts.intensity = 4;
 
 #if HAVE_CLOCK_GETTIME
     opts.clock = CLK_REALTIME;
@@ -117,6 +133,32 @@ static void opts_print_help(void)
     printf(
 "\t-m<method>   copying method\n"
 "\t-c<clock>    clock to use to calculate bandwith\n"
+"\t-t<test>     benchmark to run\n"
+"\t-d<dist>     distribution of allocation sizes\n"
+"\t-n<number>   number of threads\n"
+"\t-w<number>   number of warm up intervals, not included in results\n"
+"\t-e<mads>     reject samples further than 'mads' MADs from median\n"
+"\t-p<percent>  repeat until 95%% ci is within 'percent' of mean, up to\n"
+"\t             -i intervals\n"
+);
+
+    printf(
+"\t-o<format>   output format\n"
+"\t-f<file>     compare against baseline, csv or json printed with -o\n"
+"\t-g<percent>  regression threshold for -f, default 5\n"
+"\t-k<counters> performance counters collected by copy test\n"
+"\t-s<noise>    what to do with copy intervals disturbed by system\n"
+"\t-q           quiet system: pin to cpus with fewest irqs, SCHED_FIFO,\n"
+"\t             mlockall and no THP, where permitted\n"
+"\t-a<place>    where neighbour test puts aggressors, any or other cpus\n"
+);
+
+    printf(
+"\t-x<rounds>   multiply and add rounds per word in overlap test, default 4\n"
+"\t-u<file>     size, alignment and count buckets for replay test\n"
+);
+
+    printf(
 "\n"
 "methods:\n"
 "\tmemcpy       copy data using buildin memcpy function\n"
@@ -125,8 +167,71 @@ static void opts_print_help(void)
 "clocks:\n"
 #if HAVE_CLOCK_GETTIME
 "\trealtime     posix CLOCK_REALTIME clock is used\n"
+#if HAVE_DECL_CLOCK_MONOTONIC_RAW
+"\tmonotonic_raw linux CLOCK_MONOTONIC_RAW clock is used\n"
+#endif
+#endif
+#if HAVE_RDTSC
+"\ttsc          x86 time stamp counter, calibrated on startup\n"
 #endif
 "\tclock        clock_t is used\n"
+);
+
+    printf(
+"\n"
+"tests:\n"
+"\tcopy         memory copy bandwidth using selected method\n"
+"\talloc        allocator throughput and latency, libc vs arena and pool\n"
+"\tgrow         grow buffer up to block size, realloc vs memcpy vs mremap\n"
+"\tzero         compare ways of clearing memory and their time to first use\n"
+"\toverlap      copy or prefetch of next tile against compute on current one\n"
+"\troofline     peak flops, cache and memory bandwidth, and intensity sweep\n"
+"\tsmall        latency of 1 to 512 byte copies in random order\n"
+"\treplay       replay mix of copies from histogram file given with -u\n"
+#if HAVE_CLFLUSH
+"\tflush        clflush, clflushopt and clwb throughput with fences\n"
+#endif
+#if HAVE_PTHREAD_H
+"\tloaded       load latency while -n threads inject rising bandwidth\n"
+"\tscale        copy rate of 1, 2, 4... threads up to -n or all cpus\n"
+"\tpcopy        single block copy split across -n threads, chunk sweep\n"
+#endif
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+"\tatomic       atomic ops rate and latency, alone and on -n threads\n"
+#endif
+#if HAVE_FORK
+"\tneighbour    copy rate while -n processes flood memory\n"
+#endif
+);
+
+    printf(
+"\n"
+"distributions:\n"
+"\tfixed        every allocation is of block size\n"
+"\tuniform      uniformly random size between 1 and block size\n"
+"\tpow2         random power of two between 8 and block size\n"
+);
+
+    printf(
+"\n"
+"formats:\n"
+"\ttext         human readable reports\n"
+"\tcsv          exact values, comma separated, header before records\n"
+"\tjson         exact values, array of records\n"
+"\n"
+"counters:\n"
+"\tnone         don't collect counters\n"
+"\thw           cycles, instructions, llc, dtlb and l1d misses, falls back\n"
+"\t             to sw when pmu is not available\n"
+"\tsw           task clock, page faults, context switches and migrations\n"
+);
+
+    printf(
+"\n"
+"noise:\n"
+"\toff          don't check intervals for noise\n"
+"\tflag         mark intervals with context switches, migrations or faults\n"
+"\tdiscard      same as flag, and don't include them in summary\n"
 );
 }
 
@@ -265,6 +370,75 @@ int opts_parse
             opts.num_intvl = tmp;
             break;
 
+        case 'n':
+            HAS_OPTARG();
+
+            tmp = strtol(optarg, &ep, 10);
+
+            if (*ep || tmp < 1)
+            {
+                fprintf(stderr,
+                        "parameter %s for argument 'n' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            opts.threads = tmp;
+            opts.threads_set = 1;
+            break;
+
+        case 'w':
+            HAS_OPTARG();
+
+            tmp = strtol(optarg, &ep, 10);
+
+            if (*ep || tmp < 0)
+            {
+                fprintf(stderr,
+                        "parameter %s for argument 'w' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            opts.warmup = tmp;
+            break;
+
+        case 'e':
+        case 'p':
+        case 'g':
+            HAS_OPTARG();
+
+            tmp = (float)strtod(optarg, &ep);
+
+            if (*ep || tmp < 0)
+            {
+                fprintf(stderr,
+                        "parameter %s for argument '%c' is invalid\n",
+                        optarg,
+                        opt);
+                return -2;
+            }
+
+            if (opt == 'e')
+            {
+                opts.outlier_mad = tmp;
+            }
+            else if (opt == 'p')
+            {
+                opts.ci_target = tmp;
+            }
+            else
+            {
+                opts.regress = tmp;
+            }
+
+            break;
+
+        case 'f':
+            HAS_OPTARG();
+            opts.baseline = optarg;
+            break;
+
         case 'c':
             HAS_OPTARG();
 
@@ -274,6 +448,21 @@ int opts_parse
                 opts.clock = CLK_REALTIME;
             }
             else
+#if HAVE_DECL_CLOCK_MONOTONIC_RAW
+            if (strcmp(optarg, "monotonic_raw") == 0)
+            {
+                opts.clock = CLK_MONOTONIC_RAW;
+            }
+            else
+#endif
+#endif
+
+#if HAVE_RDTSC
+            if (strcmp(optarg, "tsc") == 0)
+            {
+                opts.clock = CLK_TSC;
+            }
+            else
 #endif
 
             if (strcmp(optarg, "clock") == 0)
@@ -311,6 +500,229 @@ int opts_parse
 
             break;
 
+        case 't':
+            HAS_OPTARG();
+
+            if (strcmp(optarg, "copy") == 0)
+            {
+                opts.test = TEST_COPY;
+            }
+            else if (strcmp(optarg, "alloc") == 0)
+            {
+                opts.test = TEST_ALLOC;
+            }
+            else if (strcmp(optarg, "grow") == 0)
+            {
+                opts.test = TEST_GROW;
+            }
+            else if (strcmp(optarg, "zero") == 0)
+            {
+                opts.test = TEST_ZERO;
+            }
+            else if (strcmp(optarg, "overlap") == 0)
+            {
+                opts.test = TEST_OVERLAP;
+            }
+            else if (strcmp(optarg, "roofline") == 0)
+            {
+                opts.test = TEST_ROOFLINE;
+            }
+            else if (strcmp(optarg, "small") == 0)
+            {
+                opts.test = TEST_SMALL;
+            }
+            else if (strcmp(optarg, "replay") == 0)
+            {
+                opts.test = TEST_REPLAY;
+            }
+#if HAVE_CLFLUSH
+            else if (strcmp(optarg, "flush") == 0)
+            {
+                opts.test = TEST_FLUSH;
+            }
+#endif
+#if HAVE_PTHREAD_H
+            else if (strcmp(optarg, "loaded") == 0)
+            {
+                opts.test = TEST_LOADED;
+            }
+            else if (strcmp(optarg, "scale") == 0)
+            {
+                opts.test = TEST_SCALE;
+            }
+            else if (strcmp(optarg, "pcopy") == 0)
+            {
+                opts.test = TEST_PCOPY;
+            }
+#endif
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+            else if (strcmp(optarg, "atomic") == 0)
+            {
+                opts.test = TEST_ATOMIC;
+            }
+#endif
+#if HAVE_FORK
+            else if (strcmp(optarg, "neighbour") == 0)
+            {
+                opts.test = TEST_NEIGHBOUR;
+            }
+#endif
+            else
+            {
+                fprintf(stderr,
+                        "parameter %s for optargument 't' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            break;
+
+        case 'd':
+            HAS_OPTARG();
+
+            if (strcmp(optarg, "fixed") == 0)
+            {
+                opts.dist = DIST_FIXED;
+            }
+            else if (strcmp(optarg, "uniform") == 0)
+            {
+                opts.dist = DIST_UNIFORM;
+            }
+            else if (strcmp(optarg, "pow2") == 0)
+            {
+                opts.dist = DIST_POW2;
+            }
+            else
+            {
+                fprintf(stderr,
+                        "parameter %s for optargument 'd' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            break;
+
+        case 'o':
+            HAS_OPTARG();
+
+            if (strcmp(optarg, "text") == 0)
+            {
+                opts.output = OUT_TEXT;
+            }
+            else if (strcmp(optarg, "csv") == 0)
+            {
+                opts.output = OUT_CSV;
+            }
+            else if (strcmp(optarg, "json") == 0)
+            {
+                opts.output = OUT_JSON;
+            }
+            else
+            {
+                fprintf(stderr,
+                        "parameter %s for optargument 'o' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            break;
+
+        case 'k':
+            HAS_OPTARG();
+
+            if (strcmp(optarg, "none") == 0)
+            {
+                opts.counters = CNT_NONE;
+            }
+            else if (strcmp(optarg, "hw") == 0)
+            {
+                opts.counters = CNT_HW;
+            }
+            else if (strcmp(optarg, "sw") == 0)
+            {
+                opts.counters = CNT_SW;
+            }
+            else
+            {
+                fprintf(stderr,
+                        "parameter %s for optargument 'k' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            break;
+
+        case 's':
+            HAS_OPTARG();
+
+            if (strcmp(optarg, "off") == 0)
+            {
+                opts.noise = NOISE_OFF;
+            }
+            else if (strcmp(optarg, "flag") == 0)
+            {
+                opts.noise = NOISE_FLAG;
+            }
+            else if (strcmp(optarg, "discard") == 0)
+            {
+                opts.noise = NOISE_DISCARD;
+            }
+            else
+            {
+                fprintf(stderr,
+                        "parameter %s for optargument 's' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            break;
+
+        case 'q':
+            opts.quiet = 1;
+            break;
+
+        case 'a':
+            HAS_OPTARG();
+
+            if (strcmp(optarg, "any") == 0)
+            {
+                opts.place = PLACE_ANY;
+            }
+            else if (strcmp(optarg, "other") == 0)
+            {
+                opts.place = PLACE_OTHER;
+            }
+            else
+            {
+                fprintf(stderr,
+                        "parameter %s for optargument 'a' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            break;
+
+        case 'x':
+            HAS_OPTARG();
+
+            tmp = strtol(optarg, &ep, 10);
+
+            if (*ep || tmp < 0)
+            {
+                fprintf(stderr,
+                        "parameter %s for argument 'x' is invalid\n",
+                        optarg);
+                return -2;
+            }
+
+            opts.intensity = tmp;
+            break;
+
+        case 'u':
+            HAS_OPTARG();
+            opts.replay = optarg;
+            break;
+
         default:
             fprintf(stderr,
                     "Unknown option: %c (%02x)\n",
@@ -15,6 +15,12 @@ enum clock
 {
 #if HAVE_CLOCK_GETTIME
     CLK_REALTIME,
+#if HAVE_DECL_CLOCK_MONOTONIC_RAW
+    CLK_MONOTONIC_RAW,
+#endif
+#endif
+#if HAVE_RDTSC
+    CLK_TSC,
 #endif
     CLK_CLOCK
 };
@@ -25,14 +31,91 @@ enum method
     METHOD_BBB
 };
 
+enum test
+{
+    TEST_COPY,
+    TEST_ALLOC,
+    TEST_GROW,
+    TEST_ZERO,
+#if HAVE_CLFLUSH
+    TEST_FLUSH,
+#endif
+#if HAVE_PTHREAD_H
+    TEST_LOADED,
+    TEST_SCALE,
+    TEST_PCOPY,
+#endif
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+    TEST_ATOMIC,
+#endif
+    TEST_OVERLAP,
+    TEST_ROOFLINE,
+    TEST_SMALL,
+    TEST_REPLAY,
+#if HAVE_FORK
+    TEST_NEIGHBOUR,
+#endif
+    TEST_MAX
+};
+
+enum output
+{
+    OUT_TEXT,
+    OUT_CSV,
+    OUT_JSON
+};
+
+enum counters
+{
+    CNT_NONE,
+    CNT_HW,
+    CNT_SW
+};
+
+enum place
+{
+    PLACE_ANY,
+    PLACE_OTHER
+};
+
+enum noise_mode
+{
+    NOISE_OFF,
+    NOISE_FLAG,
+    NOISE_DISCARD
+};
+
+enum dist
+{
+    DIST_FIXED,
+    DIST_UNIFORM,
+    DIST_POW2
+};
+
 struct opts
 {
     size_t block_size;
     size_t cache_size;
     unsigned long num_intvl;
+    unsigned long warmup;
+    unsigned long threads;
+    int threads_set;
     float report_intvl;
+    float outlier_mad;
+    float ci_target;
+    float regress;
+    const char *baseline;
+    const char *replay;
     enum clock clock;
     enum method method;
+    enum test test;
+    enum dist dist;
+    enum output output;
+    enum counters counters;
+    enum noise_mode noise;
+    enum place place;
+    int quiet;
+    unsigned long intensity;
 };
 
 extern struct opts opts;
@@ -0,0 +1,490 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "opts.h"
+#include "out.h"
+#include "utils.h"
+
+
+/* ==== Private variables =================================================== */
+
+
+/*
+ * csv record is built here, keys and values separately, so header can  be
+ * printed when keys are different than in previous record
+ */
+
+static char  out_keys[OUT_LINE_MAX];
+static char  out_vals[OUT_LINE_MAX];
+static char  out_header[OUT_LINE_MAX];
+
+/*
+ * number of records and number of fields in current record, used to
+ * place separators
+ */
+
+static unsigned long  out_nrecords;
+static unsigned long  out_nfields;
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    appends 's' to 'buf' of OUT_LINE_MAX size, whatever does  not  fit  is
+    dropped
+   ========================================================================== */
+
+
+static void out_append
+(
+    char        *buf,  /* buffer to append to */
+    const char  *s     /* string to append */
+)
+{
+    size_t       len;  /* current length of buf */
+    size_t       n;    /* number of bytes to copy */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    len = strlen(buf);
+    n = strlen(s);
+
+    if (len + n >= OUT_LINE_MAX)
+    {
+        n = OUT_LINE_MAX - len - 1;
+    }
+
+    memcpy(buf + len, s, n);
+    buf[len + n] = '\0';
+}
+
+
+/* ==========================================================================
+    starts new field named 'key', value must be printed right after
+   ========================================================================== */
+
+
+static void out_key
+(
+    const char  *key  /* name of the field */
+)
+{
+    if (opts.output == OUT_CSV)
+    {
+        if (out_nfields)
+        {
+            out_append(out_keys, ",");
+            out_append(out_vals, ",");
+        }
+
+        out_append(out_keys, key);
+    }
+    else
+    {
+        printf("%s\"%s\": ", out_nfields ? ", " : "", key);
+    }
+
+    ++out_nfields;
+}
+
+
+/* ==========================================================================
+    prints raw, already formatted, value of current field
+   ========================================================================== */
+
+
+static void out_raw
+(
+    const char  *val  /* formatted value */
+)
+{
+    if (opts.output == OUT_CSV)
+    {
+        out_append(out_vals, val);
+    }
+    else
+    {
+        printf("%s", val);
+    }
+}
+
+
+/* ==========================================================================
+    returns name of the clock that is used
+   ========================================================================== */
+
+
+static const char *out_clock_name(void)
+{
+    switch (opts.clock)
+    {
+#if HAVE_CLOCK_GETTIME
+    case CLK_REALTIME:
+        return "realtime";
+
+#if HAVE_DECL_CLOCK_MONOTONIC_RAW
+    case CLK_MONOTONIC_RAW:
+        return "monotonic_raw";
+#endif
+#endif
+
+#if HAVE_RDTSC
+    case CLK_TSC:
+        return "tsc";
+#endif
+
+    default:
+        return "clock";
+    }
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    checks if human readable output is selected.
+
+    returns:
+             1      text output, tests should print their usual reports
+             0      csv or json output, only out_* functions should print
+   ========================================================================== */
+
+
+int out_text(void)
+{
+    return opts.output == OUT_TEXT;
+}
+
+
+/* ==========================================================================
+    returns name of the test that is run
+   ========================================================================== */
+
+
+const char *out_test_name(void)
+{
+    switch (opts.test)
+    {
+    case TEST_ALLOC:
+        return "alloc";
+
+    case TEST_GROW:
+        return "grow";
+
+    case TEST_ZERO:
+        return "zero";
+
+    case TEST_OVERLAP:
+        return "overlap";
+
+    case TEST_ROOFLINE:
+        return "roofline";
+
+    case TEST_SMALL:
+        return "small";
+
+    case TEST_REPLAY:
+        return "replay";
+
+#if HAVE_CLFLUSH
+    case TEST_FLUSH:
+        return "flush";
+#endif
+
+#if HAVE_PTHREAD_H
+    case TEST_LOADED:
+        return "loaded";
+
+    case TEST_SCALE:
+        return "scale";
+
+    case TEST_PCOPY:
+        return "pcopy";
+#endif
+
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+    case TEST_ATOMIC:
+        return "atomic";
+#endif
+
+#if HAVE_FORK
+    case TEST_NEIGHBOUR:
+        return "neighbour";
+#endif
+
+    default:
+        return "copy";
+    }
+}
+
+
+/* ==========================================================================
+    returns name of the copy method that is used
+   ========================================================================== */
+
+
+const char *out_method_name(void)
+{
+    return opts.method == METHOD_BBB ? "bbb" : "memcpy";
+}
+
+
+/* ==========================================================================
+    returns name of the distribution of sizes that is used
+   ========================================================================== */
+
+
+const char *out_dist_name(void)
+{
+    switch (opts.dist)
+    {
+    case DIST_FIXED:
+        return "fixed";
+
+    case DIST_POW2:
+        return "pow2";
+
+    default:
+        return "uniform";
+    }
+}
+
+
+/* ==========================================================================
+    starts output, must be called before first record
+   ========================================================================== */
+
+
+void out_begin(void)
+{
+    out_nrecords = 0;
+    out_header[0] = '\0';
+}
+
+
+/* ==========================================================================
+    finishes output, after this no more records can be printed.  Json array
+    is closed here, so it's valid even if test failed half way.
+   ========================================================================== */
+
+
+void out_end(void)
+{
+    if (opts.output == OUT_JSON)
+    {
+        printf(out_nrecords ? "\n]\n" : "[]\n");
+    }
+}
+
+
+/* ==========================================================================
+    starts new record of 'type'.  Every record carries full configuration
+    of the test, so it can be ingested without any context.
+   ========================================================================== */
+
+
+void out_record
+(
+    const char  *type  /* type of record, like "interval" or "summary" */
+)
+{
+    out_nfields = 0;
+
+    if (opts.output == OUT_CSV)
+    {
+        out_keys[0] = '\0';
+        out_vals[0] = '\0';
+    }
+    else
+    {
+        printf("%s{", out_nrecords ? ",\n  " : "[\n  ");
+    }
+
+    out_str("record", type);
+    out_str("test", out_test_name());
+    out_str("method", out_method_name());
+    out_str("clock", out_clock_name());
+    out_ulong("block_size", opts.block_size);
+    out_double("report_size", opts.report_intvl);
+    out_ulong("cache_size", opts.cache_size);
+    out_ulong("threads", opts.threads);
+    out_str("dist", out_dist_name());
+}
+
+
+/* ==========================================================================
+    escapes character 'c' of string value into 'esc' of OUT_ESCAPE_MAX
+    bytes, according to selected format.  Csv escapes quote by doubling
+    it, json escapes quote, backslash and control characters, which are
+    not allowed in its strings.
+   ========================================================================== */
+
+
+void out_escape
+(
+    int             c,    /* character to escape */
+    char           *esc   /* escaped character will be stored here */
+)
+{
+    unsigned char   u;    /* 'c' as unsigned, for comparison */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    u = (unsigned char)c;
+    esc[0] = (char)c;
+    esc[1] = '\0';
+
+    if (u == '"')
+    {
+        esc[0] = opts.output == OUT_CSV ? '"' : '\\';
+        esc[1] = '"';
+        esc[2] = '\0';
+        return;
+    }
+
+    if (opts.output != OUT_JSON)
+    {
+        return;
+    }
+
+    switch (u)
+    {
+    case '\\':
+        strcpy(esc, "\\\\");
+        break;
+
+    case '\n':
+        strcpy(esc, "\\n");
+        break;
+
+    case '\t':
+        strcpy(esc, "\\t");
+        break;
+
+    case '\r':
+        strcpy(esc, "\\r");
+        break;
+
+    default:
+        if (u < 0x20)
+        {
+            sprintf(esc, "\\u%04x", u);
+        }
+    }
+}
+
+
+/* ==========================================================================
+    adds string field to current record.  String is quoted, and characters
+    that need it are escaped according to selected format
+   ========================================================================== */
+
+
+void out_str
+(
+    const char  *key,                  /* name of the field */
+    const char  *val                   /* value of the field */
+)
+{
+    char         c[OUT_ESCAPE_MAX];    /* current character, escaped */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    out_key(key);
+    out_raw("\"");
+
+    for (; *val; ++val)
+    {
+        out_escape(*val, c);
+        out_raw(c);
+    }
+
+    out_raw("\"");
+}
+
+
+/* ==========================================================================
+    adds integer field to current record
+   ========================================================================== */
+
+
+void out_ulong
+(
+    const char     *key,     /* name of the field */
+    unsigned long   val      /* value of the field */
+)
+{
+    char            s[32];   /* formatted value */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    out_key(key);
+    sprintf(s, "%lu", val);
+    out_raw(s);
+}
+
+
+/* ==========================================================================
+    adds floating point field to current record.  Value is printed  with
+    enough digits to be read back exactly.  Json has no way  to  represent
+    infinity and nan, so null is printed instead, and empty field for csv
+   ========================================================================== */
+
+
+void out_double
+(
+    const char  *key,    /* name of the field */
+    double       val     /* value of the field */
+)
+{
+    char         s[64];  /* formatted value */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    out_key(key);
+
+    if (val != val || val - val != 0)
+    {
+        out_raw(opts.output == OUT_CSV ? "" : "null");
+        return;
+    }
+
+    sprintf(s, "%.17g", val);
+    out_raw(s);
+}
+
+
+/* ==========================================================================
+    finishes current record.  For csv header is printed first, if keys  of
+    this record are different than those of previous one
+   ========================================================================== */
+
+
+void out_record_end(void)
+{
+    if (opts.output == OUT_CSV)
+    {
+        if (strcmp(out_keys, out_header) != 0)
+        {
+            strcpy(out_header, out_keys);
+            printf("%s\n", out_header);
+        }
+
+        printf("%s\n", out_vals);
+    }
+    else
+    {
+        printf("}");
+    }
+
+    ++out_nrecords;
+    fflush(stdout);
+}
@@ -0,0 +1,36 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef OUT_H
+#define OUT_H 1
+
+/*
+ * max length of keys or values of single csv record
+ */
+
+#define OUT_LINE_MAX 4096
+
+/*
+ * max length of escaped character of string value, with nul, json escapes
+ * control characters as \u00XX
+ */
+
+#define OUT_ESCAPE_MAX 7
+
+int out_text(void);
+const char *out_test_name(void);
+const char *out_method_name(void);
+const char *out_dist_name(void);
+void out_begin(void);
+void out_end(void);
+void out_record(const char *type);
+void out_escape(int c, char *esc);
+void out_str(const char *key, const char *val);
+void out_ulong(const char *key, unsigned long val);
+void out_double(const char *key, double val);
+void out_record_end(void);
+
+#endif
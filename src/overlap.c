@@ -0,0 +1,507 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "overlap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OVERLAP_HAVE_PREFETCH
+#include <emmintrin.h>
+#endif
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *mode_names[] =
+{
+    "copy",
+    "compute",
+    "serial",
+    "pipeline",
+    "direct",
+    "prefetch"
+};
+
+/*
+ * result of computation is stored here, so compiler can't throw it away
+ */
+
+static volatile unsigned long overlap_sink;
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    compute kernel, every word of 'p' goes through opts.intensity multiply
+    and add rounds, and is then summed into 'acc'.  Rounds of one word
+    depend on each other, but words don't, so core can run them  out  of
+    order with loads of the next words.
+
+    returns:
+            'acc' with all words of 'p' added
+   ========================================================================== */
+
+
+static unsigned long overlap_compute
+(
+    const unsigned char   *p,      /* data to compute on */
+    size_t                 n,      /* number of bytes in 'p' */
+    unsigned long          acc     /* accumulator from previous calls */
+)
+{
+    const unsigned long   *w;      /* 'p' as words */
+    unsigned long          x;      /* currently computed word */
+    unsigned long          k;      /* round of computation */
+    size_t                 i;      /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    w = (const unsigned long *)p;
+
+    for (i = 0; i != n / sizeof(*w); ++i)
+    {
+        x = w[i];
+
+        for (k = 0; k != opts.intensity; ++k)
+        {
+            x = x * 1103515245UL + 12345UL;
+        }
+
+        acc += x;
+    }
+
+    return acc;
+}
+
+
+/* ==========================================================================
+    copies 'n' bytes from 'src' to 'dst' word by word.  libc memcpy  uses
+    string instructions for copies of this size, and they don't start until
+    older instructions retire, so they can't overlap with anything.  Plain
+    loads and stores go through out of order window like compute does.
+   ========================================================================== */
+
+
+static void overlap_copy
+(
+    unsigned char         *dst,    /* where to copy */
+    const unsigned char   *src,    /* what to copy */
+    size_t                 n       /* number of bytes to copy */
+)
+{
+    unsigned long         *d;      /* 'dst' as words */
+    const unsigned long   *s;      /* 'src' as words */
+    size_t                 i;      /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    d = (unsigned long *)dst;
+    s = (const unsigned long *)src;
+
+    for (i = 0; i != n / sizeof(*d); ++i)
+    {
+        d[i] = s[i];
+    }
+}
+
+
+/* ==========================================================================
+    prints rate and time of single pass of 'mode' in interval 'intvl'
+   ========================================================================== */
+
+
+static void overlap_report
+(
+    unsigned long       intvl,  /* interval number, counted from 1 */
+    enum overlap_mode   mode,   /* mode that was run */
+    double              bw,     /* processed MB/s */
+    double              us      /* time of single pass in us */
+)
+{
+    if (!out_text())
+    {
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("mode", mode_names[mode]);
+        out_double("rate_mbps", bw);
+        out_double("pass_us", us);
+        out_record_end();
+        return;
+    }
+
+    printf("%-8s rate %8lu MB/s, pass %10lu us\n",
+           mode_names[mode],
+           (unsigned long)bw,
+           (unsigned long)us);
+}
+
+
+/* ==========================================================================
+    prints how much of memory and compute time is overlapped, from means
+    of all intervals.  Hidden is part of the shorter of copy and  compute
+    time, that pipeline saves over serial, 100% means whole shorter phase
+    runs in the shadow of the longer one.
+   ========================================================================== */
+
+
+static void overlap_summary
+(
+    const struct stats  *s,                    /* rate of each mode */
+    size_t               bytes                 /* bytes of single pass */
+)
+{
+    double               us[OVERLAP_MODE_MAX]; /* time of single pass */
+    double               shorter;              /* shorter of copy, compute */
+    double               hidden;               /* hidden part of shorter */
+    int                  m;                    /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (m = 0; m != OVERLAP_MODE_MAX; ++m)
+    {
+        us[m] = s[m].mean > 0 ?
+            bytes / (s[m].mean * 1024 * 1024) * 1000000.0 : 0;
+    }
+
+    shorter = us[OVERLAP_COPY] < us[OVERLAP_COMPUTE] ?
+        us[OVERLAP_COPY] : us[OVERLAP_COMPUTE];
+    hidden = shorter > 0 ?
+        (us[OVERLAP_SERIAL] - us[OVERLAP_PIPELINE]) / shorter : 0;
+
+    if (!out_text())
+    {
+        out_record("overlap");
+        out_double("copy_us", us[OVERLAP_COPY]);
+        out_double("compute_us", us[OVERLAP_COMPUTE]);
+        out_double("serial_us", us[OVERLAP_SERIAL]);
+        out_double("pipeline_us", us[OVERLAP_PIPELINE]);
+        out_double("hidden", hidden);
+        out_double("pipeline_speedup", us[OVERLAP_PIPELINE] > 0 ?
+                   us[OVERLAP_SERIAL] / us[OVERLAP_PIPELINE] : 0);
+#if OVERLAP_HAVE_PREFETCH
+        out_double("prefetch_speedup", us[OVERLAP_PREFETCH] > 0 ?
+                   us[OVERLAP_DIRECT] / us[OVERLAP_PREFETCH] : 0);
+#endif
+        out_record_end();
+        return;
+    }
+
+    printf("overlap\n");
+    printf("%-8s %14s %14s\n", "mode", "rate MB/s", "pass us");
+
+    for (m = 0; m != OVERLAP_MODE_MAX; ++m)
+    {
+        printf("%-8s %14lu %14lu\n",
+               mode_names[m],
+               (unsigned long)s[m].mean,
+               (unsigned long)us[m]);
+    }
+
+    printf("pipeline hides %.1f%% of shorter phase, %.2fx speedup "
+           "over serial\n",
+           hidden * 100,
+           us[OVERLAP_PIPELINE] > 0 ?
+               us[OVERLAP_SERIAL] / us[OVERLAP_PIPELINE] : 0);
+#if OVERLAP_HAVE_PREFETCH
+    printf("prefetch gives %.2fx speedup over direct\n",
+           us[OVERLAP_PREFETCH] > 0 ?
+               us[OVERLAP_DIRECT] / us[OVERLAP_PREFETCH] : 0);
+#endif
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    returns size of tile for 'block_size' block.  Two tiles must fit  in
+    the block, so smaller blocks get smaller tiles, down to single step.
+
+    returns:
+            size of tile, multiple of OVERLAP_STEP
+            0 when block can't hold two steps
+   ========================================================================== */
+
+
+size_t overlap_tile
+(
+    size_t   block_size  /* size of block to process */
+)
+{
+    size_t   tile;       /* size of single tile */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    tile = block_size / 2 < OVERLAP_TILE ? block_size / 2 : OVERLAP_TILE;
+    return tile - tile % OVERLAP_STEP;
+}
+
+
+/* ==========================================================================
+    processes whole block once, tile by tile, the way 'mode' says
+
+        copy        only copies tiles into work buffers
+        compute     only computes on work buffers, that are in cache
+        serial      copies tile into work buffer, then computes on it
+        pipeline    copies part of next tile into the other work buffer,
+                    then computes on part of current one, and so on
+        direct      computes on block itself, without copying
+        prefetch    like direct, but prefetches part of next tile  before
+                    computing on part of current one
+
+    returns:
+            'acc' with results of computation added
+   ========================================================================== */
+
+
+unsigned long overlap_pass
+(
+    enum overlap_mode      mode,   /* how to process block */
+    const unsigned char   *src,    /* block to process */
+    unsigned char        **work,   /* double buffer for tiles */
+    size_t                 tile,   /* size of single tile */
+    size_t                 ntiles, /* number of tiles in block */
+    unsigned long          acc     /* accumulator from previous calls */
+)
+{
+    size_t                 t;      /* current tile */
+    size_t                 off;    /* offset of step in tile */
+#if OVERLAP_HAVE_PREFETCH
+    size_t                 l;      /* offset of prefetched line in step */
+#endif
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    switch (mode)
+    {
+    case OVERLAP_COPY:
+        for (t = 0; t != ntiles; ++t)
+        {
+            overlap_copy(work[t & 1], src + t * tile, tile);
+        }
+
+        break;
+
+    case OVERLAP_COMPUTE:
+        for (t = 0; t != ntiles; ++t)
+        {
+            acc = overlap_compute(work[t & 1], tile, acc);
+        }
+
+        break;
+
+    case OVERLAP_SERIAL:
+        for (t = 0; t != ntiles; ++t)
+        {
+            overlap_copy(work[t & 1], src + t * tile, tile);
+            acc = overlap_compute(work[t & 1], tile, acc);
+        }
+
+        break;
+
+    case OVERLAP_PIPELINE:
+        overlap_copy(work[0], src, tile);
+
+        for (t = 0; t != ntiles; ++t)
+        {
+            for (off = 0; off != tile; off += OVERLAP_STEP)
+            {
+                if (t + 1 != ntiles)
+                {
+                    overlap_copy(work[(t + 1) & 1] + off,
+                                 src + (t + 1) * tile + off, OVERLAP_STEP);
+                }
+
+                acc = overlap_compute(work[t & 1] + off, OVERLAP_STEP, acc);
+            }
+        }
+
+        break;
+
+    case OVERLAP_DIRECT:
+        acc = overlap_compute(src, ntiles * tile, acc);
+        break;
+
+#if OVERLAP_HAVE_PREFETCH
+    case OVERLAP_PREFETCH:
+        for (t = 0; t != ntiles; ++t)
+        {
+            for (off = 0; off != tile; off += OVERLAP_STEP)
+            {
+                for (l = 0; t + 1 != ntiles && l != OVERLAP_STEP; l += 64)
+                {
+                    _mm_prefetch((const char *)src + (t + 1) * tile +
+                                 off + l, _MM_HINT_T0);
+                }
+
+                acc = overlap_compute(src + t * tile + off, OVERLAP_STEP,
+                                      acc);
+            }
+        }
+
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    return acc;
+}
+
+
+/* ==========================================================================
+    measures how well core overlaps memory transfers with computation.
+    Block of opts.block_size is processed in OVERLAP_TILE tiles, with
+    opts.intensity multiply and add rounds per word, serially (copy tile
+    then compute on it) and pipelined (next tile is copied, or prefetched,
+    while current one is computed).  Copy and compute alone are run  too,
+    to know how long each phase takes on its own.  Every mode processes
+    opts.report_intvl bytes per interval.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory or block is too small
+   ========================================================================== */
+
+
+int overlap_bench(void)
+{
+    struct stats          s[OVERLAP_MODE_MAX]; /* rate of each mode */
+    unsigned char        *src;                 /* block to process */
+    unsigned char        *work[2];             /* double buffer for tiles */
+    unsigned long         acc;                 /* result of computation */
+    unsigned long         i;                   /* iterator for loop */
+    size_t                tile;                /* size of single tile */
+    size_t                ntiles;              /* number of tiles in block */
+    size_t                bytes;               /* bytes processed in one pass */
+    double                done;                /* bytes processed in interval */
+    double                sec;                 /* time of interval */
+    struct ts             start;               /* timer indicating start */
+    struct ts             finish;              /* timer indicating finish */
+    struct ts             taken;               /* time taken by interval */
+    int                   m;                   /* current mode */
+    int                   rc;                  /* return code */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    acc = 0;
+
+    tile = overlap_tile(opts.block_size);
+
+    if (tile == 0)
+    {
+        fprintf(stderr, "Block size must be at least %d bytes\n",
+                2 * OVERLAP_STEP);
+        return -1;
+    }
+
+    ntiles = opts.block_size / tile;
+    bytes = ntiles * tile;
+
+    for (m = 0; m != OVERLAP_MODE_MAX; ++m)
+    {
+        stats_init(&s[m]);
+    }
+
+    src = malloc(bytes);
+    work[0] = malloc(tile);
+    work[1] = malloc(tile);
+
+    if (src == NULL || work[0] == NULL || work[1] == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for buffers\n");
+        goto error;
+    }
+
+    memset(src, 0x5a, bytes);
+    memset(work[0], 0xa5, tile);
+    memset(work[1], 0xa5, tile);
+
+    if (out_text())
+    {
+        printf("block size %lu bytes, tile %lu bytes, %lu rounds per word, "
+               "iterations %lu\n",
+               (unsigned long)bytes,
+               (unsigned long)tile,
+               opts.intensity,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(s, OVERLAP_MODE_MAX, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (m = 0; m != OVERLAP_MODE_MAX; ++m)
+        {
+            ts(&start);
+
+            for (done = 0; done < opts.report_intvl; done += bytes)
+            {
+                acc = overlap_pass(m, src, work, tile, ntiles, acc);
+            }
+
+            ts(&finish);
+            ts_reset(&taken);
+            ts_add_diff(&taken, &start, &finish);
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            sec = ts2sec(&taken);
+            sec = sec > 0 ? sec : 1e-9;
+            overlap_report(i - opts.warmup + 1, m,
+                           done / sec / (1024 * 1024),
+                           sec / (done / bytes) * 1000000.0);
+
+            if (stats_add(&s[m], done / sec / (1024 * 1024)) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+        }
+    }
+
+    overlap_sink = acc;
+
+    if (out_text())
+    {
+        printf("summary of processing rate\n");
+    }
+
+    for (m = 0; m != OVERLAP_MODE_MAX; ++m)
+    {
+        stats_compute(&s[m], opts.outlier_mad);
+        stats_print(&s[m], mode_names[m], "MB/s");
+    }
+
+    overlap_summary(s, bytes);
+    rc = 0;
+
+error:
+    for (m = 0; m != OVERLAP_MODE_MAX; ++m)
+    {
+        stats_destroy(&s[m]);
+    }
+
+    free(work[0]);
+    free(work[1]);
+    free(src);
+    return rc;
+}
@@ -0,0 +1,49 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef OVERLAP_H
+#define OVERLAP_H 1
+
+#include <stddef.h>
+
+#include "config.h"
+
+/*
+ * block is processed in tiles of OVERLAP_TILE bytes, two of them fit in
+ * L2 together, and in pipelined modes next tile is brought in  between
+ * compute of OVERLAP_STEP parts of current one
+ */
+
+#define OVERLAP_TILE (64 * 1024)
+#define OVERLAP_STEP (4 * 1024)
+
+/*
+ * prefetch mode is done with sse intrinsics
+ */
+
+#if HAVE_EMMINTRIN_H && defined(__SSE2__)
+#define OVERLAP_HAVE_PREFETCH 1
+#endif
+
+enum overlap_mode
+{
+    OVERLAP_COPY,
+    OVERLAP_COMPUTE,
+    OVERLAP_SERIAL,
+    OVERLAP_PIPELINE,
+    OVERLAP_DIRECT,
+#if OVERLAP_HAVE_PREFETCH
+    OVERLAP_PREFETCH,
+#endif
+    OVERLAP_MODE_MAX
+};
+
+size_t overlap_tile(size_t block_size);
+unsigned long overlap_pass(enum overlap_mode mode, const unsigned char *src,
+    unsigned char **work, size_t tile, size_t ntiles, unsigned long acc);
+int overlap_bench(void);
+
+#endif
@@ -0,0 +1,572 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "pcopy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+#if HAVE_PTHREAD_H
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *mode_names[PCOPY_MODE_MAX] =
+{
+    "static",
+    "dynamic"
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    claims next chunk for dynamic mode
+
+    returns:
+            number of claimed chunk, p->nchunks or more when all are taken
+   ========================================================================== */
+
+
+static size_t pcopy_claim
+(
+    struct pcopy_pool  *p  /* pool to claim chunk from */
+)
+{
+#if HAVE_SYNC_BUILTINS
+    return __sync_fetch_and_add(&p->next, 1);
+#else
+    size_t              c; /* claimed chunk */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    pthread_mutex_lock(&p->lock);
+    c = p->next++;
+    pthread_mutex_unlock(&p->lock);
+
+    return c;
+#endif
+}
+
+
+/* ==========================================================================
+    copies part of buffer that belongs to worker 'id'.  In static mode it
+    is every n-th chunk starting from 'id', in dynamic mode worker claims
+    next free chunk until none is left.
+   ========================================================================== */
+
+
+static void pcopy_part
+(
+    struct pcopy_pool  *p,    /* pool with copy to do */
+    unsigned long       id    /* number of worker */
+)
+{
+    size_t              c;    /* current chunk */
+    size_t              off;  /* offset of chunk in buffer */
+    size_t              len;  /* length of chunk */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    c = p->mode == PCOPY_STATIC ? id : pcopy_claim(p);
+
+    while (c < p->nchunks)
+    {
+        off = c * p->chunk;
+        len = opts.block_size - off < p->chunk ?
+            opts.block_size - off : p->chunk;
+        memcpy(p->dst + off, p->src + off, len);
+
+        c = p->mode == PCOPY_STATIC ? c + p->n : pcopy_claim(p);
+    }
+}
+
+
+/* ==========================================================================
+    worker thread of the pool, copies its part every time it is released
+    on start barrier, until pool quits
+   ========================================================================== */
+
+
+static void *pcopy_thread
+(
+    void                 *arg   /* struct pcopy_worker of this thread */
+)
+{
+    struct pcopy_worker  *w;    /* this worker */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    w = arg;
+
+    for (;;)
+    {
+        barrier_wait(&w->pool->start);
+
+        if (w->pool->quit)
+        {
+            return NULL;
+        }
+
+        pcopy_part(w->pool, w->id);
+        barrier_wait(&w->pool->done);
+    }
+}
+
+
+/* ==========================================================================
+    prints rate of copying with 'mode' and 'chunk'.  Single threaded memcpy
+    of whole buffer is reported with 'chunk' 0.
+   ========================================================================== */
+
+
+static void pcopy_report
+(
+    unsigned long     intvl,     /* interval number, counted from 1 */
+    enum pcopy_mode   mode,      /* how chunks were given to threads */
+    size_t            chunk,     /* size of chunk, 0 for memcpy */
+    double            mbps       /* rate in MB/s */
+)
+{
+    if (!out_text())
+    {
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("mode", chunk ? mode_names[mode] : "memcpy");
+        out_ulong("chunk", chunk);
+        out_double("rate_mbps", mbps);
+        out_record_end();
+        return;
+    }
+
+    if (chunk == 0)
+    {
+        printf("%-7s %-16s rate %8lu MB/s\n", "memcpy", "1 thread",
+               (unsigned long)mbps);
+        return;
+    }
+
+    printf("%-7s chunk %10lu B rate %8lu MB/s\n",
+           mode_names[mode],
+           (unsigned long)chunk,
+           (unsigned long)mbps);
+}
+
+
+/* ==========================================================================
+    prints configuration with the best mean rate out of 'n' in 's'.  First
+    one is single threaded memcpy, rest are 'nchunks' chunks of each mode.
+   ========================================================================== */
+
+
+static void pcopy_best
+(
+    const struct stats  *s,        /* rate of each configuration */
+    const size_t        *chunks,   /* chunk sizes */
+    size_t               nchunks   /* number of chunk sizes */
+)
+{
+    size_t               best;     /* best configuration */
+    size_t               i;        /* iterator for loop */
+    double               speedup;  /* best rate against memcpy */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 2, best = 1; i != 1 + PCOPY_MODE_MAX * nchunks; ++i)
+    {
+        if (s[i].mean > s[best].mean)
+        {
+            best = i;
+        }
+    }
+
+    speedup = s[0].mean > 0 ? s[best].mean / s[0].mean : 0;
+
+    if (!out_text())
+    {
+        out_record("best");
+        out_str("mode", mode_names[(best - 1) / nchunks]);
+        out_ulong("chunk", chunks[(best - 1) % nchunks]);
+        out_double("rate_mbps", s[best].mean);
+        out_double("speedup", speedup);
+        out_record_end();
+        return;
+    }
+
+    printf("best: %s chunks of %lu bytes, rate %lu MB/s, %.2fx single "
+           "thread memcpy\n",
+           mode_names[(best - 1) / nchunks],
+           (unsigned long)chunks[(best - 1) % nchunks],
+           (unsigned long)s[best].mean,
+           speedup);
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    copies whole buffer once, with all threads of pool 'p'
+   ========================================================================== */
+
+
+void pcopy_run
+(
+    struct pcopy_pool  *p  /* pool to copy with */
+)
+{
+    p->next = 0;
+
+    if (p->n == 1)
+    {
+        pcopy_part(p, 0);
+        return;
+    }
+
+    barrier_wait(&p->start);
+    pcopy_part(p, 0);
+    barrier_wait(&p->done);
+}
+
+
+/* ==========================================================================
+    starts 'n' - 1 workers of pool 'p', calling thread is the last  one.
+    'workers' must have room for 'n' workers.
+
+    returns:
+             0      pool is running
+            -1      couldn't initialize pool or start its threads
+   ========================================================================== */
+
+
+int pcopy_pool_start
+(
+    struct pcopy_pool    *p,        /* pool to start */
+    struct pcopy_worker  *workers,  /* state of workers */
+    unsigned long         n         /* number of threads */
+)
+{
+    unsigned long         i;        /* iterator for loop */
+    unsigned long         k;        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    p->n = n;
+    p->quit = 0;
+
+    if (pthread_mutex_init(&p->lock, NULL) != 0)
+    {
+        return -1;
+    }
+
+    if (barrier_init(&p->start, n) != 0)
+    {
+        pthread_mutex_destroy(&p->lock);
+        return -1;
+    }
+
+    if (barrier_init(&p->done, n) != 0)
+    {
+        barrier_destroy(&p->start);
+        pthread_mutex_destroy(&p->lock);
+        return -1;
+    }
+
+    for (i = 1; i < n; ++i)
+    {
+        workers[i].pool = p;
+        workers[i].id = i;
+
+        if (pthread_create(&p->tids[i], NULL, pcopy_thread, &workers[i]) != 0)
+        {
+            /*
+             * workers that were already started wait for the rest on start
+             * barrier, release them with quit set, so they exit at once
+             */
+
+            p->quit = 1;
+            barrier_resize(&p->start, i - 1);
+
+            for (k = 1; k < i; ++k)
+            {
+                pthread_join(p->tids[k], NULL);
+            }
+
+            barrier_destroy(&p->done);
+            barrier_destroy(&p->start);
+            pthread_mutex_destroy(&p->lock);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* ==========================================================================
+    stops all workers of pool 'p' and releases its resources
+   ========================================================================== */
+
+
+void pcopy_pool_stop
+(
+    struct pcopy_pool  *p  /* pool to stop */
+)
+{
+    unsigned long       i; /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (p->n > 1)
+    {
+        p->quit = 1;
+        barrier_wait(&p->start);
+    }
+
+    for (i = 1; i < p->n; ++i)
+    {
+        pthread_join(p->tids[i], NULL);
+    }
+
+    barrier_destroy(&p->done);
+    barrier_destroy(&p->start);
+    pthread_mutex_destroy(&p->lock);
+}
+
+
+/* ==========================================================================
+    fills 'chunks' with chunk sizes to sweep
+
+    returns:
+            number of chunk sizes
+   ========================================================================== */
+
+
+size_t pcopy_chunks
+(
+    size_t   *chunks  /* chunk sizes are stored here */
+)
+{
+    size_t    even;   /* chunk that gives every thread one of them */
+    size_t    c;      /* current chunk size */
+    size_t    n;      /* number of chunk sizes */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    even = (opts.block_size + opts.threads - 1) / opts.threads;
+
+    for (c = PCOPY_CHUNK_MIN, n = 0; c < even && n != PCOPY_CHUNKS_MAX - 1;
+         c *= 4)
+    {
+        chunks[n++] = c;
+    }
+
+    chunks[n++] = even;
+    return n;
+}
+
+
+/* ==========================================================================
+    sets pool 'p' to give chunks of 'chunk' bytes with 'mode', last chunk
+    is shorter when opts.block_size is not multiple of 'chunk'
+   ========================================================================== */
+
+
+void pcopy_chunk
+(
+    struct pcopy_pool  *p,      /* pool to set */
+    enum pcopy_mode     mode,   /* how chunks are given to threads */
+    size_t              chunk   /* size of single chunk */
+)
+{
+    p->mode = mode;
+    p->chunk = chunk;
+    p->nchunks = (opts.block_size + chunk - 1) / chunk;
+}
+
+
+/* ==========================================================================
+    measures how fast single opts.block_size copy runs, when it is split
+    across pool of opts.threads threads.  Buffer is cut into chunks, given
+    to threads either statically (every n-th chunk) or dynamically (next
+    free chunk), and chunk size is swept.  Single threaded memcpy of the
+    same buffer is measured as well, so the best configuration can be told
+    apart from not splitting at all.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory or start threads
+   ========================================================================== */
+
+
+int pcopy_bench(void)
+{
+    struct pcopy_pool     pool;           /* pool of copying threads */
+    struct pcopy_worker  *workers;        /* state of workers */
+    struct stats          s[1 + PCOPY_MODE_MAX * PCOPY_CHUNKS_MAX]; /* rates */
+    size_t                chunks[PCOPY_CHUNKS_MAX]; /* chunk sizes */
+    size_t                nchunks;        /* number of chunk sizes */
+    size_t                loops;          /* copies in one interval */
+    size_t                nconf;          /* number of configurations */
+    size_t                c;              /* current configuration */
+    size_t                j;              /* iterator for loop */
+    unsigned long         i;              /* iterator for loop */
+    struct ts             start;          /* timer indicating copy start */
+    struct ts             finish;         /* timer indicating copy finish */
+    struct ts             taken;          /* time taken by copies */
+    double                mbps;           /* rate of configuration */
+    double                sec;            /* time taken in seconds */
+    char                  name[48];       /* name of configuration */
+    int                   rc;             /* return code */
+    struct jedec          jd_size;        /* size in jedec format */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    nchunks = pcopy_chunks(chunks);
+    nconf = 1 + PCOPY_MODE_MAX * nchunks;
+
+    for (c = 0; c != nconf; ++c)
+    {
+        stats_init(&s[c]);
+    }
+
+    memset(&pool, 0, sizeof(pool));
+    pool.dst = malloc(opts.block_size);
+    pool.src = malloc(opts.block_size);
+    pool.tids = malloc(opts.threads * sizeof(*pool.tids));
+    workers = malloc(opts.threads * sizeof(*workers));
+
+    if (pool.dst == NULL || pool.src == NULL || pool.tids == NULL ||
+        workers == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+        goto error;
+    }
+
+    memset(pool.src, 0x55, opts.block_size);
+    memset(pool.dst, 0, opts.block_size);
+
+    if (pcopy_pool_start(&pool, workers, opts.threads) != 0)
+    {
+        fprintf(stderr, "Couldn't start thread pool\n");
+        goto error;
+    }
+
+    loops = opts.report_intvl / opts.block_size;
+    loops = loops ? loops : 1;
+    bytes2jedec(opts.block_size, &jd_size);
+
+    if (out_text())
+    {
+        printf("block size: %lu %cB, threads %lu, copies per interval %lu, "
+               "iterations %lu\n",
+               jd_size.val,
+               jd_size.pre,
+               opts.threads,
+               (unsigned long)loops,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(s, nconf, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (c = 0; c != nconf; ++c)
+        {
+            ts_reset(&taken);
+
+            if (c)
+            {
+                pcopy_chunk(&pool, (enum pcopy_mode)((c - 1) / nchunks),
+                            chunks[(c - 1) % nchunks]);
+            }
+
+            for (j = 0; j != loops; ++j)
+            {
+                ts(&start);
+
+                if (c == 0)
+                {
+                    memcpy(pool.dst, pool.src, opts.block_size);
+                }
+                else
+                {
+                    pcopy_run(&pool);
+                }
+
+                ts(&finish);
+                ts_add_diff(&taken, &start, &finish);
+            }
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            sec = ts2sec(&taken);
+            sec = sec > 0 ? sec : 1e-9;
+            mbps = (double)loops * opts.block_size / sec / (1024 * 1024);
+            pcopy_report(i - opts.warmup + 1, pool.mode, c ? pool.chunk : 0,
+                         mbps);
+
+            if (stats_add(&s[c], mbps) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                pcopy_pool_stop(&pool);
+                goto error;
+            }
+        }
+    }
+
+    pcopy_pool_stop(&pool);
+
+    if (out_text())
+    {
+        printf("summary of copy rate\n");
+    }
+
+    for (c = 0; c != nconf; ++c)
+    {
+        if (c == 0)
+        {
+            strcpy(name, "memcpy 1 thread");
+        }
+        else
+        {
+            sprintf(name, "%s %lu", mode_names[(c - 1) / nchunks],
+                    (unsigned long)chunks[(c - 1) % nchunks]);
+        }
+
+        stats_compute(&s[c], opts.outlier_mad);
+        stats_print(&s[c], name, "MB/s");
+    }
+
+    pcopy_best(s, chunks, nchunks);
+    rc = 0;
+
+error:
+    for (c = 0; c != nconf; ++c)
+    {
+        stats_destroy(&s[c]);
+    }
+
+    free(pool.dst);
+    free(pool.src);
+    free(pool.tids);
+    free(workers);
+    return rc;
+}
+
+#endif
@@ -0,0 +1,70 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef PCOPY_H
+#define PCOPY_H 1
+
+#include <stddef.h>
+
+#include "utils.h"
+
+/*
+ * smallest chunk in the sweep, every next one is 4 times bigger,  until
+ * chunk is big enough to give each thread one chunk of buffer
+ */
+
+#define PCOPY_CHUNK_MIN (4 * 1024)
+#define PCOPY_CHUNKS_MAX 24
+
+#if HAVE_PTHREAD_H
+
+enum pcopy_mode
+{
+    PCOPY_STATIC,
+    PCOPY_DYNAMIC,
+    PCOPY_MODE_MAX
+};
+
+/*
+ * pool of threads that stays alive for whole test.  Calling thread is
+ * worker 0, others wait on 'start' for next copy, and meet on 'done' when
+ * their part is copied.
+ */
+
+struct pcopy_pool
+{
+    struct barrier    start;    /* releases workers to copy */
+    struct barrier    done;     /* waits until all parts are copied */
+    pthread_mutex_t   lock;     /* guards 'next' without atomics */
+    pthread_t        *tids;     /* ids of workers 1 and up */
+    unsigned char    *dst;      /* destination of the copy */
+    unsigned char    *src;      /* source of the copy */
+    size_t            chunk;    /* size of single chunk */
+    size_t            nchunks;  /* number of chunks in buffer */
+    size_t            next;     /* next chunk to claim in dynamic mode */
+    enum pcopy_mode   mode;     /* how chunks are given to threads */
+    unsigned long     n;        /* number of threads, with calling one */
+    int               quit;     /* tells workers to exit */
+};
+
+struct pcopy_worker
+{
+    struct pcopy_pool  *pool;   /* pool worker belongs to */
+    unsigned long       id;     /* number of the worker */
+};
+
+size_t pcopy_chunks(size_t *chunks);
+int pcopy_pool_start(struct pcopy_pool *p, struct pcopy_worker *workers,
+    unsigned long n);
+void pcopy_run(struct pcopy_pool *p);
+void pcopy_chunk(struct pcopy_pool *p, enum pcopy_mode mode, size_t chunk);
+void pcopy_pool_stop(struct pcopy_pool *p);
+
+#endif
+
+int pcopy_bench(void);
+
+#endif
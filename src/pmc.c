@@ -0,0 +1,341 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "pmc.h"
+
+#include "config.h"
+
+#if HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+
+/* ==== Private macros ====================================================== */
+
+
+#if HAVE_LINUX_PERF_EVENT_H
+
+/*
+ * config of generic hardware cache event for read misses in 'cache'
+ */
+
+#define PMC_CACHE_MISS(cache) ((cache) | \
+    (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+
+/* ==== Private variables =================================================== */
+
+
+struct pmc_event
+{
+    __u32        type;    /* type of event, PERF_TYPE_* */
+    __u64        config;  /* event within type */
+    const char  *name;    /* name of counter for records */
+    const char  *abbr;    /* short name of counter for text */
+};
+
+/*
+ * there is no generic l1d replacement event, l1d read misses  is  what
+ * kernel maps to L1D.REPLACEMENT on intel, and the closest thing elsewhere
+ */
+
+static const struct pmc_event pmc_hw[] =
+{
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles", "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions",
+        "insn" },
+    { PERF_TYPE_HW_CACHE, PMC_CACHE_MISS(PERF_COUNT_HW_CACHE_LL),
+        "llc_misses", "llc-miss" },
+    { PERF_TYPE_HW_CACHE, PMC_CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB),
+        "dtlb_misses", "dtlb-miss" },
+    { PERF_TYPE_HW_CACHE, PMC_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D),
+        "l1d_replacements", "l1d-repl" }
+};
+
+/*
+ * software events are always available, they can't explain cache or tlb
+ * behaviour, but show when kernel got in the way
+ */
+
+static const struct pmc_event pmc_sw[] =
+{
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, "task_clock_ns",
+        "task-ns" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, "page_faults",
+        "faults" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES,
+        "context_switches", "ctx-sw" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, "cpu_migrations",
+        "migrations" }
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    opens counter for event 'e' in group of 'leader', or new group  when
+    'leader' is -1.  Counter starts disabled, counts only  user  space  of
+    calling thread.
+
+    returns:
+            file descriptor of counter, or -1 when it can't be opened
+   ========================================================================== */
+
+
+static int pmc_open_event
+(
+    const struct pmc_event  *e,      /* event to open */
+    int                      leader  /* group leader or -1 */
+)
+{
+    struct perf_event_attr   attr;   /* attributes of event */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = e->type;
+    attr.config = e->config;
+    attr.disabled = leader == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP |
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+
+/* ==========================================================================
+    opens group of 'n' 'events' into 'p'.  Events that are not  supported
+    are skipped, but group leader is required.
+
+    returns:
+             0      group opened
+            -1      group leader couldn't be opened
+   ========================================================================== */
+
+
+static int pmc_open_group
+(
+    struct pmc              *p,       /* counters to open */
+    const struct pmc_event  *events,  /* events to open */
+    int                      n        /* number of events */
+)
+{
+    int                      fd;      /* descriptor of opened counter */
+    int                      i;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 0; i != n; ++i)
+    {
+        fd = pmc_open_event(&events[i], p->n ? p->fd[0] : -1);
+
+        if (fd < 0)
+        {
+            if (p->n == 0)
+            {
+                return -1;
+            }
+
+            continue;
+        }
+
+        p->fd[p->n] = fd;
+        p->name[p->n] = events[i].name;
+        p->abbr[p->n] = events[i].abbr;
+        ++p->n;
+    }
+
+    return 0;
+}
+
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    opens 'counters' for calling thread.  Hardware counters fall back  to
+    software events, when pmu is not available (no pmu in virtual machine,
+    or perf_event_paranoid doesn't allow it).  Counters are disabled until
+    pmc_enable() is called.
+
+    returns:
+             0      counters opened, or CNT_NONE was requested
+            -1      no counters could be opened, p->n is 0
+   ========================================================================== */
+
+
+int pmc_open
+(
+    struct pmc     *p,        /* counters to open */
+    enum counters   counters  /* which counters to open */
+)
+{
+    memset(p, 0, sizeof(*p));
+
+    if (counters == CNT_NONE)
+    {
+        return 0;
+    }
+
+#if HAVE_LINUX_PERF_EVENT_H
+    if (counters == CNT_HW &&
+        pmc_open_group(p, pmc_hw, sizeof(pmc_hw) / sizeof(*pmc_hw)) == 0)
+    {
+        return 0;
+    }
+
+    if (pmc_open_group(p, pmc_sw, sizeof(pmc_sw) / sizeof(*pmc_sw)) == 0)
+    {
+        p->sw = 1;
+        return 0;
+    }
+#endif
+
+    return -1;
+}
+
+
+/* ==========================================================================
+    zeroes all counters in 'p'
+   ========================================================================== */
+
+
+void pmc_reset
+(
+    struct pmc  *p  /* counters to reset */
+)
+{
+#if HAVE_LINUX_PERF_EVENT_H
+    if (p->n)
+    {
+        ioctl(p->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    (void)p;
+#endif
+}
+
+
+/* ==========================================================================
+    starts counting, counters are accumulated between  pmc_enable()  and
+    pmc_disable() until pmc_reset() is called
+   ========================================================================== */
+
+
+void pmc_enable
+(
+    struct pmc  *p  /* counters to enable */
+)
+{
+#if HAVE_LINUX_PERF_EVENT_H
+    if (p->n)
+    {
+        ioctl(p->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    (void)p;
+#endif
+}
+
+
+/* ==========================================================================
+    stops counting
+   ========================================================================== */
+
+
+void pmc_disable
+(
+    struct pmc  *p  /* counters to disable */
+)
+{
+#if HAVE_LINUX_PERF_EVENT_H
+    if (p->n)
+    {
+        ioctl(p->fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    (void)p;
+#endif
+}
+
+
+/* ==========================================================================
+    reads counters of 'p' into p->val.  When kernel had to multiplex  the
+    group with other events, counts are scaled up by the time  group  was
+    not running.
+
+    returns:
+             0      counters read
+            -1      counters are not opened or couldn't be read
+   ========================================================================== */
+
+
+int pmc_read
+(
+    struct pmc  *p                 /* counters to read */
+)
+{
+#if HAVE_LINUX_PERF_EVENT_H
+    __u64        buf[3 + PMC_MAX]; /* nr, time enabled, running, values */
+    double       scale;            /* multiplexing scale */
+    int          i;                /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (p->n == 0 || read(p->fd[0], buf, sizeof(buf)) <= 0)
+    {
+        return -1;
+    }
+
+    scale = buf[2] && buf[2] < buf[1] ? (double)buf[1] / buf[2] : 1;
+
+    for (i = 0; i != p->n && i != (int)buf[0]; ++i)
+    {
+        p->val[i] = buf[3 + i] * scale;
+    }
+
+    return 0;
+#else
+    (void)p;
+    return -1;
+#endif
+}
+
+
+/* ==========================================================================
+    closes all counters of 'p'
+   ========================================================================== */
+
+
+void pmc_close
+(
+    struct pmc  *p  /* counters to close */
+)
+{
+#if HAVE_LINUX_PERF_EVENT_H
+    int          i; /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = p->n - 1; i >= 0; --i)
+    {
+        close(p->fd[i]);
+    }
+#endif
+
+    p->n = 0;
+}
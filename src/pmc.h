@@ -0,0 +1,36 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef PMC_H
+#define PMC_H 1
+
+#include "opts.h"
+
+/*
+ * max number of counters in a group, hardware group holds cycles,
+ * instructions, llc misses, dtlb misses and l1d replacements
+ */
+
+#define PMC_MAX 5
+
+struct pmc
+{
+    int fd[PMC_MAX];           /* file descriptors, first is group leader */
+    const char *name[PMC_MAX]; /* name of each counter for records */
+    const char *abbr[PMC_MAX]; /* short name of each counter for text */
+    double val[PMC_MAX];       /* counts of last interval, multiplex scaled */
+    int n;                     /* number of opened counters, 0 if disabled */
+    int sw;                    /* software events are used */
+};
+
+int pmc_open(struct pmc *p, enum counters counters);
+void pmc_reset(struct pmc *p);
+void pmc_enable(struct pmc *p);
+void pmc_disable(struct pmc *p);
+int pmc_read(struct pmc *p);
+void pmc_close(struct pmc *p);
+
+#endif
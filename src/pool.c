@@ -0,0 +1,165 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "pool.h"
+
+#include <stdlib.h>
+
+#include "arena.h"
+
+
+/* ==== Private macros ====================================================== */
+
+
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    allocates new slab of objects and puts all of them on the  free  list.
+    First ARENA_ALIGN bytes of slab are used to link slabs together, so they
+    can be freed in pool_destroy()
+
+    returns:
+             0      slab added
+            -1      system is out of memory
+   ========================================================================== */
+
+
+static int pool_grow
+(
+    struct pool    *p      /* pool to add slab to */
+)
+{
+    unsigned char  *slab;  /* new slab of objects */
+    unsigned char  *obj;   /* object being put on free list */
+    size_t          i;     /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if ((slab = malloc(ARENA_ALIGN + p->obj_size * p->per_slab)) == NULL)
+    {
+        return -1;
+    }
+
+    *(void **)slab = p->slabs;
+    p->slabs = slab;
+
+    for (i = 0; i != p->per_slab; ++i)
+    {
+        obj = slab + ARENA_ALIGN + i * p->obj_size;
+        *(void **)obj = p->free;
+        p->free = obj;
+    }
+
+    return 0;
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    initializes pool of fixed size objects of 'obj_size' bytes.  Objects are
+    taken from system in slabs of about 'slab_size' bytes, but  single  slab
+    always holds at least one object.  Memory is kept  until  pool_destroy()
+    is called.
+   ========================================================================== */
+
+
+void pool_init
+(
+    struct pool  *p,         /* pool to initialize */
+    size_t        obj_size,  /* size of single object */
+    size_t        slab_size  /* size of memory taken from system at once */
+)
+{
+    obj_size = obj_size < sizeof(void *) ? sizeof(void *) : obj_size;
+
+    p->free = NULL;
+    p->slabs = NULL;
+    p->obj_size = ALIGN_UP(obj_size);
+    p->per_slab = slab_size / p->obj_size;
+    p->per_slab = p->per_slab ? p->per_slab : 1;
+}
+
+
+/* ==========================================================================
+    takes single object from pool
+
+    returns:
+            pointer to object, or NULL when system is out of memory
+   ========================================================================== */
+
+
+void *pool_alloc
+(
+    struct pool  *p    /* pool to take object from */
+)
+{
+    void         *obj; /* object taken from free list */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (p->free == NULL && pool_grow(p) != 0)
+    {
+        return NULL;
+    }
+
+    obj = p->free;
+    p->free = *(void **)obj;
+
+    return obj;
+}
+
+
+/* ==========================================================================
+    puts object back to the pool, NULL is ignored
+   ========================================================================== */
+
+
+void pool_free
+(
+    struct pool  *p,   /* pool that 'obj' was taken from */
+    void         *obj  /* object to return */
+)
+{
+    if (obj == NULL)
+    {
+        return;
+    }
+
+    *(void **)obj = p->free;
+    p->free = obj;
+}
+
+
+/* ==========================================================================
+    returns all slabs of pool back to system
+   ========================================================================== */
+
+
+void pool_destroy
+(
+    struct pool  *p     /* pool to destroy */
+)
+{
+    void         *slab; /* slab being freed */
+    void         *next; /* next slab to free */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (slab = p->slabs; slab; slab = next)
+    {
+        next = *(void **)slab;
+        free(slab);
+    }
+
+    p->free = NULL;
+    p->slabs = NULL;
+}
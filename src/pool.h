@@ -0,0 +1,25 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef POOL_H
+#define POOL_H 1
+
+#include <stddef.h>
+
+struct pool
+{
+    void *free;
+    void *slabs;
+    size_t obj_size;
+    size_t per_slab;
+};
+
+void pool_init(struct pool *p, size_t obj_size, size_t slab_size);
+void *pool_alloc(struct pool *p);
+void pool_free(struct pool *p, void *obj);
+void pool_destroy(struct pool *p);
+
+#endif
@@ -0,0 +1,424 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+
+#if HAVE_SCHED_SETAFFINITY || HAVE_SCHED_SETSCHEDULER
+#include <sched.h>
+#endif
+
+#if HAVE_MLOCKALL
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opts.h"
+#include "out.h"
+#include "quiet.h"
+#include "utils.h"
+
+
+/* ==== Private variables =================================================== */
+
+
+/*
+ * line of /proc/interrupts and interrupts count of each cpu, too big for
+ * stack
+ */
+
+static char           quiet_line[QUIET_LINE_MAX];
+static unsigned long  quiet_nirqs[QUIET_CPUS_MAX];
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    reports result of 'step' of quiet setup.  'err' is errno of failure,  0
+    for success and -1 when step is not supported on this system.  'detail'
+    describes what was done, it can be NULL.
+   ========================================================================== */
+
+
+static void quiet_report
+(
+    const char  *step,     /* what was done */
+    int          err,      /* result of step */
+    const char  *detail    /* details of step, or NULL */
+)
+{
+    const char  *status;   /* result of step as string */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    status = err == 0 ? "ok" : err == -1 ? "not supported" : strerror(err);
+    detail = detail ? detail : "";
+
+    if (out_text())
+    {
+        printf("quiet: %-12s %s%s%s\n",
+               step,
+               status,
+               *detail ? ", " : "",
+               detail);
+        return;
+    }
+
+    out_record("quiet");
+    out_str("step", step);
+    out_str("status", err == 0 ? "ok" : "failed");
+    out_str("error", err == 0 ? "" : status);
+    out_str("detail", detail);
+    out_record_end();
+}
+
+
+/* ==========================================================================
+    pins process to cpus with the fewest interrupts, so far, out of those
+    we are allowed to run on.  One cpu is taken for each thread, and one
+    more for the measuring thread, so helpers that spin never take  all
+    cpus from it.
+   ========================================================================== */
+
+
+static void quiet_affinity(void)
+{
+#if HAVE_SCHED_SETAFFINITY && defined(CPU_SET)
+    static int   allowed[QUIET_CPUS_MAX];  /* cpus we can run on */
+    static int   cpus[QUIET_CPUS_MAX];     /* picked cpus */
+    char         detail[256];              /* picked cpus as text */
+    cpu_set_t    set;                      /* affinity mask */
+    FILE        *f;                        /* /proc/interrupts */
+    size_t       len;                      /* length of detail */
+    int          ncpus;                    /* number of cpus in irqs */
+    int          n;                        /* number of picked cpus */
+    int          i;                        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    {
+        quiet_report("affinity", errno, NULL);
+        return;
+    }
+
+    if ((f = fopen("/proc/interrupts", "r")) == NULL)
+    {
+        quiet_report("affinity", errno, "can't read /proc/interrupts");
+        return;
+    }
+
+    ncpus = quiet_irqs(f, quiet_nirqs, QUIET_CPUS_MAX);
+    fclose(f);
+
+    for (i = 0; i != ncpus; ++i)
+    {
+        allowed[i] = i < CPU_SETSIZE && CPU_ISSET(i, &set);
+    }
+
+    n = quiet_pick(quiet_nirqs, allowed, ncpus, opts.threads + 1, cpus);
+
+    if (n == 0)
+    {
+        quiet_report("affinity", -1, "no cpus found in /proc/interrupts");
+        return;
+    }
+
+    CPU_ZERO(&set);
+    strcpy(detail, "cpus");
+
+    for (i = 0; i != n; ++i)
+    {
+        CPU_SET(cpus[i], &set);
+        len = strlen(detail);
+
+        if (len < sizeof(detail) - 32)
+        {
+            sprintf(detail + len, "%s %d (%lu irqs)",
+                    i ? "," : "",
+                    cpus[i],
+                    quiet_nirqs[cpus[i]]);
+        }
+    }
+
+    quiet_report("affinity",
+                 sched_setaffinity(0, sizeof(set), &set) == 0 ? 0 : errno,
+                 detail);
+#else
+    quiet_report("affinity", -1, NULL);
+#endif
+}
+
+
+/* ==========================================================================
+    raises calling thread to SCHED_FIFO.  Threads and processes it creates
+    later on start with normal policy, as tests run helpers that spin until
+    measuring thread tells them to stop, and at the same fifo priority they
+    would never give cpu back to it.
+   ========================================================================== */
+
+
+static void quiet_fifo(void)
+{
+#if HAVE_SCHED_SETSCHEDULER && defined(SCHED_FIFO)
+    struct sched_param  sp;      /* scheduling priority */
+    int                 policy;  /* scheduling policy */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = QUIET_FIFO_PRIO;
+    policy = SCHED_FIFO;
+
+#ifdef SCHED_RESET_ON_FORK
+    policy |= SCHED_RESET_ON_FORK;
+#endif
+
+    quiet_report("sched_fifo",
+                 sched_setscheduler(0, policy, &sp) == 0 ? 0 : errno,
+                 "priority 1, measuring thread only");
+#else
+    quiet_report("sched_fifo", -1, NULL);
+#endif
+}
+
+
+/* ==========================================================================
+    locks all current and future memory, so it's never paged out and  no
+    page fault hits measurement after memory was touched first time
+   ========================================================================== */
+
+
+static void quiet_mlock(void)
+{
+#if HAVE_MLOCKALL
+    struct rlimit  rl;          /* limit of locked memory */
+    char           detail[96];  /* why memory was not locked */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * with MCL_FUTURE every allocation over the limit fails,  and  buffers
+     * are allocated after this, so don't lock when unprivileged user  has
+     * finite limit, it would break benchmark instead of making it quiet
+     */
+
+    if (geteuid() != 0 && getrlimit(RLIMIT_MEMLOCK, &rl) == 0 &&
+        rl.rlim_cur != RLIM_INFINITY)
+    {
+        sprintf(detail, "memlock limit is %lu bytes, needs root",
+                (unsigned long)rl.rlim_cur);
+        quiet_report("mlockall", EPERM, detail);
+        return;
+    }
+
+    quiet_report("mlockall",
+                 mlockall(MCL_CURRENT | MCL_FUTURE) == 0 ? 0 : errno,
+                 NULL);
+#else
+    quiet_report("mlockall", -1, NULL);
+#endif
+}
+
+
+/* ==========================================================================
+    disables transparent huge pages for the process, so neither  page
+    faults nor khugepaged stall on compacting memory for them
+   ========================================================================== */
+
+
+static void quiet_thp(void)
+{
+#if HAVE_DECL_PR_SET_THP_DISABLE
+    quiet_report("thp_disable",
+                 prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0) == 0 ? 0 : errno,
+                 NULL);
+#else
+    quiet_report("thp_disable", -1, NULL);
+#endif
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    sums interrupts of each cpu from 'f' in /proc/interrupts format,  into
+    'irqs' of at most 'ncpus' cpus.  Columns are mapped to cpus  according
+    to the header, so offline cpus don't shift counts.
+
+    returns:
+            number of cpus in 'irqs', that is highest cpu in header plus 1,
+            0 when header couldn't be parsed
+   ========================================================================== */
+
+
+int quiet_irqs
+(
+    FILE           *f,                      /* /proc/interrupts */
+    unsigned long  *irqs,                   /* interrupts of each cpu */
+    int             ncpus                   /* max number of cpus */
+)
+{
+    static int      col[QUIET_CPUS_MAX];    /* cpu of each column */
+    char           *p;                      /* current position in line */
+    char           *ep;                     /* end of parsed number */
+    unsigned long   v;                      /* parsed number */
+    int             ncols;                  /* number of cpu columns */
+    int             max;                    /* number of cpus in irqs */
+    int             i;                      /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    memset(irqs, 0, ncpus * sizeof(*irqs));
+
+    if (fgets(quiet_line, sizeof(quiet_line), f) == NULL)
+    {
+        return 0;
+    }
+
+    /*
+     * header is like "     CPU0    CPU1    CPU3"
+     */
+
+    ncols = 0;
+    max = 0;
+
+    for (p = strstr(quiet_line, "CPU"); p; p = strstr(p, "CPU"))
+    {
+        p += 3;
+        i = strtol(p, &ep, 10);
+
+        if (ep == p || i < 0 || i >= ncpus || ncols == QUIET_CPUS_MAX)
+        {
+            continue;
+        }
+
+        col[ncols++] = i;
+        max = i + 1 > max ? i + 1 : max;
+    }
+
+    while (fgets(quiet_line, sizeof(quiet_line), f))
+    {
+        /*
+         * skip irq name, like " 24:" or "NMI:", then there is count for
+         * each cpu, lines like "ERR:" have just one
+         */
+
+        if ((p = strchr(quiet_line, ':')) == NULL)
+        {
+            continue;
+        }
+
+        ++p;
+
+        for (i = 0; i != ncols; ++i)
+        {
+            while (isspace((unsigned char)*p))
+            {
+                ++p;
+            }
+
+            v = strtoul(p, &ep, 10);
+
+            if (ep == p)
+            {
+                break;
+            }
+
+            irqs[col[i]] += v;
+            p = ep;
+        }
+    }
+
+    return max;
+}
+
+
+/* ==========================================================================
+    picks up to 'want' cpus with the lowest 'irqs', out of 'ncpus' cpus
+    that have non zero 'allowed' flag, into 'cpus'
+
+    returns:
+            number of picked cpus
+   ========================================================================== */
+
+
+int quiet_pick
+(
+    const unsigned long  *irqs,     /* interrupts of each cpu */
+    const int            *allowed,  /* cpus that can be picked */
+    int                   ncpus,    /* number of cpus */
+    int                   want,     /* number of cpus to pick */
+    int                  *cpus      /* picked cpus are stored here */
+)
+{
+    int                   n;        /* number of picked cpus */
+    int                   best;     /* best cpu so far */
+    int                   i;        /* iterator for loop */
+    int                   j;        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (n = 0; n != want; ++n)
+    {
+        best = -1;
+
+        for (i = 0; i != ncpus; ++i)
+        {
+            if (!allowed[i])
+            {
+                continue;
+            }
+
+            for (j = 0; j != n && cpus[j] != i; ++j);
+
+            if (j == n && (best == -1 || irqs[i] < irqs[best]))
+            {
+                best = i;
+            }
+        }
+
+        if (best == -1)
+        {
+            break;
+        }
+
+        cpus[n] = best;
+    }
+
+    return n;
+}
+
+
+/* ==========================================================================
+    prepares system for low noise run, as far as we are  permitted  to:
+    pins process to cpus with fewest interrupts, locks memory,  disables
+    transparent huge pages and switches to SCHED_FIFO.  Result  of  each
+    step is reported, failures are not fatal.
+   ========================================================================== */
+
+
+void quiet_setup(void)
+{
+    quiet_affinity();
+    quiet_mlock();
+    quiet_thp();
+
+    /*
+     * last, so failing steps above are not run with realtime priority
+     */
+
+    quiet_fifo();
+}
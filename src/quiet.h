@@ -0,0 +1,33 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef QUIET_H
+#define QUIET_H 1
+
+#include <stdio.h>
+
+/*
+ * max number of cpus that interrupts are counted for, and max length of
+ * line in /proc/interrupts, which has column for each cpu
+ */
+
+#define QUIET_CPUS_MAX 1024
+#define QUIET_LINE_MAX (16 * QUIET_CPUS_MAX + 256)
+
+/*
+ * SCHED_FIFO priority of benchmark, lowest one is enough to not be
+ * preempted by normal tasks, while kernel threads with rt priority, like
+ * threaded irq handlers, still run
+ */
+
+#define QUIET_FIFO_PRIO 1
+
+int quiet_irqs(FILE *f, unsigned long *irqs, int ncpus);
+int quiet_pick(const unsigned long *irqs, const int *allowed, int ncpus,
+    int want, int *cpus);
+void quiet_setup(void);
+
+#endif
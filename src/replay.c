@@ -0,0 +1,520 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "replay.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * replayed methods, each one has stats of rate and of calls per second
+ */
+
+#define REPLAY_METHODS 2
+
+
+/* ==== Private declarations ================================================ */
+
+
+struct replay_call
+{
+    size_t size;  /* bytes to copy */
+    size_t off;   /* offset from cache line, that gives alignment */
+};
+
+
+/* ==== Private variables =================================================== */
+
+
+/*
+ * indexed by enum method
+ */
+
+static const char *method_names[REPLAY_METHODS] =
+{
+    "memcpy",
+    "bbb"
+};
+
+static char replay_line[REPLAY_LINE_MAX];
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    builds sequence of calls from 'buckets', each bucket gets  number  of
+    calls proportional to its count, but at least one when count is  not
+    0, and whole sequence is shuffled.  Calls of bucket are aligned to its
+    alignment, but not to twice of it, up to cache line.
+
+    returns:
+            number of calls in 'seq', 0 when histogram has no calls
+   ========================================================================== */
+
+
+static size_t replay_sequence
+(
+    const struct replay_bucket  *buckets,  /* histogram to replay */
+    size_t                       nb,       /* number of buckets */
+    struct replay_call          *seq       /* sequence to fill */
+)
+{
+    struct replay_call           tmp;      /* temporary for swap */
+    unsigned long                seed;     /* state of random generator */
+    double                       total;    /* calls in histogram */
+    double                       scale;    /* histogram to sequence ratio */
+    size_t                       k;        /* calls of current bucket */
+    size_t                       n;        /* calls in sequence */
+    size_t                       b;        /* current bucket */
+    size_t                       i;        /* iterator for loop */
+    size_t                       j;        /* element to swap with */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (b = 0, total = 0; b != nb; ++b)
+    {
+        total += buckets[b].count;
+    }
+
+    /*
+     * leave room for buckets that are rounded up to single call
+     */
+
+    scale = total > REPLAY_SEQ_MAX - nb ? (REPLAY_SEQ_MAX - nb) / total : 1;
+
+    for (b = 0, n = 0; b != nb; ++b)
+    {
+        k = (size_t)(buckets[b].count * scale + 0.5);
+        k = k == 0 && buckets[b].count ? 1 : k;
+
+        for (i = 0; i != k; ++i, ++n)
+        {
+            seq[n].size = buckets[b].size;
+            seq[n].off = buckets[b].align % 64;
+        }
+    }
+
+    seed = (unsigned long)time(NULL) | 1;
+
+    for (i = n; i > 1; --i)
+    {
+        j = rnd(&seed) % i;
+        tmp = seq[i - 1];
+        seq[i - 1] = seq[j];
+        seq[j] = tmp;
+    }
+
+    return n;
+}
+
+
+/* ==========================================================================
+    replays 'seq' 'passes' times with 'method'.  Copies walk through 'src'
+    and 'dst' buffers of 'span' bytes, each one starts on next free cache
+    line, and wraps back to the beginning when end of buffer is reached.
+
+    returns:
+            time all copies took
+   ========================================================================== */
+
+
+static double replay_run
+(
+    enum method                method,  /* copying method */
+    const struct replay_call  *seq,     /* calls to replay */
+    size_t                     n,       /* number of calls in 'seq' */
+    unsigned long              passes,  /* times to replay 'seq' */
+    const unsigned char       *src,     /* source, cache line aligned */
+    unsigned char             *dst,     /* destination, line aligned */
+    size_t                     span,    /* usable bytes of buffers */
+    size_t                     max      /* biggest call in 'seq' */
+)
+{
+    struct ts                  start;   /* timer indicating start */
+    struct ts                  finish;  /* timer indicating finish */
+    struct ts                  taken;   /* time of all copies */
+    unsigned long              p;       /* current pass */
+    size_t                     pos;     /* position in buffers */
+    size_t                     i;       /* current call */
+    size_t                     k;       /* iterator for byte by byte copy */
+    unsigned char             *d;       /* destination of call */
+    const unsigned char       *s;       /* source of call */
+    double                     sec;     /* time in seconds */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    pos = 0;
+    ts(&start);
+
+    for (p = 0; p != passes; ++p)
+    {
+        for (i = 0; i != n; ++i)
+        {
+            d = dst + pos + seq[i].off;
+            s = src + pos + seq[i].off;
+
+            if (method == METHOD_BBB)
+            {
+                for (k = 0; k != seq[i].size; ++k)
+                {
+                    d[k] = s[k];
+                }
+            }
+            else
+            {
+                memcpy(d, s, seq[i].size);
+            }
+
+            pos += (seq[i].size + 63) & ~(size_t)63;
+            pos = pos + max + 64 > span ? 0 : pos;
+        }
+    }
+
+    ts(&finish);
+    ts_reset(&taken);
+    ts_add_diff(&taken, &start, &finish);
+    sec = ts2sec(&taken);
+    return sec > 0 ? sec : 1e-9;
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    parses histogram from 'f'.  Every line holds size, alignment and count
+    of calls, separated by blanks or commas.  Everything after # is  a
+    comment, and blank lines are skipped.  Size must not be 0 and alignment
+    must be power of 2.  On success 'buckets' is allocated and must be
+    freed by caller.
+
+    returns:
+             0      histogram parsed, 'n' buckets are in 'buckets'
+            -1      couldn't allocate memory
+            -2      syntax error in file
+   ========================================================================== */
+
+
+int replay_parse
+(
+    FILE                   *f,        /* histogram file */
+    struct replay_bucket  **buckets,  /* parsed buckets */
+    size_t                 *n         /* number of parsed buckets */
+)
+{
+    struct replay_bucket   *b;        /* reallocated buckets */
+    unsigned long           v[3];     /* size, alignment and count */
+    unsigned long           lineno;   /* number of current line */
+    size_t                  size;     /* buckets that fit in memory */
+    char                   *p;        /* current position in line */
+    char                   *ep;       /* end of parsed number */
+    int                     i;        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    *buckets = NULL;
+    *n = 0;
+    size = 0;
+    lineno = 0;
+
+    while (fgets(replay_line, sizeof(replay_line), f))
+    {
+        ++lineno;
+
+        if ((p = strchr(replay_line, '#')))
+        {
+            *p = '\0';
+        }
+
+        for (p = replay_line; (p = strchr(p, ',')); ++p)
+        {
+            *p = ' ';
+        }
+
+        p = replay_line + strspn(replay_line, " \t\r\n");
+
+        if (*p == '\0')
+        {
+            continue;
+        }
+
+        for (i = 0; i != 3; ++i)
+        {
+            p += strspn(p, " \t");
+
+            if (!isdigit((unsigned char)*p))
+            {
+                break;
+            }
+
+            v[i] = strtoul(p, &ep, 10);
+            p = ep;
+        }
+
+        p += strspn(p, " \t\r\n");
+
+        if (i != 3 || *p || v[0] == 0 || v[1] == 0 || (v[1] & (v[1] - 1)))
+        {
+            fprintf(stderr, "Couldn't parse line %lu of histogram\n", lineno);
+            free(*buckets);
+            *buckets = NULL;
+            *n = 0;
+            return -2;
+        }
+
+        if (*n == size)
+        {
+            size = size ? size * 2 : 16;
+
+            if ((b = realloc(*buckets, size * sizeof(*b))) == NULL)
+            {
+                free(*buckets);
+                *buckets = NULL;
+                *n = 0;
+                return -1;
+            }
+
+            *buckets = b;
+        }
+
+        (*buckets)[*n].size = v[0];
+        (*buckets)[*n].align = v[1];
+        (*buckets)[*n].count = v[2];
+        ++*n;
+    }
+
+    return 0;
+}
+
+
+/* ==========================================================================
+    replays mix of copies from histogram in opts.replay with every  method.
+    Sequence of calls is built from histogram once, and is replayed until
+    opts.report_intvl bytes are copied in interval.  Copies walk through
+    buffers of opts.block_size, so -b sets working set of replay.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't read histogram or allocate memory
+   ========================================================================== */
+
+
+int replay_bench(void)
+{
+    struct stats           s[2 * REPLAY_METHODS]; /* rate and calls/s */
+    struct replay_bucket  *buckets;   /* histogram to replay */
+    struct replay_call    *seq;       /* calls to replay */
+    unsigned char         *src;       /* source buffer */
+    unsigned char         *dst;       /* destination buffer */
+    unsigned long          passes;    /* replays of sequence in interval */
+    unsigned long          i;         /* iterator for loop */
+    size_t                 nb;        /* number of buckets */
+    size_t                 n;         /* calls in sequence */
+    size_t                 max;       /* biggest call */
+    size_t                 span;      /* usable bytes of buffers */
+    double                 bytes;     /* bytes copied by sequence */
+    double                 sec;       /* time of replay */
+    double                 rate;      /* copied MB/s */
+    double                 mcps;      /* million calls per second */
+    char                   name[32];  /* name of configuration */
+    FILE                  *f;         /* histogram file */
+    int                    m;         /* current method */
+    int                    rc;        /* return code */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (opts.replay == NULL)
+    {
+        fprintf(stderr, "Replay test needs histogram file, see -u\n");
+        return -1;
+    }
+
+    if ((f = fopen(opts.replay, "r")) == NULL)
+    {
+        fprintf(stderr, "Couldn't open histogram %s\n", opts.replay);
+        return -1;
+    }
+
+    rc = replay_parse(f, &buckets, &nb);
+    fclose(f);
+
+    if (rc == -1)
+    {
+        fprintf(stderr, "Couldn't allocate memory for histogram\n");
+        return -1;
+    }
+
+    if (rc != 0)
+    {
+        return -1;
+    }
+
+    rc = -1;
+    seq = NULL;
+    src = NULL;
+    dst = NULL;
+
+    for (m = 0; m != 2 * REPLAY_METHODS; ++m)
+    {
+        stats_init(&s[m]);
+    }
+
+    /*
+     * every bucket takes at least one call of sequence, and there must be
+     * room left for the rest to be proportional
+     */
+
+    if (nb > REPLAY_SEQ_MAX / 2)
+    {
+        fprintf(stderr, "Couldn't replay more than %d buckets\n",
+                REPLAY_SEQ_MAX / 2);
+        goto error;
+    }
+
+    if ((seq = malloc(REPLAY_SEQ_MAX * sizeof(*seq))) == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for sequence\n");
+        goto error;
+    }
+
+    if ((n = replay_sequence(buckets, nb, seq)) == 0)
+    {
+        fprintf(stderr, "Couldn't find any calls in histogram %s\n",
+                opts.replay);
+        goto error;
+    }
+
+    for (i = 0, max = 0, bytes = 0; i != n; ++i)
+    {
+        max = seq[i].size > max ? seq[i].size : max;
+        bytes += seq[i].size;
+    }
+
+    /*
+     * buffers must fit at least the biggest call, past its offset
+     */
+
+    span = opts.block_size > max + 64 ? opts.block_size : max + 64;
+    src = malloc(span + 64);
+    dst = malloc(span + 64);
+
+    if (src == NULL || dst == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for buffers\n");
+        goto error;
+    }
+
+    memset(src, 0x5a, span + 64);
+    memset(dst, 0xa5, span + 64);
+    passes = (unsigned long)(opts.report_intvl / bytes);
+    passes = passes ? passes : 1;
+
+    if (out_text())
+    {
+        printf("histogram %s: %lu buckets, %lu calls in sequence, "
+               "mean size %.1f bytes, buffers %lu bytes, iterations %lu\n",
+               opts.replay,
+               (unsigned long)nb,
+               (unsigned long)n,
+               bytes / n,
+               (unsigned long)span,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(s, 2 * REPLAY_METHODS, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (m = 0; m != REPLAY_METHODS; ++m)
+        {
+            /*
+             * buffers are aligned to cache line, so 'off' of call alone
+             * gives its alignment
+             */
+
+            sec = replay_run((enum method)m, seq, n, passes,
+                             src + 64 - (size_t)src % 64,
+                             dst + 64 - (size_t)dst % 64,
+                             span, max);
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            rate = bytes * passes / sec / (1024 * 1024);
+            mcps = (double)n * passes / sec / 1e6;
+
+            if (!out_text())
+            {
+                out_record("interval");
+                out_ulong("interval", i - opts.warmup + 1);
+                out_str("name", method_names[m]);
+                out_double("rate_mbps", rate);
+                out_double("mcalls_per_sec", mcps);
+                out_record_end();
+            }
+            else
+            {
+                printf("%-6s rate %8lu MB/s, %10.2f Mcalls/s\n",
+                       method_names[m],
+                       (unsigned long)rate,
+                       mcps);
+            }
+
+            if (stats_add(&s[2 * m], rate) != 0 ||
+                stats_add(&s[2 * m + 1], mcps) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of replay\n");
+    }
+
+    for (m = 0; m != REPLAY_METHODS; ++m)
+    {
+        stats_compute(&s[2 * m], opts.outlier_mad);
+        stats_print(&s[2 * m], method_names[m], "MB/s");
+        sprintf(name, "%s calls", method_names[m]);
+        stats_compute(&s[2 * m + 1], opts.outlier_mad);
+        stats_print(&s[2 * m + 1], name, "Mcalls/s");
+    }
+
+    rc = 0;
+
+error:
+    for (m = 0; m != 2 * REPLAY_METHODS; ++m)
+    {
+        stats_destroy(&s[m]);
+    }
+
+    free(dst);
+    free(src);
+    free(seq);
+    free(buckets);
+    return rc;
+}
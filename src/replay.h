@@ -0,0 +1,31 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef REPLAY_H
+#define REPLAY_H 1
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * max number of calls in replayed sequence, counts of histogram are
+ * scaled down to fit in it, and max length of line in histogram file
+ */
+
+#define REPLAY_SEQ_MAX (1024 * 1024)
+#define REPLAY_LINE_MAX 256
+
+struct replay_bucket
+{
+    size_t size;          /* bytes copied by call */
+    size_t align;         /* alignment of source and destination */
+    unsigned long count;  /* number of calls of this size and alignment */
+};
+
+int replay_parse(FILE *f, struct replay_bucket **buckets, size_t *n);
+int replay_bench(void);
+
+#endif
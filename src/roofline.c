@@ -0,0 +1,537 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "roofline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * number of independent chains in kernel, enough to cover latency of
+ * floating point units, so peak is limited by their throughput
+ */
+
+#define ROOFLINE_CHAINS 16
+
+
+/* ==== Private declarations ================================================ */
+
+
+/*
+ * configurations measured in each interval, first three are ceilings,
+ * then come kernel points with 0, 1, 2, 4... rounds on opts.block_size
+ */
+
+enum roofline_conf
+{
+    CONF_PEAK,
+    CONF_CACHE,
+    CONF_MEMORY,
+    CONF_POINTS
+};
+
+
+/* ==== Private variables =================================================== */
+
+
+/*
+ * result of computation is stored here, so compiler can't throw it away
+ */
+
+static volatile double roofline_sink;
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    kernel of the roofline, every element of 'p' goes through 'rounds' of
+    x = x * a + b, and is summed up.  Elements are processed in
+    ROOFLINE_CHAINS independent chains.  'a' and 'b' keep values close
+    to 1, so they never turn into denormals or infinities.
+
+    returns:
+            sum of all computed elements
+   ========================================================================== */
+
+
+static double roofline_kernel
+(
+    const double   *p,                     /* elements to compute on */
+    size_t          n,                     /* number of elements in 'p' */
+    unsigned long   rounds                 /* rounds per element */
+)
+{
+    double          x[ROOFLINE_CHAINS];    /* elements being computed */
+    double          acc[ROOFLINE_CHAINS];  /* sum of each chain */
+    double          sum;                   /* sum of all chains */
+    unsigned long   r;                     /* current round */
+    size_t          i;                     /* iterator for loop */
+    int             c;                     /* current chain */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = 0; c != ROOFLINE_CHAINS; ++c)
+    {
+        acc[c] = 0;
+    }
+
+    for (i = 0; i + ROOFLINE_CHAINS <= n; i += ROOFLINE_CHAINS)
+    {
+        for (c = 0; c != ROOFLINE_CHAINS; ++c)
+        {
+            x[c] = p[i + c];
+        }
+
+        for (r = 0; r != rounds; ++r)
+        {
+            for (c = 0; c != ROOFLINE_CHAINS; ++c)
+            {
+                x[c] = x[c] * 0.999 + 0.001;
+            }
+        }
+
+        for (c = 0; c != ROOFLINE_CHAINS; ++c)
+        {
+            acc[c] += x[c];
+        }
+    }
+
+    for (c = 0, sum = 0; c != ROOFLINE_CHAINS; ++c)
+    {
+        sum += acc[c];
+    }
+
+    return sum;
+}
+
+
+/* ==========================================================================
+    runs kernel with 'rounds' on 'n' elements of 'p' over and over, until
+    it has read opts.report_intvl / (rounds + 1) bytes, so every point
+    takes about the same time.
+
+    returns:
+            time it took in seconds, 'bytes' and 'flops' are set to amount
+            of read bytes and operations done
+   ========================================================================== */
+
+
+static double roofline_run
+(
+    const double   *p,       /* elements to compute on */
+    size_t          n,       /* number of elements in 'p' */
+    unsigned long   rounds,  /* rounds per element */
+    double         *bytes,   /* read bytes will be stored here */
+    double         *flops    /* done operations will be stored here */
+)
+{
+    struct ts       start;   /* timer indicating start */
+    struct ts       finish;  /* timer indicating finish */
+    struct ts       taken;   /* time taken by all passes */
+    double          target;  /* bytes to read */
+    double          sec;     /* time taken in seconds */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    target = opts.report_intvl / (rounds + 1);
+    *bytes = 0;
+
+    ts(&start);
+
+    do
+    {
+        roofline_sink = roofline_kernel(p, n, rounds);
+        *bytes += n * sizeof(*p);
+    }
+    while (*bytes < target);
+
+    ts(&finish);
+    ts_reset(&taken);
+    ts_add_diff(&taken, &start, &finish);
+
+    *flops = *bytes / sizeof(*p) * roofline_flops(rounds);
+    sec = ts2sec(&taken);
+    return sec > 0 ? sec : 1e-9;
+}
+
+
+/* ==========================================================================
+    returns name of configuration 'c' in 'name', which must fit 32 bytes
+   ========================================================================== */
+
+
+static const char *roofline_name
+(
+    size_t          c,       /* configuration */
+    unsigned long   rounds,  /* rounds of configuration */
+    char           *name     /* buffer for name */
+)
+{
+    switch (c)
+    {
+    case CONF_PEAK:
+        return "peak";
+
+    case CONF_CACHE:
+        return "cache";
+
+    case CONF_MEMORY:
+        return "memory";
+
+    default:
+        sprintf(name, "%.3f flop/B", roofline_flops(rounds) / sizeof(double));
+        return name;
+    }
+}
+
+
+/* ==========================================================================
+    prints roofline table, from means of all intervals.  Every point is
+    compared against what memory and cache roofs allow at its intensity,
+    that is min(peak, intensity * bandwidth).  Point is memory bound, when
+    memory roof is below peak at its intensity.  Peak is the best  of  the
+    peak kernel and all points, as compute bound points on block run  the
+    very same code and may as well do better.
+   ========================================================================== */
+
+
+static void roofline_table
+(
+    const struct stats   *s,       /* results of every configuration */
+    const unsigned long  *rounds,  /* rounds of every configuration */
+    size_t                nconf    /* number of configurations */
+)
+{
+    double                peak;    /* peak GFLOP/s */
+    double                mem;     /* memory bandwidth in GB/s */
+    double                cache;   /* cache bandwidth in GB/s */
+    double                in;      /* intensity of point in flop/byte */
+    double                mroof;   /* memory roof at point */
+    double                croof;   /* cache roof at point */
+    size_t                c;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = CONF_PEAK, peak = 0; c != nconf; ++c)
+    {
+        if (c != CONF_CACHE && c != CONF_MEMORY && s[c].mean > peak)
+        {
+            peak = s[c].mean;
+        }
+    }
+
+    mem = s[CONF_MEMORY].mean * 1024 * 1024 / 1e9;
+    cache = s[CONF_CACHE].mean * 1024 * 1024 / 1e9;
+
+    if (!out_text())
+    {
+        out_record("ceiling");
+        out_double("peak_gflops", peak);
+        out_double("cache_mbps", s[CONF_CACHE].mean);
+        out_double("memory_mbps", s[CONF_MEMORY].mean);
+        out_double("ridge", mem > 0 ? peak / mem : 0);
+        out_record_end();
+    }
+    else
+    {
+        printf("roofline\n");
+        printf("peak %.2f GFLOP/s, cache %lu MB/s, memory %lu MB/s, "
+               "ridge at %.2f flop/B\n",
+               peak,
+               (unsigned long)s[CONF_CACHE].mean,
+               (unsigned long)s[CONF_MEMORY].mean,
+               mem > 0 ? peak / mem : 0);
+        printf("%10s %10s %10s %10s %8s %8s\n",
+               "flop/B", "GFLOP/s", "mem roof", "cache roof", "of roof",
+               "bound");
+    }
+
+    for (c = CONF_POINTS; c != nconf; ++c)
+    {
+        in = roofline_flops(rounds[c]) / sizeof(double);
+        mroof = in * mem < peak ? in * mem : peak;
+        croof = in * cache < peak ? in * cache : peak;
+
+        if (!out_text())
+        {
+            out_record("roofline");
+            out_double("intensity", in);
+            out_double("gflops", s[c].mean);
+            out_double("memory_roof", mroof);
+            out_double("cache_roof", croof);
+            out_str("bound", in * mem < peak ? "memory" : "compute");
+            out_record_end();
+            continue;
+        }
+
+        printf("%10.3f %10.2f %10.2f %10.2f %7.1f%% %8s\n",
+               in,
+               s[c].mean,
+               mroof,
+               croof,
+               mroof > 0 ? s[c].mean / mroof * 100 : 0,
+               in * mem < peak ? "memory" : "compute");
+    }
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    returns number of floating point operations kernel does per element,
+    2 for each multiply and add round, and 1 to sum element up
+   ========================================================================== */
+
+
+double roofline_flops
+(
+    unsigned long  rounds  /* multiply and add rounds per element */
+)
+{
+    return 2.0 * rounds + 1;
+}
+
+
+/* ==========================================================================
+    fills 'rounds' with rounds of kernel points, 0 and then powers of 2 up
+    to ROOFLINE_ROUNDS_MAX.  'rounds' may be NULL to only count them.
+
+    returns:
+            number of kernel points
+   ========================================================================== */
+
+
+size_t roofline_sweep
+(
+    unsigned long  *rounds  /* rounds of points will be stored here */
+)
+{
+    unsigned long   r;      /* rounds of current point */
+    size_t          n;      /* number of points */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (n = 0, r = 0; r <= ROOFLINE_ROUNDS_MAX; r = r ? r * 2 : 1, ++n)
+    {
+        if (rounds)
+        {
+            rounds[n] = r;
+        }
+    }
+
+    return n;
+}
+
+
+/* ==========================================================================
+    measures roofline of single core.  Ceilings are peak floating point
+    throughput of kernel with ROOFLINE_ROUNDS_MAX rounds on L1  resident
+    buffer, and read bandwidth of cache (buffer of half opts.cache_size)
+    and of memory (opts.block_size buffer).  Then kernel of 0, 1, 2, 4...
+    rounds per element is run on opts.block_size buffer, and each  point
+    is placed against the roofs.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory
+   ========================================================================== */
+
+
+int roofline_bench(void)
+{
+    struct stats         *s;        /* results of every configuration */
+    unsigned long        *rounds;   /* rounds of every configuration */
+    double               *l1;       /* buffer for peak */
+    double               *llc;      /* buffer for cache bandwidth */
+    double               *mem;      /* buffer for memory bandwidth */
+    const double         *p;        /* buffer of configuration */
+    size_t                nl1;      /* elements in 'l1' */
+    size_t                nllc;     /* elements in 'llc' */
+    size_t                nmem;     /* elements in 'mem' */
+    size_t                n;        /* elements in 'p' */
+    size_t                nconf;    /* number of configurations */
+    size_t                c;        /* current configuration */
+    unsigned long         i;        /* iterator for loop */
+    double                sec;      /* time of configuration */
+    double                bytes;    /* bytes read by configuration */
+    double                flops;    /* operations done by configuration */
+    double                v;        /* result of configuration */
+    char                  name[32]; /* name of configuration */
+    int                   rc;       /* return code */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    l1 = NULL;
+    llc = NULL;
+    mem = NULL;
+
+    nconf = CONF_POINTS + roofline_sweep(NULL);
+
+    s = malloc(nconf * sizeof(*s));
+    rounds = malloc(nconf * sizeof(*rounds));
+
+    if (s == NULL || rounds == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for samples\n");
+        free(rounds);
+        free(s);
+        return -1;
+    }
+
+    rounds[CONF_PEAK] = ROOFLINE_ROUNDS_MAX;
+    rounds[CONF_CACHE] = 0;
+    rounds[CONF_MEMORY] = 0;
+    roofline_sweep(rounds + CONF_POINTS);
+
+    for (c = 0; c != nconf; ++c)
+    {
+        stats_init(&s[c]);
+    }
+
+    /*
+     * whole chains only, so every element that is counted is read
+     */
+
+    nl1 = ROOFLINE_L1 / sizeof(double);
+    nllc = opts.cache_size / 2 / sizeof(double);
+    nllc = nllc > nl1 ? nllc : nl1;
+    nllc -= nllc % ROOFLINE_CHAINS;
+    nmem = opts.block_size / sizeof(double);
+    nmem -= nmem % ROOFLINE_CHAINS;
+
+    if (nmem == 0)
+    {
+        fprintf(stderr, "Block size must be at least %lu bytes\n",
+                (unsigned long)(ROOFLINE_CHAINS * sizeof(double)));
+        goto error;
+    }
+
+    l1 = malloc(nl1 * sizeof(double));
+    llc = malloc(nllc * sizeof(double));
+    mem = malloc(nmem * sizeof(double));
+
+    if (l1 == NULL || llc == NULL || mem == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for buffers\n");
+        goto error;
+    }
+
+    for (n = 0; n != nl1; ++n)
+    {
+        l1[n] = 1.0;
+    }
+
+    for (n = 0; n != nllc; ++n)
+    {
+        llc[n] = 1.0;
+    }
+
+    for (n = 0; n != nmem; ++n)
+    {
+        mem[n] = 1.0;
+    }
+
+    if (out_text())
+    {
+        printf("cache buffer %lu bytes, memory buffer %lu bytes, "
+               "iterations %lu\n",
+               (unsigned long)(nllc * sizeof(double)),
+               (unsigned long)(nmem * sizeof(double)),
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(s, nconf, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (c = 0; c != nconf; ++c)
+        {
+            p = c == CONF_PEAK ? l1 : c == CONF_CACHE ? llc : mem;
+            n = c == CONF_PEAK ? nl1 : c == CONF_CACHE ? nllc : nmem;
+            sec = roofline_run(p, n, rounds[c], &bytes, &flops);
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            /*
+             * ceilings of bandwidth are in MB/s, everything else  is
+             * in GFLOP/s
+             */
+
+            v = c == CONF_CACHE || c == CONF_MEMORY ?
+                bytes / sec / (1024 * 1024) : flops / sec / 1e9;
+
+            if (!out_text())
+            {
+                out_record("interval");
+                out_ulong("interval", i - opts.warmup + 1);
+                out_str("name", roofline_name(c, rounds[c], name));
+                out_ulong("rounds", rounds[c]);
+                out_double("gflops", flops / sec / 1e9);
+                out_double("rate_mbps", bytes / sec / (1024 * 1024));
+                out_record_end();
+            }
+            else
+            {
+                printf("%-14s %10.2f GFLOP/s, %10lu MB/s\n",
+                       roofline_name(c, rounds[c], name),
+                       flops / sec / 1e9,
+                       (unsigned long)(bytes / sec / (1024 * 1024)));
+            }
+
+            if (stats_add(&s[c], v) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of ceilings and kernel points\n");
+    }
+
+    for (c = 0; c != nconf; ++c)
+    {
+        stats_compute(&s[c], opts.outlier_mad);
+        stats_print(&s[c], roofline_name(c, rounds[c], name),
+                    c == CONF_CACHE || c == CONF_MEMORY ?
+                    "MB/s" : "GFLOP/s");
+    }
+
+    roofline_table(s, rounds, nconf);
+    rc = 0;
+
+error:
+    for (c = 0; c != nconf; ++c)
+    {
+        stats_destroy(&s[c]);
+    }
+
+    free(mem);
+    free(llc);
+    free(l1);
+    free(rounds);
+    free(s);
+    return rc;
+}
@@ -0,0 +1,25 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef ROOFLINE_H
+#define ROOFLINE_H 1
+
+#include <stddef.h>
+
+/*
+ * kernel is swept from 0 multiply and add rounds per element, up to
+ * ROOFLINE_ROUNDS_MAX, doubling each step.  Peak is measured with  the
+ * max rounds on ROOFLINE_L1 buffer, that surely fits in L1 cache.
+ */
+
+#define ROOFLINE_ROUNDS_MAX 256
+#define ROOFLINE_L1 (4 * 1024)
+
+double roofline_flops(unsigned long rounds);
+size_t roofline_sweep(unsigned long *rounds);
+int roofline_bench(void);
+
+#endif
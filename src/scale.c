@@ -0,0 +1,566 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "scale.h"
+
+#if HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+#if HAVE_SYSCONF
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+#if HAVE_PTHREAD_H
+
+
+/* ==== Private declarations ================================================ */
+
+
+struct scale_thread
+{
+    unsigned char    *dst;      /* destination of copy */
+    unsigned char    *src;      /* source of copy */
+    enum method       method;   /* how to copy */
+    struct barrier   *barrier;  /* starts all threads at once */
+    int               cancel;   /* not all threads started */
+    pthread_t         tid;      /* id of the thread */
+};
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *method_names[] =
+{
+    "memcpy",
+    "bbb"
+};
+
+#define SCALE_METHODS (sizeof(method_names) / sizeof(*method_names))
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    copies opts.report_intvl bytes in opts.block_size blocks, after  all
+    threads are ready
+   ========================================================================== */
+
+
+static void *scale_worker
+(
+    void                 *arg    /* struct scale_thread of this thread */
+)
+{
+    struct scale_thread  *t;     /* this thread */
+    size_t                loops; /* number of blocks to copy */
+    size_t                j;     /* iterator for loop */
+    size_t                k;     /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    t = arg;
+    loops = opts.report_intvl / opts.block_size;
+    loops = loops ? loops : 1;
+    barrier_wait(t->barrier);
+
+    if (t->cancel)
+    {
+        return NULL;
+    }
+
+    for (j = 0; j != loops; ++j)
+    {
+        if (t->method == METHOD_BBB)
+        {
+            for (k = 0; k != opts.block_size; ++k)
+            {
+                t->dst[k] = t->src[k];
+            }
+        }
+        else
+        {
+            memcpy(t->dst, t->src, opts.block_size);
+        }
+    }
+
+    return NULL;
+}
+
+
+/* ==========================================================================
+    runs 'n' threads copying with 'method' at the same time, and  stores
+    their aggregate bandwidth in MB/s in 'bw'
+
+    returns:
+             0      bandwidth measured
+            -1      couldn't start threads
+   ========================================================================== */
+
+
+static int scale_run
+(
+    struct scale_thread  *threads,  /* per thread state */
+    unsigned long         n,        /* number of threads to run */
+    enum method           method,   /* how to copy */
+    double               *bw        /* aggregate bandwidth in MB/s */
+)
+{
+    struct barrier        barrier;  /* starts threads together */
+    struct ts             start;    /* timer indicating start of copies */
+    struct ts             finish;   /* timer indicating end of copies */
+    struct ts             taken;    /* time until last thread finished */
+    size_t                loops;    /* number of blocks each thread copies */
+    double                sec;      /* time taken in seconds */
+    unsigned long         i;        /* iterator for loop */
+    unsigned long         k;        /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (barrier_init(&barrier, n + 1) != 0)
+    {
+        fprintf(stderr, "Couldn't initialize thread barrier\n");
+        return -1;
+    }
+
+    for (i = 0; i != n; ++i)
+    {
+        threads[i].method = method;
+        threads[i].barrier = &barrier;
+        threads[i].cancel = 0;
+
+        if (pthread_create(&threads[i].tid, NULL, scale_worker,
+                           &threads[i]) != 0)
+        {
+            /*
+             * threads that were already started wait for the rest on
+             * barrier, release them with cancel flag set, so they  quit
+             * without copying
+             */
+
+            fprintf(stderr, "Couldn't create thread\n");
+
+            for (k = 0; k != i; ++k)
+            {
+                threads[k].cancel = 1;
+            }
+
+            barrier_resize(&barrier, i);
+
+            for (k = 0; k != i; ++k)
+            {
+                pthread_join(threads[k].tid, NULL);
+            }
+
+            barrier_destroy(&barrier);
+            return -1;
+        }
+    }
+
+    barrier_wait(&barrier);
+    ts(&start);
+
+    for (i = 0; i != n; ++i)
+    {
+        pthread_join(threads[i].tid, NULL);
+    }
+
+    ts(&finish);
+    ts_reset(&taken);
+    ts_add_diff(&taken, &start, &finish);
+    barrier_destroy(&barrier);
+
+    loops = opts.report_intvl / opts.block_size;
+    loops = loops ? loops : 1;
+    sec = ts2sec(&taken);
+    sec = sec > 0 ? sec : 1e-9;
+
+    *bw = (double)n * loops * opts.block_size / sec / (1024 * 1024);
+    return 0;
+}
+
+
+/* ==========================================================================
+    prints aggregate bandwidth 'bw' of 'n' threads with 'method'
+   ========================================================================== */
+
+
+static void scale_report
+(
+    unsigned long  intvl,   /* interval number, counted from 1 */
+    size_t         method,  /* method that was used */
+    unsigned long  n,       /* number of threads */
+    double         bw       /* aggregate bandwidth in MB/s */
+)
+{
+    if (!out_text())
+    {
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("name", method_names[method]);
+        out_ulong("nthreads", n);
+        out_double("rate_mbps", bw);
+        out_double("rate_per_thread_mbps", bw / n);
+        out_record_end();
+        return;
+    }
+
+    printf("%-6s threads %4lu, rate %8lu MB/s, per thread %8lu MB/s\n",
+           method_names[method],
+           n,
+           (unsigned long)bw,
+           (unsigned long)(bw / n));
+}
+
+
+/* ==========================================================================
+    prints scaling curve of 'method' from means of all intervals.   Each
+    point shows aggregate and per thread bandwidth, and parallel efficiency
+    that is per thread bandwidth relative to single thread, and  where  it
+    saturates.
+   ========================================================================== */
+
+
+static void scale_curve
+(
+    size_t                method,  /* method to print curve of */
+    const struct stats   *s,       /* bandwidth of each thread count */
+    const unsigned long  *counts,  /* thread counts */
+    size_t                np       /* number of thread counts */
+)
+{
+    double                eff;     /* parallel efficiency */
+    size_t                knee;    /* saturation point */
+    size_t                p;       /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    knee = scale_knee(s, np);
+
+    if (out_text())
+    {
+        printf("%s scaling\n", method_names[method]);
+        printf("%7s %14s %14s %10s\n",
+               "threads", "rate MB/s", "thread MB/s", "efficiency");
+    }
+
+    for (p = 0; p != np; ++p)
+    {
+        eff = s[0].mean > 0 ? s[p].mean / counts[p] / s[0].mean : 0;
+
+        if (!out_text())
+        {
+            out_record("scaling");
+            out_str("name", method_names[method]);
+            out_ulong("nthreads", counts[p]);
+            out_double("rate_mbps", s[p].mean);
+            out_double("rate_per_thread_mbps", s[p].mean / counts[p]);
+            out_double("efficiency", eff);
+            out_ulong("saturated", p == knee && knee + 1 < np);
+            out_record_end();
+            continue;
+        }
+
+        printf("%7lu %14lu %14lu %9.1f%%%s\n",
+               counts[p],
+               (unsigned long)s[p].mean,
+               (unsigned long)(s[p].mean / counts[p]),
+               eff * 100,
+               p == knee && knee + 1 < np ? "  <- saturation" : "");
+    }
+
+    if (out_text() && knee + 1 == np)
+    {
+        printf("saturation not reached with %lu threads\n", counts[np - 1]);
+    }
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    returns max number of threads to sweep to, that is opts.threads when -n
+    was given, or number of cpus this process is allowed to run on
+   ========================================================================== */
+
+
+unsigned long scale_max_threads(void)
+{
+#if HAVE_SCHED_SETAFFINITY && defined(CPU_COUNT)
+    cpu_set_t  set;  /* cpus we are allowed to run on */
+#elif HAVE_SYSCONF && defined(_SC_NPROCESSORS_ONLN)
+    long       n;    /* number of online cpus */
+#endif
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (opts.threads_set)
+    {
+        return opts.threads;
+    }
+
+    /*
+     * online cpus would count cpus that taskset, cgroup or -q took from
+     * us, and threads would share cpus then instead of scaling
+     */
+
+#if HAVE_SCHED_SETAFFINITY && defined(CPU_COUNT)
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+    {
+        return (unsigned long)CPU_COUNT(&set);
+    }
+
+    return opts.threads;
+#elif HAVE_SYSCONF && defined(_SC_NPROCESSORS_ONLN)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned long)n : opts.threads;
+#else
+    return opts.threads;
+#endif
+}
+
+
+/* ==========================================================================
+    fills 'counts' with thread counts to measure, powers of two up to 'max'
+    and 'max' itself
+
+    returns:
+            number of thread counts in 'counts'
+   ========================================================================== */
+
+
+size_t scale_counts
+(
+    unsigned long   max,     /* max number of threads */
+    unsigned long  *counts   /* thread counts will be stored here */
+)
+{
+    unsigned long   n;       /* current thread count */
+    size_t          np;      /* number of points */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (n = 1, np = 0; n < max; n *= 2)
+    {
+        if (counts)
+        {
+            counts[np] = n;
+        }
+
+        ++np;
+    }
+
+    if (counts)
+    {
+        counts[np] = max;
+    }
+
+    return np + 1;
+}
+
+
+/* ==========================================================================
+    finds saturation point of curve 's', that is the first point,  after
+    which adding threads gains less than SCALE_KNEE_GAIN of aggregate
+    bandwidth.
+
+    returns:
+            index of saturation point, or np - 1 when bandwidth grows up  to
+            the last point
+   ========================================================================== */
+
+
+size_t scale_knee
+(
+    const struct stats  *s,     /* bandwidth of each thread count */
+    size_t               np     /* number of thread counts */
+)
+{
+    size_t               knee;  /* saturation point */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (knee = 0; knee + 1 < np; ++knee)
+    {
+        if (s[knee + 1].mean < s[knee].mean * (1 + SCALE_KNEE_GAIN))
+        {
+            break;
+        }
+    }
+
+    return knee;
+}
+
+
+/* ==========================================================================
+    measures how copy bandwidth scales with number of threads.  Each method
+    is run with 1, 2, 4... threads up to opts.threads, or all cpus we  may
+    run on when -n was not given.  Every thread copies opts.report_intvl
+    bytes in its own opts.block_size buffers, and aggregate  bandwidth  is
+    total copied bytes over time until the last thread is done.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory or start threads
+   ========================================================================== */
+
+
+int scale_bench(void)
+{
+    struct scale_thread  *threads;       /* per thread state */
+    struct stats         *s;             /* bandwidth of each configuration */
+    unsigned long        *counts;        /* thread counts */
+    unsigned long         max;           /* max number of threads */
+    unsigned long         i;             /* iterator for loop */
+    unsigned long         n;             /* iterator for loop */
+    size_t                np;            /* number of thread counts */
+    size_t                m;             /* iterator for loop */
+    size_t                p;             /* iterator for loop */
+    char                  name[48];      /* name of configuration */
+    double                bw;            /* aggregate bandwidth */
+    int                   rc;            /* return code */
+    struct jedec          jd_block_size; /* block size in jedec format */
+    struct jedec          jd_intvl;      /* report interval in jedec format */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    max = scale_max_threads();
+    np = scale_counts(max, NULL);
+
+    threads = calloc(max, sizeof(*threads));
+    counts = malloc(np * sizeof(*counts));
+    s = malloc(SCALE_METHODS * np * sizeof(*s));
+
+    if (s)
+    {
+        for (p = 0; p != SCALE_METHODS * np; ++p)
+        {
+            stats_init(&s[p]);
+        }
+    }
+
+    if (threads == NULL || counts == NULL || s == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+        goto error;
+    }
+
+    scale_counts(max, counts);
+
+    for (n = 0; n != max; ++n)
+    {
+        threads[n].dst = malloc(opts.block_size);
+        threads[n].src = malloc(opts.block_size);
+
+        if (threads[n].dst == NULL || threads[n].src == NULL)
+        {
+            fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+            goto error;
+        }
+
+        memset(threads[n].src, (int)n, opts.block_size);
+        memset(threads[n].dst, 0, opts.block_size);
+    }
+
+    bytes2jedec(opts.block_size, &jd_block_size);
+    bytes2jedec(opts.report_intvl, &jd_intvl);
+
+    if (out_text())
+    {
+        printf("block size: %lu %cB, each thread copies %lu %cB, "
+               "max threads %lu, iterations %lu\n",
+               jd_block_size.val,
+               jd_block_size.pre,
+               jd_intvl.val,
+               jd_intvl.pre,
+               max,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(s, SCALE_METHODS * np, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        for (m = 0; m != SCALE_METHODS; ++m)
+        {
+            for (p = 0; p != np; ++p)
+            {
+                if (scale_run(threads, counts[p], (enum method)m, &bw) != 0)
+                {
+                    goto error;
+                }
+
+                if (stats_warmup(i))
+                {
+                    continue;
+                }
+
+                scale_report(i - opts.warmup + 1, m, counts[p], bw);
+
+                if (stats_add(&s[m * np + p], bw) != 0)
+                {
+                    fprintf(stderr, "Couldn't allocate memory for samples\n");
+                    goto error;
+                }
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of aggregate copy rate\n");
+    }
+
+    for (m = 0; m != SCALE_METHODS; ++m)
+    {
+        for (p = 0; p != np; ++p)
+        {
+            sprintf(name, "%s %lu threads", method_names[m], counts[p]);
+            stats_compute(&s[m * np + p], opts.outlier_mad);
+            stats_print(&s[m * np + p], name, "MB/s");
+        }
+    }
+
+    for (m = 0; m != SCALE_METHODS; ++m)
+    {
+        scale_curve(m, &s[m * np], counts, np);
+    }
+
+    rc = 0;
+
+error:
+    for (n = 0; threads && n != max; ++n)
+    {
+        free(threads[n].dst);
+        free(threads[n].src);
+    }
+
+    for (p = 0; s && p != SCALE_METHODS * np; ++p)
+    {
+        stats_destroy(&s[p]);
+    }
+
+    free(threads);
+    free(counts);
+    free(s);
+    return rc;
+}
+
+#endif
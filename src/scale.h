@@ -0,0 +1,26 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef SCALE_H
+#define SCALE_H 1
+
+#include <stddef.h>
+
+#include "stats.h"
+
+/*
+ * bandwidth is saturated at thread count, after which aggregate bandwidth
+ * grows by less than this fraction with next step
+ */
+
+#define SCALE_KNEE_GAIN 0.1
+
+unsigned long scale_max_threads(void);
+size_t scale_counts(unsigned long max, unsigned long *counts);
+size_t scale_knee(const struct stats *s, size_t np);
+int scale_bench(void);
+
+#endif
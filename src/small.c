@@ -0,0 +1,405 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "small.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * copied methods, stats of each method start with random sizes chain,
+ * followed by one for each size.  Loop without copy is not reported, it's
+ * only subtracted from methods.
+ */
+
+#define SMALL_METHODS 2
+#define SMALL_CONF (1 + SMALL_MAX)
+#define SMALL_LOOP SMALL_METHODS
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *method_names[SMALL_METHODS] =
+{
+    "memcpy",
+    "bbb"
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    runs chain of 'n' copies with 'method', each 'size' bytes, or of sizes
+    from 'seq' when it is not NULL, and times whole chain at once.  Copies
+    depend on each other, source of the next copy is offset by last  byte
+    of the previous one.  'src' is all zeros, so offset is always 0,  but
+    core can't know that until copy is done, and we measure  latency  of
+    copy, not throughput.  SMALL_LOOP method does everything but the copy,
+    and its time is what methods are corrected by.
+
+    returns:
+            time of single copy in ns
+   ========================================================================== */
+
+
+static double small_chain
+(
+    int                    method,  /* 0 memcpy, 1 byte by byte, 2 none */
+    const unsigned short  *seq,     /* sizes to copy, or NULL */
+    size_t                 n,       /* number of copies */
+    size_t                 size,    /* size of copy when 'seq' is NULL */
+    const unsigned char   *src,     /* source, all zeros */
+    unsigned char         *dst      /* destination */
+)
+{
+    struct ts              start;   /* timer indicating start of chain */
+    struct ts              finish;  /* timer indicating end of chain */
+    struct ts              taken;   /* time taken by chain */
+    size_t                 off;     /* offset of source from last copy */
+    size_t                 i;       /* iterator for loop */
+    size_t                 k;       /* iterator for byte by byte copy */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    off = 0;
+    ts_reset(&taken);
+    ts(&start);
+
+    for (i = 0; i != n; ++i)
+    {
+        size = seq ? seq[i] : size;
+
+        if (method == 1)
+        {
+            for (k = 0; k != size; ++k)
+            {
+                dst[k] = src[off + k];
+            }
+        }
+        else if (method == 0)
+        {
+            memcpy(dst, src + off, size);
+        }
+
+        /*
+         * load depends on 'off' also without copy, so loop keeps the same
+         * dependency chain
+         */
+
+        off = dst[size - 1 + off];
+    }
+
+    ts(&finish);
+    ts_add_diff(&taken, &start, &finish);
+
+    /*
+     * off is always 0, this only keeps the chain from being optimized away
+     */
+
+    return (ts2sec(&taken) + off) * 1e9 / n;
+}
+
+
+/* ==========================================================================
+    prints latency of every size from means of all intervals, in cycles of
+    time stamp counter when it is available, and in ns
+   ========================================================================== */
+
+
+static void small_table
+(
+    const struct stats  *s     /* stats of all methods */
+)
+{
+    double               hz;   /* frequency of time stamp counter */
+    size_t               n;    /* iterator for loop */
+    int                  m;    /* current method */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    hz = ts_tsc_hz();
+
+    if (!out_text())
+    {
+        for (n = 1; n <= SMALL_MAX; ++n)
+        {
+            for (m = 0; m != SMALL_METHODS; ++m)
+            {
+                out_record("latency");
+                out_str("name", method_names[m]);
+                out_ulong("size", n);
+                out_double("ns", s[m * SMALL_CONF + n].mean);
+                out_double("cycles", s[m * SMALL_CONF + n].mean * hz / 1e9);
+                out_double("ci95", s[m * SMALL_CONF + n].ci);
+                out_record_end();
+            }
+        }
+
+        return;
+    }
+
+    printf("latency per call%s\n", hz > 0 ? ", cycles of tsc" : "");
+    printf("%5s %12s %12s %12s %12s\n",
+           "size", "memcpy cyc", "memcpy ns", "bbb cyc", "bbb ns");
+
+    for (n = 1; n <= SMALL_MAX; ++n)
+    {
+        printf("%5lu", (unsigned long)n);
+
+        for (m = 0; m != SMALL_METHODS; ++m)
+        {
+            if (hz > 0)
+            {
+                printf(" %12.1f", s[m * SMALL_CONF + n].mean * hz / 1e9);
+            }
+            else
+            {
+                printf(" %12s", "-");
+            }
+
+            printf(" %12.2f", s[m * SMALL_CONF + n].mean);
+        }
+
+        printf("\n");
+    }
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    fills 'seq' with every size from 1 to SMALL_MAX, 'reps' times each, in
+    random order, so branch predictor can't learn size of the next copy
+   ========================================================================== */
+
+
+void small_shuffle
+(
+    unsigned short  *seq,   /* sequence of sizes to fill */
+    size_t           reps   /* number of times each size appears */
+)
+{
+    unsigned long    seed;  /* state of random generator */
+    unsigned short   tmp;   /* temporary for swap */
+    size_t           n;     /* number of elements in 'seq' */
+    size_t           i;     /* iterator for loop */
+    size_t           j;     /* element to swap with */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    n = reps * SMALL_MAX;
+
+    for (i = 0; i != n; ++i)
+    {
+        seq[i] = i % SMALL_MAX + 1;
+    }
+
+    seed = (unsigned long)time(NULL) | 1;
+
+    for (i = n - 1; i > 0; --i)
+    {
+        j = rnd(&seed) % (i + 1);
+        tmp = seq[i];
+        seq[i] = seq[j];
+        seq[j] = tmp;
+    }
+}
+
+
+/* ==========================================================================
+    measures latency of small copies, of every size from 1 to SMALL_MAX
+    bytes, with memcpy and byte by byte copy.  Every copy depends on  the
+    previous one.  Each size is timed as chain of copies of that size, and
+    all sizes together as chain of copies in random order, so branch
+    predictor can't learn them.  Time of the same chain without copies  is
+    subtracted.  Chains are as long as to copy about opts.report_intvl
+    bytes in interval.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory
+   ========================================================================== */
+
+
+int small_bench(void)
+{
+    struct stats        *s;        /* ns per call of every configuration */
+    double              *loop;     /* ns per call of loop, of each size */
+    unsigned short      *seq;      /* sizes to copy in random order */
+    unsigned char       *src;      /* source of copies */
+    unsigned char       *dst;      /* destination of copies */
+    unsigned long        i;        /* iterator for loop */
+    size_t               reps;     /* times each size is copied */
+    size_t               nconf;    /* number of configurations */
+    size_t               c;        /* current configuration */
+    size_t               n;        /* current size */
+    double               mixed;    /* ns per call of random sizes chain */
+    double               ns;       /* ns per call of current size */
+    char                 name[32]; /* name of configuration */
+    int                  m;        /* current method */
+    int                  rc;       /* return code */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    nconf = SMALL_METHODS * SMALL_CONF;
+
+    /*
+     * one repetition copies all sizes, that is SMALL_MAX * (SMALL_MAX + 1)
+     * / 2 bytes
+     */
+
+    reps = opts.report_intvl / (SMALL_MAX * (SMALL_MAX + 1) / 2);
+    reps = reps ? reps : 1;
+
+    s = malloc(nconf * sizeof(*s));
+    loop = malloc(SMALL_CONF * sizeof(*loop));
+    seq = malloc(reps * SMALL_MAX * sizeof(*seq));
+    src = calloc(1, 2 * SMALL_MAX);
+    dst = calloc(1, 2 * SMALL_MAX);
+
+    if (s)
+    {
+        for (c = 0; c != nconf; ++c)
+        {
+            stats_init(&s[c]);
+        }
+    }
+
+    if (s == NULL || loop == NULL || seq == NULL || src == NULL ||
+        dst == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate memory for benchmark\n");
+        goto error;
+    }
+
+    small_shuffle(seq, reps);
+
+    if (out_text())
+    {
+        printf("sizes 1 to %d bytes, %lu calls of each, iterations %lu\n",
+               SMALL_MAX,
+               (unsigned long)reps,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(s, nconf, i); ++i)
+    {
+        if (out_text() && !stats_warmup(i))
+        {
+            printf("interval %lu\n", i - opts.warmup + 1);
+        }
+
+        /*
+         * loop[0] is for random sizes chain, loop[n] for size n
+         */
+
+        loop[0] = small_chain(SMALL_LOOP, seq, reps * SMALL_MAX, 0,
+                              src, dst);
+
+        for (n = 1; n <= SMALL_MAX; ++n)
+        {
+            loop[n] = small_chain(SMALL_LOOP, NULL, reps, n, src, dst);
+        }
+
+        for (m = 0; m != SMALL_METHODS; ++m)
+        {
+            mixed = small_chain(m, seq, reps * SMALL_MAX, 0, src, dst);
+            mixed = mixed > loop[0] ? mixed - loop[0] : 0;
+
+            for (n = 1; n <= SMALL_MAX; ++n)
+            {
+                ns = small_chain(m, NULL, reps, n, src, dst);
+                ns = ns > loop[n] ? ns - loop[n] : 0;
+
+                if (!stats_warmup(i) &&
+                    stats_add(&s[m * SMALL_CONF + n], ns) != 0)
+                {
+                    fprintf(stderr,
+                            "Couldn't allocate memory for samples\n");
+                    goto error;
+                }
+            }
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            if (stats_add(&s[m * SMALL_CONF], mixed) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+
+            if (!out_text())
+            {
+                out_record("interval");
+                out_ulong("interval", i - opts.warmup + 1);
+                out_str("name", method_names[m]);
+                out_double("ns", mixed);
+                out_double("cycles", mixed * ts_tsc_hz() / 1e9);
+                out_record_end();
+                continue;
+            }
+
+            printf("%-6s random sizes %8.2f ns", method_names[m], mixed);
+
+            if (ts_tsc_hz() > 0)
+            {
+                printf(", %8.1f cycles", mixed * ts_tsc_hz() / 1e9);
+            }
+
+            printf("\n");
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of time per call\n");
+    }
+
+    for (c = 0; c != nconf; ++c)
+    {
+        stats_compute(&s[c], opts.outlier_mad);
+    }
+
+    for (m = 0; m != SMALL_METHODS; ++m)
+    {
+        sprintf(name, "%s random 1-%d", method_names[m], SMALL_MAX);
+        stats_print(&s[m * SMALL_CONF], name, "ns");
+    }
+
+    small_table(s);
+    rc = 0;
+
+error:
+    for (c = 0; s && c != nconf; ++c)
+    {
+        stats_destroy(&s[c]);
+    }
+
+    free(dst);
+    free(src);
+    free(seq);
+    free(loop);
+    free(s);
+    return rc;
+}
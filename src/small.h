@@ -0,0 +1,21 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef SMALL_H
+#define SMALL_H 1
+
+#include <stddef.h>
+
+/*
+ * every copy size from 1 to SMALL_MAX bytes is timed
+ */
+
+#define SMALL_MAX 512
+
+void small_shuffle(unsigned short *seq, size_t reps);
+int small_bench(void);
+
+#endif
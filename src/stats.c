@@ -0,0 +1,505 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base.h"
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private variables =================================================== */
+
+
+/*
+ * two sided 95% critical values of student's t distribution for 1 to 30
+ * degrees of freedom, index 0 is unused
+ */
+
+static const double t95[] =
+{
+    0.0,
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    compares two doubles for qsort()
+   ========================================================================== */
+
+
+static int stats_cmp
+(
+    const void  *a,  /* first value */
+    const void  *b   /* second value */
+)
+{
+    double       x;  /* first value */
+    double       y;  /* second value */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    x = *(const double *)a;
+    y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+/* ==========================================================================
+    returns median of 'n' sorted values in 'v'
+   ========================================================================== */
+
+
+static double stats_median
+(
+    const double  *v,  /* sorted values */
+    size_t         n   /* number of values */
+)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    if (n % 2)
+    {
+        return v[n / 2];
+    }
+
+    return (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+
+/* ==========================================================================
+    returns two sided 95% critical value of student's t distribution  for
+    'df' degrees of freedom.  Above 30 it is approximated, error is  below
+    0.001 which is way less than noise of any memory benchmark
+   ========================================================================== */
+
+
+static double stats_t95
+(
+    size_t  df  /* degrees of freedom */
+)
+{
+    if (df < sizeof(t95) / sizeof(*t95))
+    {
+        return t95[df];
+    }
+
+    return 1.96 + (t95[30] - 1.96) * 30 / df;
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    initializes empty set of samples
+   ========================================================================== */
+
+
+void stats_init
+(
+    struct stats  *s  /* stats to initialize */
+)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+
+/* ==========================================================================
+    appends sample 'v' to 's'
+
+    returns:
+             0      sample added
+            -1      couldn't allocate memory for sample
+   ========================================================================== */
+
+
+int stats_add
+(
+    struct stats  *s,     /* stats to add sample to */
+    double         v      /* sample to add */
+)
+{
+    double        *smp;   /* reallocated samples */
+    double        *dev;   /* reallocated deviations */
+    size_t         size;  /* new number of slots */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (s->n == s->size)
+    {
+        size = s->size ? s->size * 2 : 16;
+
+        if ((smp = realloc(s->samples, size * sizeof(*smp))) == NULL)
+        {
+            return -1;
+        }
+
+        s->samples = smp;
+
+        if ((dev = realloc(s->dev, size * sizeof(*dev))) == NULL)
+        {
+            return -1;
+        }
+
+        s->dev = dev;
+        s->size = size;
+    }
+
+    s->samples[s->n++] = v;
+    return 0;
+}
+
+
+/* ==========================================================================
+    calculates mean, median, standard deviation  and  95%  confidence
+    interval of the mean from collected samples.  When 'mad_k' is  bigger
+    than 0, samples that are further than 'mad_k' scaled median  absolute
+    deviations from the median are rejected as outliers before that.
+   ========================================================================== */
+
+
+void stats_compute
+(
+    struct stats  *s,      /* stats to compute */
+    double         mad_k   /* outlier threshold in MADs, 0 disables it */
+)
+{
+    double         med;    /* median of all samples */
+    double         lim;    /* max allowed distance from median */
+    double         sum;    /* sum of used samples or squared deviations */
+    size_t         lo;     /* first used sample */
+    size_t         hi;     /* one past last used sample */
+    size_t         i;      /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    s->used = 0;
+    s->mean = 0;
+    s->median = 0;
+    s->stddev = 0;
+    s->ci = 0;
+
+    if (s->n == 0)
+    {
+        return;
+    }
+
+    /*
+     * samples are sorted, so whatever is left after rejecting outliers is
+     * a continuous range of them
+     */
+
+    qsort(s->samples, s->n, sizeof(*s->samples), stats_cmp);
+    lo = 0;
+    hi = s->n;
+
+    if (mad_k > 0)
+    {
+        med = stats_median(s->samples, s->n);
+
+        for (i = 0; i != s->n; ++i)
+        {
+            s->dev[i] = fabs(s->samples[i] - med);
+        }
+
+        qsort(s->dev, s->n, sizeof(*s->dev), stats_cmp);
+        lim = mad_k * STATS_MAD_SCALE * stats_median(s->dev, s->n);
+
+        /*
+         * when more than half of samples are equal, mad is 0 and every
+         * other sample would be rejected, don't trust it then
+         */
+
+        lim = lim > 0 ? lim : HUGE_VAL;
+
+        while (lo != hi && med - s->samples[lo] > lim)
+        {
+            ++lo;
+        }
+
+        while (hi != lo && s->samples[hi - 1] - med > lim)
+        {
+            --hi;
+        }
+
+        /*
+         * with very small threshold even median sample(s) may be rejected,
+         * as with 2 samples, which are both more than mad_k MADs away from
+         * their mean, keep at least them then
+         */
+
+        if (lo == hi)
+        {
+            lo = (s->n - 1) / 2;
+            hi = s->n / 2 + 1;
+        }
+    }
+
+    s->used = hi - lo;
+    s->median = stats_median(s->samples + lo, s->used);
+
+    for (sum = 0, i = lo; i != hi; ++i)
+    {
+        sum += s->samples[i];
+    }
+
+    s->mean = sum / s->used;
+
+    if (s->used < 2)
+    {
+        return;
+    }
+
+    for (sum = 0, i = lo; i != hi; ++i)
+    {
+        sum += (s->samples[i] - s->mean) * (s->samples[i] - s->mean);
+    }
+
+    s->stddev = sqrt(sum / (s->used - 1));
+    s->ci = stats_t95(s->used - 1) * s->stddev / sqrt(s->used);
+}
+
+
+/* ==========================================================================
+    checks if confidence interval of already computed 's' is narrower than
+    'target' percent of the mean.
+
+    returns:
+             1      interval is narrow enough
+             0      more samples are needed
+   ========================================================================== */
+
+
+int stats_done
+(
+    const struct stats  *s,      /* computed stats */
+    double               target  /* max half width of ci in % of mean */
+)
+{
+    if (s->used < STATS_MIN_SAMPLES || s->mean == 0)
+    {
+        return 0;
+    }
+
+    return s->ci / fabs(s->mean) * 100 <= target;
+}
+
+
+/* ==========================================================================
+    checks if interval 'i' is warm up interval, which results should be
+    discarded
+
+    returns:
+             1      interval is warm up
+             0      interval is measured
+   ========================================================================== */
+
+
+int stats_warmup
+(
+    unsigned long  i  /* interval number, counted from 0 */
+)
+{
+    return i < opts.warmup;
+}
+
+
+/* ==========================================================================
+    decides whether interval 'i' should be run, for test that  collects
+    'nconf' configurations in 's'.  Warm up intervals are always run,  and
+    then opts.num_intvl intervals.  In adaptive mode  opts.num_intvl  is
+    the upper limit, and test ends as soon as confidence interval of every
+    configuration is narrower than opts.ci_target.
+
+    returns:
+             1      interval should be run
+             0      test is finished
+   ========================================================================== */
+
+
+int stats_next
+(
+    struct stats   *s,      /* stats of all configurations */
+    size_t          nconf,  /* number of configurations in s */
+    unsigned long   i       /* interval number, counted from 0 */
+)
+{
+    size_t          c;      /* current configuration */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (stats_warmup(i))
+    {
+        return 1;
+    }
+
+    if (i - opts.warmup >= opts.num_intvl)
+    {
+        return 0;
+    }
+
+    if (opts.ci_target <= 0)
+    {
+        return 1;
+    }
+
+    for (c = 0; c != nconf; ++c)
+    {
+        if (s[c].n == 0 && i != opts.warmup)
+        {
+            /*
+             * configuration that was never measured, like  instruction
+             * not supported by cpu, it will never get any narrower
+             */
+
+            continue;
+        }
+
+        stats_compute(&s[c], opts.outlier_mad);
+
+        if (!stats_done(&s[c], opts.ci_target))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* ==========================================================================
+    checks, with welch's t-test, if mean of computed 's' differs from mean
+    of another set of 'n' samples with 'mean' and 'stddev',  at  95%  level
+    of confidence.  When either side has less than 2 samples,  variance  is
+    unknown and difference can't be tested, it's then assumed  significant,
+    so caller's threshold alone decides.
+
+    returns:
+             1      means differ significantly
+             0      difference can be explained by noise
+   ========================================================================== */
+
+
+int stats_welch
+(
+    const struct stats  *s,       /* computed stats */
+    double               mean,    /* mean of other samples */
+    double               stddev,  /* standard deviation of other samples */
+    size_t               n        /* number of other samples */
+)
+{
+    double               va;      /* squared standard error of s */
+    double               vb;      /* squared standard error of other */
+    double               df;      /* welch-satterthwaite degrees of freedom */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (s->used < 2 || n < 2)
+    {
+        return 1;
+    }
+
+    va = s->stddev * s->stddev / s->used;
+    vb = stddev * stddev / n;
+
+    if (va + vb == 0)
+    {
+        return s->mean != mean;
+    }
+
+    df = (va + vb) * (va + vb) /
+        (va * va / (s->used - 1) + vb * vb / (n - 1));
+
+    /*
+     * fractional degrees of freedom are rounded down, which  makes  test
+     * slightly more conservative
+     */
+
+    return fabs(s->mean - mean) / sqrt(va + vb) >
+        stats_t95(df < 1 ? 1 : (size_t)df);
+}
+
+
+/* ==========================================================================
+    prints summary of computed 's' for configuration 'name', with samples
+    in 'unit', as text or as machine readable record, followed by result of
+    comparison against baseline, if one was loaded
+   ========================================================================== */
+
+
+void stats_print
+(
+    const struct stats  *s,     /* computed stats to print */
+    const char          *name,  /* name of configuration */
+    const char          *unit   /* unit of samples */
+)
+{
+    double               pct;   /* ci in percents of mean */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    pct = s->mean ? s->ci / fabs(s->mean) * 100 : 0;
+
+    if (!out_text())
+    {
+        out_record("summary");
+        out_str("name", name);
+        out_str("unit", unit);
+        out_double("mean", s->mean);
+        out_double("median", s->median);
+        out_double("stddev", s->stddev);
+        out_double("ci95", s->ci);
+        out_double("ci95_pct", pct);
+        out_ulong("samples", s->used);
+        out_ulong("outliers", s->n - s->used);
+        out_record_end();
+        base_compare(s, name, unit);
+        return;
+    }
+
+    printf("%-22s mean %10.2f %s, median %10.2f, stddev %9.2f, "
+           "ci95 +/- %9.2f (%6.2f%%), samples %lu, outliers %lu\n",
+           name,
+           s->mean,
+           unit,
+           s->median,
+           s->stddev,
+           s->ci,
+           pct,
+           (unsigned long)s->used,
+           (unsigned long)(s->n - s->used));
+    base_compare(s, name, unit);
+}
+
+
+/* ==========================================================================
+    releases memory allocated for samples
+   ========================================================================== */
+
+
+void stats_destroy
+(
+    struct stats  *s  /* stats to destroy */
+)
+{
+    free(s->samples);
+    free(s->dev);
+    stats_init(s);
+}
@@ -0,0 +1,49 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef STATS_H
+#define STATS_H 1
+
+#include <stddef.h>
+
+/*
+ * minimum number of samples, adaptive mode will not stop before that
+ * many intervals were collected, no matter how narrow interval is
+ */
+
+#define STATS_MIN_SAMPLES 5
+
+/*
+ * scale factor that turns median absolute deviation into estimate of
+ * standard deviation for normally distributed samples
+ */
+
+#define STATS_MAD_SCALE 1.4826
+
+struct stats
+{
+    double *samples;  /* collected samples, sorted by stats_compute() */
+    double *dev;      /* scratch space for deviations from median */
+    size_t size;      /* number of samples that fit in allocated memory */
+    size_t n;         /* number of collected samples */
+    size_t used;      /* samples left after outlier rejection */
+    double mean;      /* mean of used samples */
+    double median;    /* median of used samples */
+    double stddev;    /* sample standard deviation of used samples */
+    double ci;        /* half width of 95% confidence interval of mean */
+};
+
+void stats_init(struct stats *s);
+int stats_add(struct stats *s, double v);
+void stats_compute(struct stats *s, double mad_k);
+int stats_done(const struct stats *s, double target);
+int stats_warmup(unsigned long i);
+int stats_welch(const struct stats *s, double mean, double stddev, size_t n);
+int stats_next(struct stats *s, size_t nconf, unsigned long i);
+void stats_print(const struct stats *s, const char *name, const char *unit);
+void stats_destroy(struct stats *s);
+
+#endif
@@ -14,9 +14,40 @@
 #include <time.h>
 #include <string.h>
 #include <limits.h>
-
+#include <math.h>
+
+#include "alloc.h"
+#include "arena.h"
+#include "atomic.h"
+#include "base.h"
+#include "bench.h"
+#include "flush.h"
+#include "freq.h"
+#include "grow.h"
+#include "hist.h"
+#include "loaded.h"
+#include "neighbour.h"
+#include "noise.h"
+#include "pool.h"
+#include "stats.h"
 #include "utils.h"
+#include "zero.h"
 #include "opts.h"
+#include "overlap.h"
+#include "pcopy.h"
+#include "out.h"
+#include "pmc.h"
+#include "quiet.h"
+#include "replay.h"
+#include "roofline.h"
+#include "scale.h"
+#include "small.h"
+#include "tracehist.h"
+
+#if HAVE_FORK
+#include <errno.h>
+#include <sys/wait.h>
+#endif
 
 #undef fprintf
 #undef printf
@@ -24,6 +55,16 @@
 mt_defs();
 
 
+/* ==== Private macros ====================================================== */
+
+
+/*
+ * builds nanosecond tick of clock_gettime() clocks from seconds and ns
+ */
+
+#define NS(sec, nsec) ((tick_t)(sec) * 1000000000l + (nsec))
+
+
 /* ==== Private functions =================================================== */
 
 
@@ -224,439 +265,466 @@ static void opts_free
 /* ==== utils.c tests ======================================================= */
 
 
-void ts_new_clock(void)
+void ts_clock(void)
 {
-    void *tm;
+    struct ts tm;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_CLOCK;
+    ts_init();
 
-    mt_assert(tm = ts_new());
-
-    free(tm);
+    ts_reset(&tm);
+    mt_fail(tm.t == 0);
+    ts(&tm);
+    mt_fail(tm.t != 0);
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
-void ts_clock(void)
+void ts_reset_clock(void)
 {
-    clock_t *tm;
+    struct ts tm;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_CLOCK;
+    ts_init();
 
-    mt_assert(tm = ts_new());
-    ts_reset(tm);
-    mt_fail(*tm == 0);
-    ts(tm);
-    mt_fail(*tm != 0);
-
-    free(tm);
+    tm.t = 1234;
+    ts_reset(&tm);
+    mt_fail(tm.t == 0);
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
-void ts_reset_clock(void)
+void ts_add_diff_clock_single(void)
 {
-    clock_t *tm;
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_CLOCK;
+    ts_init();
+    ts_overhead = 0;
 
-    mt_assert(tm = ts_new());
-    ts_reset(tm);
-    mt_fail(*tm == 0);
+    ts_reset(&tm);
 
-    free(tm);
-}
+    start.t = 1000;
+    finish.t = 1500;
 
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == 500);
+}
 
 /* ==========================================================================
    ========================================================================== */
 
 
-void ts_add_diff_clock_single(void)
+void ts_add_diff_clock_multi(void)
 {
-    clock_t *tm;
-    clock_t *start;
-    clock_t *finish;
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_CLOCK;
+    ts_init();
+    ts_overhead = 0;
 
-    mt_fail(tm = ts_new());
-    mt_fail(start = ts_new());
-    mt_fail(finish = ts_new());
-
-    if (tm == NULL || start == NULL || finish == NULL)
-    {
-        return;
-    }
+    ts_reset(&tm);
 
-    ts_reset(tm);
+    start.t = 1000;
+    finish.t = 1500;
 
-    *start = 1000;
-    *finish = 1500;
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == 500);
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(*tm == 500);
+    start.t = 2000;
+    finish.t = 3000;
 
-    free(tm);
-    free(start);
-    free(finish);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == 1500);
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
-void ts_add_diff_clock_multi(void)
+void ts_add_diff_overhead(void)
 {
-    clock_t *tm;
-    clock_t *start;
-    clock_t *finish;
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_CLOCK;
+    ts_init();
+    ts_overhead = 100;
 
-    mt_fail(tm = ts_new());
-    mt_fail(start = ts_new());
-    mt_fail(finish = ts_new());
+    ts_reset(&tm);
 
-    if (tm == NULL || start == NULL || finish == NULL)
-    {
-        return;
-    }
+    start.t = 1000;
+    finish.t = 1500;
 
-    ts_reset(tm);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == 400);
 
-    *start = 1000;
-    *finish = 1500;
+    /*
+     * period shorter than overhead is just noise, it must not  wrap  nor
+     * decrease time
+     */
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(*tm == 500);
+    start.t = 2000;
+    finish.t = 2050;
 
-    *start = 2000;
-    *finish = 3000;
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == 400);
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(*tm == 1500);
+    start.t = 2000;
+    finish.t = 2100;
 
-    free(tm);
-    free(start);
-    free(finish);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == 400);
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
-#if HAVE_CLOCK_GETTIME
-void ts_new_realtime(void)
+void ts_init_overhead(void)
 {
-    void *tm;
+    struct ts start;
+    struct ts finish;
+    struct ts tm;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    opts.clock = CLK_REALTIME;
+    opts.clock = CLK_CLOCK;
+    ts_init();
+
+    /*
+     * reading clock back to back must not take longer than 1ms, and with
+     * overhead subtracted, empty region should take next to nothing
+     */
 
-    mt_assert(tm = ts_new());
+    tm.t = ts_overhead;
+    mt_fail(ts2us(&tm) < 1000);
 
-    free(tm);
+    ts_reset(&tm);
+    ts(&start);
+    ts(&finish);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(ts2us(&tm) < 1000);
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
+#if HAVE_CLOCK_GETTIME
 void ts_realtime(void)
 {
-    struct timespec *tm;
+    struct ts tm;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_REALTIME;
+    ts_init();
 
-    mt_assert(tm = ts_new());
-    ts_reset(tm);
-    mt_fail(tm->tv_sec == 0);
-    mt_fail(tm->tv_nsec == 0);
-    ts(tm);
-    mt_fail(tm->tv_sec != 0);
-
-    free(tm);
+    ts_reset(&tm);
+    mt_fail(tm.t == 0);
+    ts(&tm);
+    mt_fail(tm.t / 1000000000 != 0);
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
 void ts_reset_realtime(void)
 {
-    struct timespec *tm;
+    struct ts tm;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_REALTIME;
+    ts_init();
 
-    mt_assert(tm = ts_new());
-    ts_reset(tm);
-    mt_fail(tm->tv_sec == 0);
-    mt_fail(tm->tv_nsec == 0);
-
-    free(tm);
+    ts(&tm);
+    ts_reset(&tm);
+    mt_fail(tm.t == 0);
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
 void ts_add_diff_realtime_single_simple(void)
 {
-    struct timespec *tm;
-    struct timespec *start;
-    struct timespec *finish;
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_REALTIME;
+    ts_init();
+    ts_overhead = 0;
 
-    mt_fail(tm = ts_new());
-    mt_fail(start = ts_new());
-    mt_fail(finish = ts_new());
-
-    if (tm == NULL || start == NULL || finish == NULL)
-    {
-        return;
-    }
-
-    ts_reset(tm);
-
-    start->tv_sec = 1000;
-    start->tv_nsec = 0;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 0;
+    ts_reset(&tm);
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 500);
-    mt_fail(tm->tv_nsec == 0);
+    start.t = NS(1000, 0);
+    finish.t = NS(1500, 0);
 
-    free(tm);
-    free(start);
-    free(finish);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(500, 0));
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
 void ts_add_diff_realtime_single_with_nsec_no_overflow(void)
 {
-    struct timespec *tm;
-    struct timespec *start;
-    struct timespec *finish;
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_REALTIME;
+    ts_init();
+    ts_overhead = 0;
 
-    mt_fail(tm = ts_new());
-    mt_fail(start = ts_new());
-    mt_fail(finish = ts_new());
+    ts_reset(&tm);
 
-    if (tm == NULL || start == NULL || finish == NULL)
-    {
-        return;
-    }
+    start.t = NS(1000, 100);
+    finish.t = NS(1500, 400);
+
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(500, 300));
+}
 
-    ts_reset(tm);
+/* ==========================================================================
+   ========================================================================== */
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 100;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 400;
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 500);
-    mt_fail(tm->tv_nsec == 300);
+void ts_add_diff_realtime_single_with_nsec_overflow_down(void)
+{
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    opts.clock = CLK_REALTIME;
+    ts_init();
+    ts_overhead = 0;
 
-    free(tm);
-    free(start);
-    free(finish);
-}
+    ts_reset(&tm);
 
+    start.t = NS(1000, 200000000);
+    finish.t = NS(1500, 100000000);
+
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(499, 900000000));
+}
 
 /* ==========================================================================
    ========================================================================== */
 
 
-void ts_add_diff_realtime_single_with_nsec_overflow_down(void)
+void ts_add_diff_realtime_single_with_nsec_overflow_up(void)
 {
-    struct timespec *tm;
-    struct timespec *start;
-    struct timespec *finish;
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_REALTIME;
+    ts_init();
+    ts_overhead = 0;
 
-    mt_fail(tm = ts_new());
-    mt_fail(start = ts_new());
-    mt_fail(finish = ts_new());
-
-    if (tm == NULL || start == NULL || finish == NULL)
-    {
-        return;
-    }
+    ts_reset(&tm);
 
-    ts_reset(tm);
+    start.t = NS(1000, 300000000);
+    finish.t = NS(1500, 800000000);
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 200000000;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 100000000;
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(500, 500000000));
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 499);
-    mt_fail(tm->tv_nsec == 900000000);
+    start.t = NS(1000, 100000000);
+    finish.t = NS(1500, 800000000);
 
-    free(tm);
-    free(start);
-    free(finish);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(1001, 200000000));
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
-void ts_add_diff_realtime_single_with_nsec_overflow_up(void)
+void ts_add_diff_realtime_multi_combined(void)
 {
-    struct timespec *tm;
-    struct timespec *start;
-    struct timespec *finish;
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
     opts.clock = CLK_REALTIME;
+    ts_init();
+    ts_overhead = 0;
 
-    mt_fail(tm = ts_new());
-    mt_fail(start = ts_new());
-    mt_fail(finish = ts_new());
+    ts_reset(&tm);
 
-    if (tm == NULL || start == NULL || finish == NULL)
-    {
-        return;
-    }
+    start.t = NS(1000, 0);
+    finish.t = NS(1500, 0);
+
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(500, 0));
+
+    start.t = NS(1000, 0);
+    finish.t = NS(1500, 0);
 
-    ts_reset(tm);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(1000, 0));
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 300000000;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 800000000;
+    start.t = NS(1000, 400000000);
+    finish.t = NS(1500, 900000000);
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 500);
-    mt_fail(tm->tv_nsec == 500000000);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(1500, 500000000));
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 100000000;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 800000000;
+    start.t = NS(1000, 0);
+    finish.t = NS(1500, 700000000);
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 1001);
-    mt_fail(tm->tv_nsec == 200000000);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(2001, 200000000));
 
-    free(tm);
-    free(start);
-    free(finish);
+    start.t = NS(1000, 500000001);
+    finish.t = NS(1500, 300000000);
+
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(2500, 999999999));
 }
+#endif
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+#if HAVE_CLOCK_GETTIME && HAVE_DECL_CLOCK_MONOTONIC_RAW
+void ts_monotonic_raw(void)
+{
+    struct ts tm;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    opts.clock = CLK_MONOTONIC_RAW;
+    ts_init();
 
+    ts_reset(&tm);
+    mt_fail(tm.t == 0);
+    ts(&tm);
+    mt_fail(tm.t != 0);
+}
 
 /* ==========================================================================
    ========================================================================== */
 
 
-void ts_add_diff_realtime_multi_combined(void)
+void ts_add_diff_monotonic_raw(void)
 {
-    struct timespec *tm;
-    struct timespec *start;
-    struct timespec *finish;
+    struct ts tm;
+    struct ts start;
+    struct ts finish;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    opts.clock = CLK_REALTIME;
+    opts.clock = CLK_MONOTONIC_RAW;
+    ts_init();
+    ts_overhead = 0;
 
-    mt_fail(tm = ts_new());
-    mt_fail(start = ts_new());
-    mt_fail(finish = ts_new());
+    ts_reset(&tm);
 
-    if (tm == NULL || start == NULL || finish == NULL)
-    {
-        return;
-    }
+    start.t = NS(10, 900000000);
+    finish.t = NS(12, 100000000);
 
-    ts_reset(tm);
+    ts_add_diff(&tm, &start, &finish);
+    mt_fail(tm.t == NS(1, 200000000));
+    mt_fail(ts2us(&tm) == 1200000);
+}
+#endif
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 0;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 0;
+/* ==========================================================================
+   ========================================================================== */
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 500);
-    mt_fail(tm->tv_nsec == 0);
 
+#if HAVE_RDTSC
+void ts_tsc(void)
+{
+    struct ts tm;
+    tick_t    prev;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 0;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 0;
+    opts.clock = CLK_TSC;
+    ts_init();
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 1000);
-    mt_fail(tm->tv_nsec == 0);
+    mt_fail(ts_tsc_hz() > 0);
+    ts_reset(&tm);
+    mt_fail(tm.t == 0);
+    ts(&tm);
+    prev = tm.t;
+    ts(&tm);
+    mt_fail(tm.t > prev);
+}
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 400000000;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 900000000;
+/* ==========================================================================
+   ========================================================================== */
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 1500);
-    mt_fail(tm->tv_nsec == 500000000);
 
+void ts_add_diff_tsc(void)
+{
+    struct ts      tm;
+    struct ts      start;
+    struct ts      finish;
+    unsigned long  us;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 0;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 700000000;
+    opts.clock = CLK_TSC;
+    ts_init();
+    ts_overhead = 0;
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 2001);
-    mt_fail(tm->tv_nsec == 200000000);
+    ts_reset(&tm);
 
-    start->tv_sec = 1000;
-    start->tv_nsec = 500000001;
-    finish->tv_sec = 1500;
-    finish->tv_nsec = 300000000;
+    /*
+     * exactly one second worth of cycles in two steps
+     */
 
-    ts_add_diff(tm, start, finish);
-    mt_fail(tm->tv_sec == 2500);
-    mt_fail(tm->tv_nsec == 999999999);
+    start.t = 1000;
+    finish.t = 1000 + (tick_t)(ts_tsc_hz() / 2);
+    ts_add_diff(&tm, &start, &finish);
+    ts_add_diff(&tm, &start, &finish);
 
-    free(tm);
-    free(start);
-    free(finish);
+    mt_fail(ts2cycles(&tm) == tm.t);
+    us = ts2us(&tm);
+    mt_fail(us >= 999999 && us <= 1000000);
 }
-#endif
 
+/* ==========================================================================
+   ========================================================================== */
+
+
+void ts2cycles_clock(void)
+{
+    struct ts  tm;
+    double     cycles;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    opts.clock = CLK_CLOCK;
+    ts_init();
+
+    tm.t = CLOCKS_PER_SEC;
+    cycles = ts2cycles(&tm);
+    mt_fail(cycles > ts_tsc_hz() - 1 && cycles < ts_tsc_hz() + 1);
+}
+#endif
 
 /* ==========================================================================
    ========================================================================== */
@@ -705,87 +773,66 @@ void bytes2jedec_test(void)
 }
 
 
-/* ==== opts.c tests ======================================================== */
+/* ==========================================================================
+   ========================================================================== */
 
 
-void opts_parse_default_all(void)
+void ts2ns_clock(void)
 {
-    char **argv;
-    int    argc;
+    struct ts tm;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("", &argc);
-    opts_parse(argc, argv);
-
-    mt_fail(opts.block_size == 16 * 1024);
-    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-    mt_fail(opts.num_intvl == 10);
-    mt_fail(opts.method == METHOD_MEMCPY);
-    mt_fail(opts.cache_size == 1 * 1024 * 1024);
-
-#if HAVE_CLOCK_GETTIME
-    mt_fail(opts.clock == CLK_REALTIME);
-#else
-    mt_fail(opts.clock == CLK_CLOCK);
-#endif
+    opts.clock = CLK_CLOCK;
+    ts_init();
 
-    opts_free(argc, argv);
+    tm.t = CLOCKS_PER_SEC / 1000;
+    mt_fail(ts2ns(&tm) == 1000000);
 }
 
-
 /* ==========================================================================
    ========================================================================== */
 
 
-void opts_parse_opt_b_invalid_prefixes(void)
+#if HAVE_CLOCK_GETTIME
+void ts2ns_realtime(void)
 {
-    char  **argv;
-    int     argc;
-    char    c;
-    char    param[16];
+    struct ts tm;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (c = 'A'; c != 'Z' + 1; ++c)
-    {
-        sprintf(param, "-b1%c", c);
-        argv = str2opts(param, &argc);
-
-        if (c == 'G' || c == 'M' || c == 'K')
-        {
-            mt_fail(opts_parse(argc, argv) == 0);
-        }
-        else
-        {
-            mt_fail(opts_parse(argc, argv) == -2);
-        }
+    opts.clock = CLK_REALTIME;
+    ts_init();
 
-        opts_free(argc, argv);
-    }
+    tm.t = NS(2, 123);
+    mt_fail(ts2ns(&tm) == 2000000123);
 }
-
+#endif
 
 /* ==========================================================================
    ========================================================================== */
 
 
-void opts_parse_opt_b_invalid_param(void)
+void ts2sec_test(void)
 {
-    char  **argv;
-    int     argc;
+    struct ts tm;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("-banan", &argc);
-
-    mt_fail(opts_parse(argc, argv) == -2);
-
-    opts_free(argc, argv);
+    opts.clock = CLK_CLOCK;
+    ts_init();
 
+    tm.t = CLOCKS_PER_SEC * 5 + CLOCKS_PER_SEC / 4;
+    mt_fail(ts2sec(&tm) == 5.25);
 
-    argv = str2opts("-b", &argc);
+#if HAVE_CLOCK_GETTIME
+    opts.clock = CLK_REALTIME;
+    ts_init();
 
-    mt_fail(opts_parse(argc, argv) == -2);
+    /*
+     * more than 2^32 ns, would overflow ts2ns() on 32 bit long
+     */
 
-    opts_free(argc, argv);
+    tm.t = NS(7, 500);
+    mt_fail(ts2sec(&tm) == 7.0000005);
+#endif
 }
 
 
@@ -793,33 +840,24 @@ void opts_parse_opt_b_invalid_param(void)
    ========================================================================== */
 
 
-void opts_parse_opt_b_bytes(void)
+void rnd_test(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    unsigned long  seed;
+    unsigned long  prev;
+    unsigned long  v;
+    int            i;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000; i <<= 1)
-    {
-        sprintf(param, "-b%lu", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
-
-        mt_fail(opts.block_size == i);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
-
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    seed = 1;
+    prev = 0;
 
-        opts_free(argc, argv);
+    for (i = 0; i != 1000; ++i)
+    {
+        v = rnd(&seed);
+        mt_fail(v != 0);
+        mt_fail(v != prev);
+        mt_fail(v <= 0xfffffffful);
+        prev = v;
     }
 }
 
@@ -828,104 +866,123 @@ void opts_parse_opt_b_bytes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_b_kbytes(void)
+void rss_grows(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    size_t  before;
+    size_t  after;
+    char   *p;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000 ; i <<= 1)
+    if ((before = rss()) == 0)
     {
-        sprintf(param, "-b%luK", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+        /*
+         * system doesn't expose rss, nothing to test
+         */
 
-        mt_fail(opts.block_size == i * 1024l);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+        return;
+    }
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    mt_assert(p = malloc(16 * 1024 * 1024));
+    memset(p, 0xaa, 16 * 1024 * 1024);
+    after = rss();
 
-        opts_free(argc, argv);
-    }
+    mt_fail(after >= before + 15 * 1024 * 1024);
+    mt_fail(p[16 * 1024 * 1024 - 1] == (char)0xaa);
+    free(p);
 }
 
 
+#if HAVE_PTHREAD_H
+
 /* ==========================================================================
    ========================================================================== */
 
 
-void opts_parse_opt_b_mbytes(void)
+static void *barrier_waiter
+(
+    void  *arg
+)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
-    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+    barrier_wait(arg);
+    return NULL;
+}
 
-    for (i = 1; i < 1000000; i <<= 1)
-    {
-        sprintf(param, "-b%luM", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+/* ==========================================================================
+   ========================================================================== */
 
-        mt_fail(opts.block_size == i * 1024l * 1024);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+void barrier_resize_releases(void)
+{
+    struct barrier  b;
+    pthread_t       tid;
+    unsigned        waiting;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-        opts_free(argc, argv);
+    /*
+     * barrier waits for 3 threads, but only one ever comes, resizing it
+     * to 1 must let that one go
+     */
+
+    mt_assert(barrier_init(&b, 3) == 0);
+    mt_assert(pthread_create(&tid, NULL, barrier_waiter, &b) == 0);
+
+    do
+    {
+        pthread_mutex_lock(&b.lock);
+        waiting = b.waiting;
+        pthread_mutex_unlock(&b.lock);
     }
+    while (waiting != 1);
+
+    barrier_resize(&b, 1);
+    mt_fail(pthread_join(tid, NULL) == 0);
+    mt_fail(b.waiting == 0);
+    mt_fail(b.phase == 1);
+
+    /*
+     * and from now on single thread passes on its own
+     */
+
+    barrier_wait(&b);
+    mt_fail(b.phase == 2);
+    barrier_destroy(&b);
 }
 
+#endif
 
-/* ==========================================================================
-   ========================================================================== */
 
+/* ==== flush.c tests ======================================================= */
 
-void opts_parse_opt_b_gbytes(void)
+
+#if HAVE_CLFLUSH
+
+void flush_has_fallback(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
-    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+    /*
+     * without cpuid, only clflush is assumed
+     */
 
-    for (i = 1; i < 1000000; i <<= 1)
-    {
-        sprintf(param, "-b%luG", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+    mt_fail(flush_has(FLUSH_CLFLUSH, 0, 0, 0) == 1);
+    mt_fail(flush_has(FLUSH_CLFLUSHOPT, 0, 0, 0) == 0);
+    mt_fail(flush_has(FLUSH_CLWB, 0, 0, 0) == 0);
 
-        mt_fail(opts.block_size == i * 1024l * 1024 * 1024);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    /*
+     * with cpuid, clflush must have its bit too
+     */
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    mt_fail(flush_has(FLUSH_CLFLUSH, 1, 0, 0) == 0);
+    mt_fail(flush_has(FLUSH_CLFLUSH, 1, 1u << 19, 0) == 1);
 
-        opts_free(argc, argv);
-    }
+    /*
+     * leaf 7 bits don't count, when cpu has no leaf 7
+     */
+
+    mt_fail(flush_has(FLUSH_CLFLUSHOPT, 6, 1u << 19, ~0u) == 0);
+    mt_fail(flush_has(FLUSH_CLWB, 6, 1u << 19, ~0u) == 0);
+    mt_fail(flush_has(FLUSH_CLFLUSHOPT, 7, 0, 1u << 23) == 1);
+    mt_fail(flush_has(FLUSH_CLWB, 7, 0, 1u << 23) == 0);
+    mt_fail(flush_has(FLUSH_CLWB, 7, 0, 1u << 24) == 1);
+    mt_fail(flush_has(FLUSH_CLFLUSHOPT, 7, 0, 1u << 24) == 0);
 }
 
 
@@ -933,30 +990,45 @@ void opts_parse_opt_b_gbytes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_r_invalid_prefixes(void)
+void flush_line_fallback(void)
 {
-    char  **argv;
-    int     argc;
-    char    c;
-    char    param[16];
-    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+    /*
+     * line size is in 8 byte units in bits 8-15 of ebx, 64 when cpuid
+     * or the field is missing
+     */
 
-    for (c = 'A'; c != 'Z' + 1; ++c)
-    {
-        sprintf(param, "-r1%c", c);
-        argv = str2opts(param, &argc);
+    mt_fail(flush_line(1, 8 << 8) == 64);
+    mt_fail(flush_line(1, 16 << 8 | 0xff) == 128);
+    mt_fail(flush_line(1, 0xffff00ffu) == 64);
+    mt_fail(flush_line(0, 16 << 8) == 64);
+    mt_fail(flush_line(0, 0) == 64);
+}
 
-        if (c == 'G' || c == 'M' || c == 'K')
-        {
-            mt_fail(opts_parse(argc, argv) == 0);
-        }
-        else
-        {
-            mt_fail(opts_parse(argc, argv) == -2);
-        }
+#endif
 
-        opts_free(argc, argv);
+
+/* ==== hist.c tests ======================================================== */
+
+
+void hist_exact_small_values(void)
+{
+    struct hist    h;
+    unsigned long  v;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    hist_reset(&h);
+
+    for (v = 1; v != 2 * HIST_SUB + 1; ++v)
+    {
+        hist_add(&h, v);
     }
+
+    mt_fail(h.n == 2 * HIST_SUB);
+    mt_fail(h.min == 1);
+    mt_fail(h.max == 2 * HIST_SUB);
+    mt_fail(hist_pct(&h, 0) == 1);
+    mt_fail(hist_pct(&h, 50) == HIST_SUB);
+    mt_fail(hist_pct(&h, 100) == 2 * HIST_SUB);
 }
 
 
@@ -964,24 +1036,28 @@ void opts_parse_opt_r_invalid_prefixes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_r_invalid_param(void)
+void hist_pct_accuracy(void)
 {
-    char  **argv;
-    int     argc;
+    struct hist    h;
+    unsigned long  v;
+    unsigned long  p;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("-ranan", &argc);
-
-    mt_fail(opts_parse(argc, argv) == -2);
-
-    opts_free(argc, argv);
-
-
-    argv = str2opts("-r", &argc);
+    hist_reset(&h);
 
-    mt_fail(opts_parse(argc, argv) == -2);
+    for (v = 1; v != 100001; ++v)
+    {
+        hist_add(&h, v);
+    }
 
-    opts_free(argc, argv);
+    p = hist_pct(&h, 50);
+    mt_fail(p > 50000 - 50000 / HIST_SUB && p < 50000 + 50000 / HIST_SUB);
+    p = hist_pct(&h, 99);
+    mt_fail(p > 99000 - 99000 / HIST_SUB && p < 99000 + 99000 / HIST_SUB);
+    p = hist_pct(&h, 99.9);
+    mt_fail(p > 99900 - 99900 / HIST_SUB && p <= 100000);
+    mt_fail(hist_pct(&h, 100) == 100000);
+    mt_fail(h.sum == 100000.0 * 100001 / 2);
 }
 
 
@@ -989,34 +1065,21 @@ void opts_parse_opt_r_invalid_param(void)
    ========================================================================== */
 
 
-void opts_parse_opt_r_bytes(void)
+void hist_big_values(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    struct hist    h;
+    unsigned long  v;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000; i <<= 1)
-    {
-        sprintf(param, "-r%lu", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
-
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == i);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    hist_reset(&h);
+    v = (unsigned long)-1;
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    hist_add(&h, v);
+    hist_add(&h, v - 1);
 
-        opts_free(argc, argv);
-    }
+    mt_fail(h.n == 2);
+    mt_fail(hist_pct(&h, 100) == v);
+    mt_fail(hist_pct(&h, 50) >= v - v / HIST_SUB);
 }
 
 
@@ -1024,34 +1087,27 @@ void opts_parse_opt_r_bytes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_r_kbytes(void)
+void hist_merge_test(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    struct hist  a;
+    struct hist  b;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000 ; i <<= 1)
-    {
-        sprintf(param, "-r%luK", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+    hist_reset(&a);
+    hist_reset(&b);
 
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == i * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    hist_add(&a, 10);
+    hist_add(&a, 20);
+    hist_add(&b, 5);
+    hist_add(&b, 1000);
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    hist_merge(&a, &b);
 
-        opts_free(argc, argv);
-    }
+    mt_fail(a.n == 4);
+    mt_fail(a.min == 5);
+    mt_fail(a.max == 1000);
+    mt_fail(a.sum == 1035);
+    mt_fail(hist_pct(&a, 50) == 10);
 }
 
 
@@ -1059,69 +1115,43 @@ void opts_parse_opt_r_kbytes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_r_mbytes(void)
+void hist_empty(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    struct hist  h;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000; i <<= 1)
-    {
-        sprintf(param, "-r%luM", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
-
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == i * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
-
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    hist_reset(&h);
 
-        opts_free(argc, argv);
-    }
+    mt_fail(h.n == 0);
+    mt_fail(hist_pct(&h, 50) == 0);
+    mt_fail(hist_pct(&h, 100) == 0);
 }
 
 
-/* ==========================================================================
-   ========================================================================== */
+/* ==== arena.c tests ======================================================= */
 
 
-void opts_parse_opt_r_gbytes(void)
+void arena_alloc_aligned(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    struct arena   a;
+    unsigned char *p;
+    size_t         i;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000; i <<= 1)
-    {
-        sprintf(param, "-r%luG", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+    arena_init(&a, 1024);
 
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == i * 1024 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    for (i = 1; i != 100; ++i)
+    {
+        mt_assert(p = arena_alloc(&a, i));
+        mt_fail(((size_t)p & (ARENA_ALIGN - 1)) == 0);
+        memset(p, 0xaa, i);
+    }
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    mt_assert(p = arena_alloc(&a, 4096));
+    mt_fail(((size_t)p & (ARENA_ALIGN - 1)) == 0);
+    memset(p, 0xaa, 4096);
 
-        opts_free(argc, argv);
-    }
+    arena_destroy(&a);
 }
 
 
@@ -1129,30 +1159,31 @@ void opts_parse_opt_r_gbytes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_l_invalid_prefixes(void)
+void arena_realloc_in_place(void)
 {
-    char  **argv;
-    int     argc;
-    char    c;
-    char    param[16];
+    struct arena   a;
+    unsigned char *p;
+    unsigned char *np;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (c = 'A'; c != 'Z' + 1; ++c)
-    {
-        sprintf(param, "-l1%c", c);
-        argv = str2opts(param, &argc);
+    arena_init(&a, 1024);
 
-        if (c == 'G' || c == 'M' || c == 'K')
-        {
-            mt_fail(opts_parse(argc, argv) == 0);
-        }
-        else
-        {
-            mt_fail(opts_parse(argc, argv) == -2);
-        }
+    mt_assert(p = arena_alloc(&a, 16));
+    memset(p, 0x55, 16);
+    mt_assert(np = arena_realloc(&a, p, 16, 256));
+    mt_fail(np == p);
+    mt_fail(np[15] == 0x55);
 
-        opts_free(argc, argv);
-    }
+    /*
+     * p is no longer last allocation, so it must be moved
+     */
+
+    mt_assert(arena_alloc(&a, 16));
+    mt_assert(np = arena_realloc(&a, p, 256, 512));
+    mt_fail(np != p);
+    mt_fail(np[0] == 0x55 && np[15] == 0x55);
+
+    arena_destroy(&a);
 }
 
 
@@ -1160,58 +1191,59 @@ void opts_parse_opt_l_invalid_prefixes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_l_invalid_param(void)
+void arena_reset_reuses_memory(void)
 {
-    char  **argv;
-    int     argc;
+    struct arena   a;
+    void          *first;
+    void          *p;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("-lanan", &argc);
-
-    mt_fail(opts_parse(argc, argv) == -2);
+    arena_init(&a, 1024);
 
-    opts_free(argc, argv);
+    mt_assert(first = arena_alloc(&a, 512));
+    mt_assert(arena_alloc(&a, 1000));
+    mt_assert(arena_alloc(&a, 5000));
 
-    argv = str2opts("-l", &argc);
+    arena_reset(&a);
 
-    mt_fail(opts_parse(argc, argv) == -2);
+    mt_assert(p = arena_alloc(&a, 512));
+    mt_fail(p == first);
 
-    opts_free(argc, argv);
+    arena_destroy(&a);
+    mt_fail(a.head == NULL);
 }
 
 
-/* ==========================================================================
-   ========================================================================== */
+/* ==== pool.c tests ======================================================== */
 
 
-void opts_parse_opt_l_bytes(void)
+void pool_alloc_free(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    struct pool    p;
+    unsigned char *objs[100];
+    void          *o;
+    size_t         i;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000; i <<= 1)
+    pool_init(&p, 100, 1024);
+
+    for (i = 0; i != 100; ++i)
     {
-        sprintf(param, "-l%lu", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+        mt_assert(objs[i] = pool_alloc(&p));
+        memset(objs[i], (int)i, 100);
+    }
 
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == i);
+    for (i = 0; i != 100; ++i)
+    {
+        mt_fail(objs[i][0] == i && objs[i][99] == i);
+    }
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    pool_free(&p, objs[42]);
+    pool_free(&p, NULL);
+    mt_fail((o = pool_alloc(&p)) == objs[42]);
 
-        opts_free(argc, argv);
-    }
+    pool_destroy(&p);
+    mt_fail(p.slabs == NULL);
 }
 
 
@@ -1219,7 +1251,1223 @@ void opts_parse_opt_l_bytes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_l_kbytes(void)
+void pool_tiny_and_huge_objects(void)
+{
+    struct pool  p;
+    void        *a;
+    void        *b;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    pool_init(&p, 1, 1024);
+    mt_fail(p.obj_size >= sizeof(void *));
+    mt_assert(a = pool_alloc(&p));
+    mt_assert(b = pool_alloc(&p));
+    mt_fail(a != b);
+    pool_destroy(&p);
+
+    pool_init(&p, 4096, 1024);
+    mt_fail(p.per_slab == 1);
+    mt_assert(a = pool_alloc(&p));
+    mt_assert(b = pool_alloc(&p));
+    mt_fail(a != b);
+    memset(a, 0, 4096);
+    memset(b, 0, 4096);
+    pool_destroy(&p);
+}
+
+
+/* ==== stats.c tests ======================================================= */
+
+
+void stats_basic(void)
+{
+    static const double v[] = { 5, 4, 9, 4, 2, 7, 4, 5 };
+
+    struct stats  s;
+    int           i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * 2 4 4 4 5 5 7 9 - mean 5, sample variance 32/7
+     */
+
+    stats_init(&s);
+
+    for (i = 0; i != 8; ++i)
+    {
+        mt_assert(stats_add(&s, v[i]) == 0);
+    }
+
+    stats_compute(&s, 0);
+    mt_fail(s.n == 8);
+    mt_fail(s.used == 8);
+    mt_fail(s.mean == 5);
+    mt_fail(s.median == 4.5);
+    mt_fail(s.stddev > 2.1380 && s.stddev < 2.1381);
+
+    /*
+     * t for 7 degrees of freedom is 2.365
+     */
+
+    mt_fail(s.ci > 2.365 * 2.1380 / sqrt(8));
+    mt_fail(s.ci < 2.365 * 2.1381 / sqrt(8));
+
+    stats_destroy(&s);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void stats_many_samples(void)
+{
+    struct stats  s;
+    int           i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    stats_init(&s);
+
+    for (i = 1000; i != 0; --i)
+    {
+        mt_assert(stats_add(&s, i) == 0);
+    }
+
+    stats_compute(&s, 0);
+    mt_fail(s.n == 1000);
+    mt_fail(s.mean == 500.5);
+    mt_fail(s.median == 500.5);
+    mt_fail(s.ci > 1.96 * s.stddev / sqrt(1000));
+    mt_fail(s.ci < 1.97 * s.stddev / sqrt(1000));
+
+    stats_destroy(&s);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void stats_outliers(void)
+{
+    static const double v[] = { 10, 11, 9, 10, 12, 8, 10, 100, -50 };
+
+    struct stats  s;
+    int           i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    stats_init(&s);
+
+    for (i = 0; i != 9; ++i)
+    {
+        mt_assert(stats_add(&s, v[i]) == 0);
+    }
+
+    stats_compute(&s, 0);
+    mt_fail(s.used == 9);
+
+    stats_compute(&s, 3);
+    mt_fail(s.n == 9);
+    mt_fail(s.used == 7);
+    mt_fail(s.mean == 10);
+    mt_fail(s.median == 10);
+
+    stats_destroy(&s);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void stats_outliers_zero_mad(void)
+{
+    static const double v[] = { 10, 10, 10, 10, 10, 11, 12 };
+
+    struct stats  s;
+    int           i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    stats_init(&s);
+
+    for (i = 0; i != 7; ++i)
+    {
+        mt_assert(stats_add(&s, v[i]) == 0);
+    }
+
+    stats_compute(&s, 3);
+    mt_fail(s.used == 7);
+
+    stats_destroy(&s);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void stats_outliers_all(void)
+{
+    struct stats  s;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * both samples are 1 MAD away from median, and threshold is 0.1 MAD
+     */
+
+    stats_init(&s);
+    mt_assert(stats_add(&s, 10) == 0);
+    mt_assert(stats_add(&s, 20) == 0);
+    stats_compute(&s, 0.1);
+    mt_fail(s.used == 2);
+    mt_fail(s.mean == 15);
+    mt_fail(s.median == 15);
+
+    mt_assert(stats_add(&s, 30) == 0);
+    mt_assert(stats_add(&s, 40) == 0);
+    stats_compute(&s, 0.1);
+    mt_fail(s.used == 2);
+    mt_fail(s.mean == 25);
+
+    stats_destroy(&s);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void stats_empty(void)
+{
+    struct stats  s;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    stats_init(&s);
+    stats_compute(&s, 3);
+    mt_fail(s.used == 0);
+    mt_fail(s.mean == 0);
+    mt_fail(s.ci == 0);
+    mt_fail(stats_done(&s, 100) == 0);
+
+    mt_assert(stats_add(&s, 7) == 0);
+    stats_compute(&s, 3);
+    mt_fail(s.used == 1);
+    mt_fail(s.mean == 7);
+    mt_fail(s.stddev == 0);
+
+    stats_destroy(&s);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void stats_done_test(void)
+{
+    struct stats  s;
+    int           i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    stats_init(&s);
+
+    for (i = 0; i != STATS_MIN_SAMPLES - 1; ++i)
+    {
+        mt_assert(stats_add(&s, 100) == 0);
+    }
+
+    stats_compute(&s, 0);
+    mt_fail(stats_done(&s, 1) == 0);
+
+    mt_assert(stats_add(&s, 101) == 0);
+    stats_compute(&s, 0);
+    mt_fail(stats_done(&s, 1) == 1);
+    mt_fail(stats_done(&s, 0.01) == 0);
+
+    stats_destroy(&s);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void stats_next_test(void)
+{
+    struct stats  s[2];
+    unsigned long i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    stats_init(&s[0]);
+    stats_init(&s[1]);
+
+    opts.warmup = 2;
+    opts.num_intvl = 3;
+    opts.ci_target = 0;
+
+    for (i = 0; stats_next(s, 2, i); ++i)
+    {
+        mt_fail(stats_warmup(i) == (i < 2));
+    }
+
+    mt_fail(i == 5);
+
+    /*
+     * adaptive mode stops as soon as every measured configuration  is
+     * precise enough, configuration without samples is ignored
+     */
+
+    opts.warmup = 1;
+    opts.num_intvl = 100;
+    opts.ci_target = 1;
+
+    for (i = 0; stats_next(s, 2, i); ++i)
+    {
+        if (!stats_warmup(i))
+        {
+            mt_assert(stats_add(&s[0], 1000 + i % 2) == 0);
+        }
+    }
+
+    mt_fail(i == 1 + STATS_MIN_SAMPLES);
+
+    /*
+     * and never runs more than num_intvl intervals
+     */
+
+    stats_destroy(&s[0]);
+    stats_init(&s[0]);
+    opts.num_intvl = 10;
+
+    for (i = 0; stats_next(s, 2, i); ++i)
+    {
+        mt_assert(stats_add(&s[0], i % 2 ? 1 : 1000) == 0);
+    }
+
+    mt_fail(i == 11);
+
+    stats_destroy(&s[0]);
+    stats_destroy(&s[1]);
+    opts.warmup = 0;
+    opts.num_intvl = 10;
+    opts.ci_target = 0;
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void stats_welch_test(void)
+{
+    struct stats  s;
+    int           i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    stats_init(&s);
+
+    for (i = 0; i != 10; ++i)
+    {
+        mt_assert(stats_add(&s, 100 + i % 2) == 0);
+    }
+
+    stats_compute(&s, 0);
+
+    /*
+     * mean 100.5 stddev ~0.53, same distribution is not different, shift
+     * by couple of standard errors is
+     */
+
+    mt_fail(stats_welch(&s, 100.5, s.stddev, 10) == 0);
+    mt_fail(stats_welch(&s, 100.6, 0.5, 10) == 0);
+    mt_fail(stats_welch(&s, 102, 0.5, 10) == 1);
+    mt_fail(stats_welch(&s, 99, 0.5, 10) == 1);
+
+    /*
+     * without variance of other side, difference can't be tested
+     */
+
+    mt_fail(stats_welch(&s, 100.5, 0, 1) == 1);
+
+    stats_destroy(&s);
+}
+
+
+/* ==========================================================================
+    writes 'content' to file 'path'
+   ========================================================================== */
+
+
+static void base_write
+(
+    const char  *path,    /* file to write */
+    const char  *content  /* content of the file */
+)
+{
+    FILE        *f;       /* file to write */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    f = fopen(path, "w");
+    fputs(content, f);
+    fclose(f);
+}
+
+
+/* ==========================================================================
+    fills 's' with 10 samples around 'mean'
+   ========================================================================== */
+
+
+static void base_samples
+(
+    struct stats  *s,     /* stats to fill */
+    double         mean   /* mean of samples */
+)
+{
+    int            i;     /* iterator for loop */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    stats_init(s);
+
+    for (i = 0; i != 10; ++i)
+    {
+        stats_add(s, mean - 5 + i);
+    }
+
+    stats_compute(s, 0);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void base_csv(void)
+{
+    char          **argv;
+    int             argc;
+    struct stats    s;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("", &argc);
+    opts_parse(argc, argv);
+
+    base_write("base-test.csv",
+        "record,test,method,clock,block_size,report_size,cache_size,"
+        "threads,dist,name,unit,mean,stddev,samples\n"
+        "\"summary\",\"copy\",\"memcpy\",\"tsc\",16384,104857600,1048576,"
+        "1,\"uniform\",\"memcpy\",\"MB/s\",1000,3,10\n"
+        "\"summary\",\"copy\",\"memcpy\",\"tsc\",16384,104857600,1048576,"
+        "1,\"uniform\",\"a \"\"b\"\", c\",\"MB/s\",1000,3,10\n");
+
+    mt_assert(base_load("base-test.csv") == 0);
+    mt_fail(base_status(0) == 1);
+
+    /*
+     * same rate, nothing changed
+     */
+
+    base_samples(&s, 1000);
+    base_compare(&s, "memcpy", "MB/s");
+    mt_fail(base_status(0) == 0);
+    mt_fail(base_status(-1) == 1);
+    stats_destroy(&s);
+
+    /*
+     * rate dropped by 2%, which is significant but within threshold
+     */
+
+    base_samples(&s, 980);
+    base_compare(&s, "memcpy", "MB/s");
+    mt_fail(base_status(0) == 0);
+    stats_destroy(&s);
+
+    /*
+     * higher rate is improvement, not regression
+     */
+
+    base_samples(&s, 1200);
+    base_compare(&s, "a \"b\", c", "MB/s");
+    mt_fail(base_status(0) == 0);
+    stats_destroy(&s);
+
+    /*
+     * lower rate by 20% is regression
+     */
+
+    base_samples(&s, 800);
+    base_compare(&s, "a \"b\", c", "MB/s");
+    mt_fail(base_status(0) == BASE_EXIT_REGRESSION);
+    stats_destroy(&s);
+
+    base_destroy();
+    remove("base-test.csv");
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void base_json(void)
+{
+    char          **argv;
+    int             argc;
+    struct stats    s;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-tgrow -g10", &argc);
+    opts_parse(argc, argv);
+
+    base_write("base-test.json",
+        "[\n"
+        "  {\"record\": \"interval\", \"test\": \"grow\"},\n"
+        "  {\"record\": \"summary\", \"test\": \"grow\", "
+        "\"method\": \"memcpy\", \"clock\": \"realtime\", "
+        "\"block_size\": 16384, \"report_size\": 104857600, "
+        "\"cache_size\": 1048576, \"threads\": 1, \"dist\": \"uniform\", "
+        "\"name\": \"re\\\"alloc\", \"unit\": \"us\", \"mean\": 100, "
+        "\"stddev\": 1, \"samples\": 10},\n"
+        "  {\"record\": \"summary\", \"test\": \"grow\", "
+        "\"method\": \"memcpy\", \"clock\": \"realtime\", "
+        "\"block_size\": 16384, \"report_size\": 104857600, "
+        "\"cache_size\": 1048576, \"threads\": 1, \"dist\": \"uniform\", "
+        "\"name\": \"a\\tb\\u0001\", \"unit\": \"us\", \"mean\": 100, "
+        "\"stddev\": 1, \"samples\": 10}\n"
+        "]\n");
+
+    mt_assert(base_load("base-test.json") == 0);
+
+    /*
+     * configuration that is not in baseline is not compared
+     */
+
+    base_samples(&s, 500);
+    base_compare(&s, "mremap", "us");
+    mt_fail(base_status(0) == 1);
+    stats_destroy(&s);
+
+    /*
+     * time went up by 5%, below -g10 threshold
+     */
+
+    base_samples(&s, 105);
+    base_compare(&s, "re\"alloc", "us");
+    mt_fail(base_status(0) == 0);
+    stats_destroy(&s);
+
+    /*
+     * and now by 50%, lower time is better, so this is regression
+     */
+
+    base_samples(&s, 150);
+    base_compare(&s, "re\"alloc", "us");
+    mt_fail(base_status(0) == BASE_EXIT_REGRESSION);
+    stats_destroy(&s);
+
+    /*
+     * escaped control characters are decoded
+     */
+
+    base_samples(&s, 150);
+    base_compare(&s, "a\tb\001", "us");
+    mt_fail(base_status(0) == BASE_EXIT_REGRESSION);
+    stats_destroy(&s);
+
+    base_destroy();
+    remove("base-test.json");
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void base_no_file(void)
+{
+    mt_fail(base_load("/nonexistent/base-test.csv") == -1);
+    base_write("base-test.csv", "record,test\n\"interval\",\"copy\"\n");
+    mt_fail(base_load("base-test.csv") == -1);
+    mt_fail(base_status(0) == 0);
+    remove("base-test.csv");
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+/* ==== out.c tests ========================================================= */
+
+
+void out_escape_test(void)
+{
+    char    esc[OUT_ESCAPE_MAX];
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-ojson", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+
+    out_escape('a', esc);
+    mt_fail(strcmp(esc, "a") == 0);
+    out_escape('"', esc);
+    mt_fail(strcmp(esc, "\\\"") == 0);
+    out_escape('\\', esc);
+    mt_fail(strcmp(esc, "\\\\") == 0);
+    out_escape('\n', esc);
+    mt_fail(strcmp(esc, "\\n") == 0);
+    out_escape('\t', esc);
+    mt_fail(strcmp(esc, "\\t") == 0);
+    out_escape('\001', esc);
+    mt_fail(strcmp(esc, "\\u0001") == 0);
+    out_escape('\037', esc);
+    mt_fail(strcmp(esc, "\\u001f") == 0);
+    out_escape((char)0xc5, esc);
+    mt_fail(esc[0] == (char)0xc5 && esc[1] == '\0');
+    opts_free(argc, argv);
+
+    /*
+     * csv only doubles quotes
+     */
+
+    argv = str2opts("-ocsv", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+
+    out_escape('"', esc);
+    mt_fail(strcmp(esc, "\"\"") == 0);
+    out_escape('\\', esc);
+    mt_fail(strcmp(esc, "\\") == 0);
+    out_escape('\n', esc);
+    mt_fail(strcmp(esc, "\n") == 0);
+    opts_free(argc, argv);
+}
+
+
+/* ==== opts.c tests ======================================================== */
+
+
+void opts_parse_default_all(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("", &argc);
+    opts_parse(argc, argv);
+
+    mt_fail(opts.block_size == 16 * 1024);
+    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+    mt_fail(opts.num_intvl == 10);
+    mt_fail(opts.method == METHOD_MEMCPY);
+    mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    mt_fail(opts.test == TEST_COPY);
+    mt_fail(opts.dist == DIST_UNIFORM);
+    mt_fail(opts.threads == 1);
+    mt_fail(opts.warmup == 0);
+    mt_fail(opts.outlier_mad == 0);
+    mt_fail(opts.ci_target == 0);
+    mt_fail(opts.output == OUT_TEXT);
+    mt_fail(opts.intensity == 4);
+    mt_fail(opts.replay == NULL);
+
+#if HAVE_CLOCK_GETTIME
+    mt_fail(opts.clock == CLK_REALTIME);
+#else
+    mt_fail(opts.clock == CLK_CLOCK);
+#endif
+
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_b_invalid_prefixes(void)
+{
+    char  **argv;
+    int     argc;
+    char    c;
+    char    param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = 'A'; c != 'Z' + 1; ++c)
+    {
+        sprintf(param, "-b1%c", c);
+        argv = str2opts(param, &argc);
+
+        if (c == 'G' || c == 'M' || c == 'K')
+        {
+            mt_fail(opts_parse(argc, argv) == 0);
+        }
+        else
+        {
+            mt_fail(opts_parse(argc, argv) == -2);
+        }
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_b_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-banan", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+
+
+    argv = str2opts("-b", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_b_bytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-b%lu", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == i);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_b_kbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000 ; i <<= 1)
+    {
+        sprintf(param, "-b%luK", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == i * 1024l);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_b_mbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-b%luM", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == i * 1024l * 1024);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_b_gbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-b%luG", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == i * 1024l * 1024 * 1024);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_r_invalid_prefixes(void)
+{
+    char  **argv;
+    int     argc;
+    char    c;
+    char    param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = 'A'; c != 'Z' + 1; ++c)
+    {
+        sprintf(param, "-r1%c", c);
+        argv = str2opts(param, &argc);
+
+        if (c == 'G' || c == 'M' || c == 'K')
+        {
+            mt_fail(opts_parse(argc, argv) == 0);
+        }
+        else
+        {
+            mt_fail(opts_parse(argc, argv) == -2);
+        }
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_r_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-ranan", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+
+
+    argv = str2opts("-r", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_r_bytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-r%lu", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == i);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_r_kbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000 ; i <<= 1)
+    {
+        sprintf(param, "-r%luK", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == i * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_r_mbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-r%luM", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == i * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_r_gbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-r%luG", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == i * 1024 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_l_invalid_prefixes(void)
+{
+    char  **argv;
+    int     argc;
+    char    c;
+    char    param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = 'A'; c != 'Z' + 1; ++c)
+    {
+        sprintf(param, "-l1%c", c);
+        argv = str2opts(param, &argc);
+
+        if (c == 'G' || c == 'M' || c == 'K')
+        {
+            mt_fail(opts_parse(argc, argv) == 0);
+        }
+        else
+        {
+            mt_fail(opts_parse(argc, argv) == -2);
+        }
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_l_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-lanan", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+
+    argv = str2opts("-l", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_l_bytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-l%lu", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == i);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_l_kbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000 ; i <<= 1)
+    {
+        sprintf(param, "-l%luK", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == i * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_l_mbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-l%luM", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == i * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_l_gbytes(void)
+{
+    char         **argv;
+    int            argc;
+    unsigned long  i;
+    char           param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-l%luG", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == 10);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == i * 1024 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_i(void)
 {
     char         **argv;
     int            argc;
@@ -1227,26 +2475,1451 @@ void opts_parse_opt_l_kbytes(void)
     char           param[16];
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000 ; i <<= 1)
+    for (i = 1; i < 1000000; i <<= 1)
+    {
+        sprintf(param, "-i%lu", i);
+        argv = str2opts(param, &argc);
+        opts_parse(argc, argv);
+
+        mt_fail(opts.block_size == 16 * 1024);
+        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+        mt_fail(opts.num_intvl == i);
+        mt_fail(opts.method == METHOD_MEMCPY);
+        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+    #if HAVE_CLOCK_GETTIME
+        mt_fail(opts.clock == CLK_REALTIME);
+    #else
+        mt_fail(opts.clock == CLK_CLOCK);
+    #endif
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_i_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-ianan", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+
+
+    argv = str2opts("-i5K", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+
+
+    argv = str2opts("-i", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_m(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-mmemcpy", &argc);
+    opts_parse(argc, argv);
+
+    mt_fail(opts.block_size == 16 * 1024);
+    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+    mt_fail(opts.num_intvl == 10);
+    mt_fail(opts.method == METHOD_MEMCPY);
+    mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+#if HAVE_CLOCK_GETTIME
+    mt_fail(opts.clock == CLK_REALTIME);
+#else
+    mt_fail(opts.clock == CLK_CLOCK);
+#endif
+
+    opts_free(argc, argv);
+
+
+    argv = str2opts("-mbbb", &argc);
+    opts_parse(argc, argv);
+
+    mt_fail(opts.block_size == 16 * 1024);
+    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+    mt_fail(opts.num_intvl == 10);
+    mt_fail(opts.method == METHOD_BBB);
+    mt_fail(opts.cache_size == 1 * 1024 * 1024);
+
+#if HAVE_CLOCK_GETTIME
+    mt_fail(opts.clock == CLK_REALTIME);
+#else
+    mt_fail(opts.clock == CLK_CLOCK);
+#endif
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_m_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-manan", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+
+
+    argv = str2opts("-m", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_c(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-cclock", &argc);
+    opts_parse(argc, argv);
+
+    mt_fail(opts.block_size == 16 * 1024);
+    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+    mt_fail(opts.num_intvl == 10);
+    mt_fail(opts.method == METHOD_MEMCPY);
+    mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    mt_fail(opts.clock == CLK_CLOCK);
+
+    opts_free(argc, argv);
+
+#if HAVE_CLOCK_GETTIME
+    argv = str2opts("-crealtime", &argc);
+    opts_parse(argc, argv);
+
+    mt_fail(opts.block_size == 16 * 1024);
+    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
+    mt_fail(opts.num_intvl == 10);
+    mt_fail(opts.method == METHOD_MEMCPY);
+    mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    mt_fail(opts.clock == CLK_REALTIME);
+
+    opts_free(argc, argv);
+#endif
+
+#if HAVE_CLOCK_GETTIME && HAVE_DECL_CLOCK_MONOTONIC_RAW
+    argv = str2opts("-cmonotonic_raw", &argc);
+    opts_parse(argc, argv);
+
+    mt_fail(opts.clock == CLK_MONOTONIC_RAW);
+
+    opts_free(argc, argv);
+#endif
+
+#if HAVE_RDTSC
+    argv = str2opts("-ctsc", &argc);
+    opts_parse(argc, argv);
+
+    mt_fail(opts.clock == CLK_TSC);
+
+    opts_free(argc, argv);
+#endif
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_c_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-canan", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+
+
+    argv = str2opts("-c", &argc);
+
+    mt_fail(opts_parse(argc, argv) == -2);
+
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_t(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-talloc", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_ALLOC);
+    mt_fail(opts.method == METHOD_MEMCPY);
+    mt_fail(opts.block_size == 16 * 1024);
+    opts_free(argc, argv);
+
+    argv = str2opts("-tgrow", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_GROW);
+    opts_free(argc, argv);
+
+    argv = str2opts("-tzero", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_ZERO);
+    opts_free(argc, argv);
+
+    argv = str2opts("-toverlap", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_OVERLAP);
+    opts_free(argc, argv);
+
+    argv = str2opts("-troofline", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_ROOFLINE);
+    opts_free(argc, argv);
+
+    argv = str2opts("-tsmall", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_SMALL);
+    opts_free(argc, argv);
+
+    argv = str2opts("-treplay", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_REPLAY);
+    opts_free(argc, argv);
+
+#if HAVE_CLFLUSH
+    argv = str2opts("-tflush", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_FLUSH);
+    opts_free(argc, argv);
+#endif
+
+#if HAVE_PTHREAD_H
+    argv = str2opts("-tloaded", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_LOADED);
+    opts_free(argc, argv);
+
+    argv = str2opts("-tscale", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_SCALE);
+    opts_free(argc, argv);
+
+    argv = str2opts("-tpcopy", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_PCOPY);
+    opts_free(argc, argv);
+#endif
+
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+    argv = str2opts("-tatomic", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_ATOMIC);
+    opts_free(argc, argv);
+#endif
+
+#if HAVE_FORK
+    argv = str2opts("-tneighbour", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_NEIGHBOUR);
+    opts_free(argc, argv);
+#endif
+
+    argv = str2opts("-tcopy", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.test == TEST_COPY);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_t_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-tanan", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-t", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_d(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-dfixed", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.dist == DIST_FIXED);
+    opts_free(argc, argv);
+
+    argv = str2opts("-duniform", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.dist == DIST_UNIFORM);
+    opts_free(argc, argv);
+
+    argv = str2opts("-dpow2", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.dist == DIST_POW2);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_d_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-danan", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-d", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_n(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-n8", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.threads == 8);
+    mt_fail(opts.threads_set == 1);
+    mt_fail(opts.num_intvl == 10);
+    opts_free(argc, argv);
+
+    argv = str2opts("-b1024", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.threads == 1);
+    mt_fail(opts.threads_set == 0);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_n_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-n4a", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-n0", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-n", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_w(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-w3", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.warmup == 3);
+    opts_free(argc, argv);
+
+    argv = str2opts("-w0", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.warmup == 0);
+    opts_free(argc, argv);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_w_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-w1x", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-w-1", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-w", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_e_p(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-e3.5 -p0.5", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.outlier_mad == 3.5);
+    mt_fail(opts.ci_target == 0.5);
+    opts_free(argc, argv);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_e_p_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-e3x", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-p-1", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-p", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_o(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-ocsv", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.output == OUT_CSV);
+    mt_fail(out_text() == 0);
+    opts_free(argc, argv);
+
+    argv = str2opts("-ojson", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.output == OUT_JSON);
+    mt_fail(out_text() == 0);
+    opts_free(argc, argv);
+
+    argv = str2opts("-otext", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.output == OUT_TEXT);
+    mt_fail(out_text() == 1);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_o_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-oxml", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-o", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_f_g(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.baseline == NULL);
+    mt_fail(opts.regress == 5);
+    opts_free(argc, argv);
+
+    argv = str2opts("-fbase.json -g2.5", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(strcmp(opts.baseline, "base.json") == 0);
+    mt_fail(opts.regress == 2.5);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_f_g_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-f", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-g", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-g-1", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-gfive", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_k(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.counters == CNT_NONE);
+    opts_free(argc, argv);
+
+    argv = str2opts("-khw", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.counters == CNT_HW);
+    opts_free(argc, argv);
+
+    argv = str2opts("-ksw", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.counters == CNT_SW);
+    opts_free(argc, argv);
+
+    argv = str2opts("-knone", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.counters == CNT_NONE);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_k_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-kpmu", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-k", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_s(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.noise == NOISE_FLAG);
+    opts_free(argc, argv);
+
+    argv = str2opts("-soff", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.noise == NOISE_OFF);
+    opts_free(argc, argv);
+
+    argv = str2opts("-sdiscard", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.noise == NOISE_DISCARD);
+    opts_free(argc, argv);
+
+    argv = str2opts("-sflag", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.noise == NOISE_FLAG);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_s_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-sdrop", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-s", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_q(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.quiet == 0);
+    opts_free(argc, argv);
+
+    argv = str2opts("-q", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.quiet == 1);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_a(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.place == PLACE_ANY);
+    opts_free(argc, argv);
+
+    argv = str2opts("-aother", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.place == PLACE_OTHER);
+    opts_free(argc, argv);
+
+    argv = str2opts("-aany", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.place == PLACE_ANY);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_a_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-anode", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-a", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_x(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-x16", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.intensity == 16);
+    opts_free(argc, argv);
+
+    argv = str2opts("-x0", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(opts.intensity == 0);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_x_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-x4a", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-x-1", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+
+    argv = str2opts("-x", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_u(void)
+{
+    char **argv;
+    int    argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-treplay -uhist.txt", &argc);
+    mt_fail(opts_parse(argc, argv) == 0);
+    mt_fail(strcmp(opts.replay, "hist.txt") == 0);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_opt_u_invalid_param(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-u", &argc);
+    mt_fail(opts_parse(argc, argv) == -2);
+    opts_free(argc, argv);
+}
+
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void pmc_none(void)
+{
+    struct pmc  p;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    mt_fail(pmc_open(&p, CNT_NONE) == 0);
+    mt_fail(p.n == 0);
+    pmc_reset(&p);
+    pmc_enable(&p);
+    pmc_disable(&p);
+    mt_fail(pmc_read(&p) == -1);
+    pmc_close(&p);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void pmc_sw_events(void)
+{
+    struct pmc      p;
+    volatile long   x;
+    long            i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (pmc_open(&p, CNT_SW) != 0)
+    {
+        /*
+         * perf events not available on this system, nothing to test
+         */
+
+        return;
+    }
+
+    mt_fail(p.sw == 1);
+    mt_fail(strcmp(p.name[0], "task_clock_ns") == 0);
+
+    pmc_reset(&p);
+    pmc_enable(&p);
+
+    for (x = 0, i = 0; i != 10000000; ++i)
+    {
+        x += i;
+    }
+
+    pmc_disable(&p);
+    mt_fail(pmc_read(&p) == 0);
+    mt_fail(p.val[0] > 0);
+
+    /*
+     * disabled counters don't count
+     */
+
+    pmc_reset(&p);
+    mt_fail(pmc_read(&p) == 0);
+    mt_fail(p.val[0] == 0);
+
+    pmc_close(&p);
+    mt_fail(p.n == 0);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void freq_fallback(void)
+{
+    struct freq  f;
+    struct pmc   p;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    freq_open(&f);
+    mt_fail(f.hz == 0);
+    mt_fail(strcmp(f.source, "none") == 0);
+
+    /*
+     * msr is never valid when interval was not started with freq_begin()
+     */
+
+    memset(&p, 0, sizeof(p));
+    p.n = 1;
+    p.val[0] = 3000000000.0;
+    freq_end(&f, 1.5, &p);
+    mt_fail(f.hz == 2000000000.0);
+    mt_fail(strcmp(f.source, "pmc") == 0);
+
+    /*
+     * software counters have no cycles
+     */
+
+    p.sw = 1;
+    freq_end(&f, 1.5, &p);
+    mt_fail(f.hz == ts_tsc_hz());
+    mt_fail(strcmp(f.source, ts_tsc_hz() > 0 ? "tsc" : "none") == 0);
+
+    freq_end(&f, 1.5, NULL);
+    mt_fail(f.hz == ts_tsc_hz());
+    freq_close(&f);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void freq_interval(void)
+{
+    struct freq     f;
+    volatile long   x;
+    long            i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    freq_open(&f);
+    freq_begin(&f);
+
+    for (x = 0, i = 0; i != 1000000; ++i)
+    {
+        x += i;
+    }
+
+    freq_end(&f, 0.001, NULL);
+
+    /*
+     * whatever source was available, it must give sane frequency
+     */
+
+    if (strcmp(f.source, "none") != 0)
+    {
+        mt_fail(f.hz > 1000000);
+        mt_fail(f.hz < 100000000000.0);
+    }
+
+    freq_close(&f);
+    mt_fail(f.fd == -1);
+}
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void noise_faults(void)
+{
+    struct noise     n;
+    volatile char   *p;
+    size_t           i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * touching fresh memory faults, on every system that has getrusage().
+     * Size is above max mmap threshold of glibc, so memory is never reused
+     * from heap that earlier tests already touched.  Writes are volatile,
+     * so compiler can't move them past noise_end()
+     */
+
+    mt_assert(p = malloc(64 * 1024 * 1024));
+    noise_begin(&n);
+
+    for (i = 0; i < 64 * 1024 * 1024; i += 4096)
+    {
+        p[i] = 0x55;
+    }
+
+    noise_end(&n);
+    free((void *)p);
+
+#if HAVE_GETRUSAGE
+    mt_fail(n.noisy == 1);
+    mt_fail(n.delta.minflt + n.delta.majflt > 0);
+#endif
+
+    mt_fail(n.delta.migrations >= 0);
+    mt_fail(n.delta.run_delay >= 0);
+}
+
+
+
+
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void quiet_irqs_parse(void)
+{
+    unsigned long  irqs[8];
+    FILE          *f;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * cpu 2 is offline, so there is no column for it, ERR has just  one
+     * count, and irq lines end with names that must not be summed
+     */
+
+    mt_assert(f = tmpfile());
+    fputs("           CPU0       CPU1       CPU3\n"
+          "  0:         10          0          5   IO-APIC   2-edge  timer\n"
+          " 24:          1        200          3   PCI-MSI 1-edge  eth0\n"
+          "NMI:          4          4          4   Non-maskable interrupts\n"
+          "ERR:          7\n", f);
+    rewind(f);
+
+    mt_fail(quiet_irqs(f, irqs, 8) == 4);
+    mt_fail(irqs[0] == 22);
+    mt_fail(irqs[1] == 204);
+    mt_fail(irqs[2] == 0);
+    mt_fail(irqs[3] == 12);
+
+    /*
+     * cpus that don't fit into 'irqs' are ignored
+     */
+
+    rewind(f);
+    mt_fail(quiet_irqs(f, irqs, 2) == 2);
+    mt_fail(irqs[0] == 22);
+    mt_fail(irqs[1] == 204);
+    fclose(f);
+
+    mt_assert(f = tmpfile());
+    mt_fail(quiet_irqs(f, irqs, 8) == 0);
+    fclose(f);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void quiet_pick_test(void)
+{
+    static const unsigned long  irqs[] = { 50, 10, 0, 30, 20 };
+    static const int            allowed[] = { 1, 1, 0, 1, 1 };
+    int                         cpus[5];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    mt_fail(quiet_pick(irqs, allowed, 5, 1, cpus) == 1);
+    mt_fail(cpus[0] == 1);
+
+    mt_fail(quiet_pick(irqs, allowed, 5, 3, cpus) == 3);
+    mt_fail(cpus[0] == 1);
+    mt_fail(cpus[1] == 4);
+    mt_fail(cpus[2] == 3);
+
+    /*
+     * cpu 2 has the fewest irqs, but we are not allowed to run there
+     */
+
+    mt_fail(quiet_pick(irqs, allowed, 5, 8, cpus) == 4);
+    mt_fail(cpus[3] == 0);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void replay_parse_valid(void)
+{
+    struct replay_bucket  *b;
+    size_t                 n;
+    FILE                  *f;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * comments, blank lines and commas are allowed, count may be 0
+     */
+
+    mt_assert(f = tmpfile());
+    fputs("# size align count\n"
+          "64 8 1000\n"
+          "\n"
+          "  128,16,  250   # tail\n"
+          "4096 64 0\r\n", f);
+    rewind(f);
+
+    mt_fail(replay_parse(f, &b, &n) == 0);
+    mt_assert(n == 3);
+    mt_fail(b[0].size == 64);
+    mt_fail(b[0].align == 8);
+    mt_fail(b[0].count == 1000);
+    mt_fail(b[1].size == 128);
+    mt_fail(b[1].align == 16);
+    mt_fail(b[1].count == 250);
+    mt_fail(b[2].size == 4096);
+    mt_fail(b[2].align == 64);
+    mt_fail(b[2].count == 0);
+    free(b);
+    fclose(f);
+
+    mt_assert(f = tmpfile());
+    mt_fail(replay_parse(f, &b, &n) == 0);
+    mt_fail(n == 0);
+    mt_fail(b == NULL);
+    fclose(f);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void replay_parse_invalid(void)
+{
+    static const char  *lines[] =
+    {
+        "64 8\n",           /* no count */
+        "64 3 10\n",        /* alignment not power of 2 */
+        "0 8 10\n",         /* size 0 */
+        "64 8 10 5\n",      /* extra field */
+        "64 8 -10\n",       /* negative count */
+        "64 8 ten\n"        /* not a number */
+    };
+
+    struct replay_bucket  *b;
+    size_t                 n;
+    size_t                 i;
+    FILE                  *f;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (i = 0; i != sizeof(lines) / sizeof(*lines); ++i)
+    {
+        mt_assert(f = tmpfile());
+        fputs("64 8 1000\n", f);
+        fputs(lines[i], f);
+        rewind(f);
+
+        mt_fail(replay_parse(f, &b, &n) == -2);
+        mt_fail(b == NULL);
+        mt_fail(n == 0);
+        fclose(f);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_unknown_opts(void)
+{
+    static const char *allowed_opts = "hvbrlimctdnwepofgksqaxu";
+
+    char  **argv;
+    int     argc;
+    char    c;
+    char    param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = 'a'; c != 'z' + 1; ++c)
+    {
+        sprintf(param, "-%c", c);
+        argv = str2opts(param, &argc);
+
+        if (is_in_array(c, allowed_opts))
+        {
+            mt_fail(opts_parse(argc, argv) != -3);
+        }
+        else
+        {
+            mt_fail(opts_parse(argc, argv) == -3);
+        }
+
+        opts_free(argc, argv);
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void opts_parse_syntax_error(void)
+{
+    char  **argv;
+    int     argc;
+    char    c;
+    char    param[16];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (c = 'A'; c != 'Z' + 1; ++c)
+    {
+        sprintf(param, "-%c", c);
+        argv = str2opts(param, &argc);
+
+        mt_fail(opts_parse(argc, argv) == -1);
+
+        opts_free(argc, argv);
+    }
+
+    argv = str2opts("banan", &argc);
+    mt_fail(opts_parse(argc, argv) == -1);
+    opts_free(argc, argv);
+
+    argv = str2opts("-", &argc);
+    mt_fail(opts_parse(argc, argv) == -1);
+    opts_free(argc, argv);
+
+    argv = str2opts("--", &argc);
+    mt_fail(opts_parse(argc, argv) == -1);
+    opts_free(argc, argv);
+
+    argv = str2opts("-10b", &argc);
+    mt_fail(opts_parse(argc, argv) == -1);
+    opts_free(argc, argv);
+}
+
+
+/* ==== tracehist.c tests =================================================== */
+
+
+void tracehist_bucket_bounds(void)
+{
+    /*
+     * sizes up to 256 are exact, then there are 4 buckets per power of 2
+     */
+
+    mt_fail(tracehist_bucket(0) == 0);
+    mt_fail(tracehist_bucket(1) == 1);
+    mt_fail(tracehist_bucket(MEMTRACE_EXACT) == MEMTRACE_EXACT);
+    mt_fail(tracehist_bucket(257) == MEMTRACE_EXACT + 1);
+    mt_fail(tracehist_bucket(319) == MEMTRACE_EXACT + 1);
+    mt_fail(tracehist_bucket(320) == MEMTRACE_EXACT + 2);
+    mt_fail(tracehist_bucket(511) == MEMTRACE_EXACT + MEMTRACE_SUBS);
+    mt_fail(tracehist_bucket(512) == MEMTRACE_EXACT + MEMTRACE_SUBS + 1);
+    mt_fail(tracehist_bucket((size_t)-1) < MEMTRACE_SIZES);
+
+    mt_fail(tracehist_size(MEMTRACE_EXACT) == MEMTRACE_EXACT);
+    mt_fail(tracehist_size(MEMTRACE_EXACT + 2) == 320);
+    mt_fail(tracehist_size(MEMTRACE_EXACT + MEMTRACE_SUBS + 1) == 512);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void tracehist_bucket_all_bits(void)
+{
+    size_t  n;
+    size_t  b;
+    size_t  k;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * every power of 2 that fits in size_t, and the size right below it,
+     * must land in existing bucket that starts at or below the size,
+     * whatever width size_t has
+     */
+
+    for (k = 0; k != sizeof(size_t) * CHAR_BIT; ++k)
+    {
+        n = (size_t)1 << k;
+        b = tracehist_bucket(n);
+        mt_assert(b < MEMTRACE_SIZES);
+        mt_fail(tracehist_size(b) <= (double)n);
+
+        b = tracehist_bucket(n - 1 + n);
+        mt_assert(b < MEMTRACE_SIZES);
+        mt_fail(tracehist_size(b) <= (double)(n - 1 + n));
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void tracehist_bucket_monotonic(void)
+{
+    size_t  prev;
+    size_t  n;
+    size_t  b;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    prev = 0;
+
+    for (n = 0; n < 1024 * 1024; n += 1 + n / 64)
+    {
+        b = tracehist_bucket(n);
+        mt_fail(b >= prev);
+        mt_fail(tracehist_size(b) <= (double)n);
+        prev = b;
+
+        /*
+         * first bucket above exact ones starts at 256, like the last exact
+         */
+
+        if (b != MEMTRACE_EXACT && b + 1 != MEMTRACE_SIZES)
+        {
+            mt_fail(tracehist_size(b + 1) > n);
+        }
+    }
+
+    /*
+     * lower bound of every bucket falls back into it, except for first one
+     * above exact buckets
+     */
+
+    for (b = MEMTRACE_EXACT + 2; b != MEMTRACE_SIZES; ++b)
+    {
+        if (tracehist_size(b) < (double)(size_t)-1)
+        {
+            mt_fail(tracehist_bucket((size_t)tracehist_size(b)) == b);
+        }
+    }
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void tracehist_align_classes(void)
+{
+    mt_fail(tracehist_align(1) == 0);
+    mt_fail(tracehist_align(3) == 0);
+    mt_fail(tracehist_align(2) == 1);
+    mt_fail(tracehist_align(48) == 4);
+    mt_fail(tracehist_align(64) == MEMTRACE_ALIGNS - 1);
+    mt_fail(tracehist_align(4096) == MEMTRACE_ALIGNS - 1);
+    mt_fail(tracehist_align(0) == MEMTRACE_ALIGNS - 1);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void tracehist_line_replay(void)
+{
+    static const size_t    sizes[] = { 1, 256, 300, 4096, 100000 };
+    char                   line[TRACEHIST_LINE_MAX];
+    struct replay_bucket  *rb;
+    size_t                 n;
+    size_t                 i;
+    FILE                  *f;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * lines of memtrace report must be readable by memperf -treplay -u,
+     * with comments around them
+     */
+
+    mt_assert(f = tmpfile());
+    fputs("# memtrace of pid 1, 1 threads, 0.001 s\n", f);
+
+    for (i = 0; i != sizeof(sizes) / sizeof(*sizes); ++i)
     {
-        sprintf(param, "-l%luK", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+        mt_fail(tracehist_line(line, tracehist_bucket(sizes[i]),
+                               (int)i % MEMTRACE_ALIGNS, 10 + i) <
+                TRACEHIST_LINE_MAX);
+        fputs(line, f);
+    }
 
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == i * 1024);
+    fputs("# memset as size, alignment and count\n# ", f);
+    tracehist_line(line, 8, 3, 5);
+    fputs(line, f);
+    rewind(f);
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    mt_assert(replay_parse(f, &rb, &n) == 0);
+    mt_assert(n == sizeof(sizes) / sizeof(*sizes));
 
-        opts_free(argc, argv);
+    for (i = 0; i != n; ++i)
+    {
+        mt_fail(rb[i].size ==
+                (size_t)tracehist_size(tracehist_bucket(sizes[i])));
+        mt_fail(rb[i].align == (size_t)1 << (i % MEMTRACE_ALIGNS));
+        mt_fail(rb[i].count == 10 + i);
     }
+
+    free(rb);
+    fclose(f);
+}
+
+
+/* ==== roofline.c tests ==================================================== */
+
+
+void roofline_flops_test(void)
+{
+    /*
+     * every round is multiply and add, and element is summed up once
+     */
+
+    mt_fail(roofline_flops(0) == 1);
+    mt_fail(roofline_flops(1) == 3);
+    mt_fail(roofline_flops(ROOFLINE_ROUNDS_MAX) ==
+            2.0 * ROOFLINE_ROUNDS_MAX + 1);
 }
 
 
@@ -1254,69 +3927,398 @@ void opts_parse_opt_l_kbytes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_l_mbytes(void)
+void roofline_sweep_test(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    unsigned long  rounds[64];
+    size_t         n;
+    size_t         i;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000; i <<= 1)
+    /*
+     * 0, and powers of 2 up to ROOFLINE_ROUNDS_MAX, which is 2^8
+     */
+
+    n = roofline_sweep(NULL);
+    mt_assert(n == 10);
+    mt_assert(roofline_sweep(rounds) == n);
+    mt_fail(rounds[0] == 0);
+
+    for (i = 1; i != n; ++i)
     {
-        sprintf(param, "-l%luM", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+        mt_fail(rounds[i] == (unsigned long)1 << (i - 1));
+    }
 
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == i * 1024 * 1024);
+    mt_fail(rounds[n - 1] == ROOFLINE_ROUNDS_MAX);
+}
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
 
-        opts_free(argc, argv);
+/* ==== small.c tests ======================================================= */
+
+
+void small_shuffle_counts(void)
+{
+    static unsigned short  seq[3 * SMALL_MAX];
+    unsigned               count[SMALL_MAX + 1];
+    size_t                 moved;
+    size_t                 i;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    memset(count, 0, sizeof(count));
+    small_shuffle(seq, 3);
+
+    for (i = 0, moved = 0; i != 3 * SMALL_MAX; ++i)
+    {
+        mt_assert(seq[i] >= 1 && seq[i] <= SMALL_MAX);
+        ++count[seq[i]];
+        moved += seq[i] != i % SMALL_MAX + 1;
+    }
+
+    /*
+     * every size is there exactly 3 times, and they are not  in  order
+     * they were generated in
+     */
+
+    for (i = 1; i <= SMALL_MAX; ++i)
+    {
+        mt_fail(count[i] == 3);
+    }
+
+    mt_fail(moved > SMALL_MAX);
+}
+
+
+/* ==== loaded.c tests ====================================================== */
+
+
+#if HAVE_PTHREAD_H
+
+void loaded_chain_cycle(void)
+{
+    static const size_t    sizes[] = { 1, 2, 3, 100, 4096 };
+    unsigned char         *buf;
+    unsigned char         *seen;
+    void                 **p;
+    size_t                 nlines;
+    size_t                 line;
+    size_t                 i;
+    size_t                 k;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (k = 0; k != sizeof(sizes) / sizeof(*sizes); ++k)
+    {
+        nlines = sizes[k];
+        mt_assert(buf = malloc(nlines * LOADED_LINE));
+        mt_assert(seen = calloc(1, nlines));
+        mt_assert(p = loaded_chain(buf, nlines));
+        mt_fail(p == (void **)buf);
+
+        /*
+         * chase must visit every line once, and only then get back  to
+         * the start, so it is single cycle over whole buffer
+         */
+
+        for (i = 0; i != nlines; ++i)
+        {
+            line = ((unsigned char *)p - buf) / LOADED_LINE;
+            mt_assert(line < nlines);
+            mt_assert((unsigned char *)p == buf + line * LOADED_LINE);
+            mt_fail(seen[line] == 0);
+            seen[line] = 1;
+            p = *p;
+        }
+
+        mt_fail(p == (void **)buf);
+        free(seen);
+        free(buf);
     }
 }
 
+#endif
+
+
+/* ==== scale.c tests ======================================================= */
+
+
+#if HAVE_PTHREAD_H
+
+void scale_counts_test(void)
+{
+    unsigned long  counts[8];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    mt_assert(scale_counts(1, NULL) == 1);
+    mt_fail(scale_counts(1, counts) == 1);
+    mt_fail(counts[0] == 1);
+
+    mt_assert(scale_counts(8, NULL) == 4);
+    mt_fail(scale_counts(8, counts) == 4);
+    mt_fail(counts[0] == 1);
+    mt_fail(counts[1] == 2);
+    mt_fail(counts[2] == 4);
+    mt_fail(counts[3] == 8);
+
+    /*
+     * max that is not power of 2 is the last point
+     */
+
+    mt_assert(scale_counts(6, NULL) == 4);
+    mt_fail(scale_counts(6, counts) == 4);
+    mt_fail(counts[2] == 4);
+    mt_fail(counts[3] == 6);
+}
+
 
 /* ==========================================================================
    ========================================================================== */
 
 
-void opts_parse_opt_l_gbytes(void)
+void scale_knee_test(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    struct stats  s[5];
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000; i <<= 1)
+    memset(s, 0, sizeof(s));
+
+    /*
+     * bandwidth doubles, then grows by 5%, which is below SCALE_KNEE_GAIN
+     */
+
+    s[0].mean = 1000;
+    s[1].mean = 2000;
+    s[2].mean = 4000;
+    s[3].mean = 4200;
+    s[4].mean = 4300;
+    mt_fail(scale_knee(s, 5) == 2);
+
+    /*
+     * drop counts as saturation too
+     */
+
+    s[3].mean = 3000;
+    mt_fail(scale_knee(s, 5) == 2);
+
+    /*
+     * gain of exactly SCALE_KNEE_GAIN is not saturation yet
+     */
+
+    s[1].mean = 1000 * (1 + SCALE_KNEE_GAIN);
+    mt_fail(scale_knee(s, 5) == 2);
+
+    /*
+     * no saturation, and single point
+     */
+
+    s[1].mean = 2000;
+    s[3].mean = 8000;
+    s[4].mean = 16000;
+    mt_fail(scale_knee(s, 5) == 4);
+    mt_fail(scale_knee(s, 1) == 0);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void scale_max_threads_test(void)
+{
+    char  **argv;
+    int     argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * explicit -n1 is not the same as no -n at all
+     */
+
+    argv = str2opts("-n1", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_fail(scale_max_threads() == 1);
+    opts_free(argc, argv);
+
+    argv = str2opts("-n3", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_fail(scale_max_threads() == 3);
+    opts_free(argc, argv);
+
+    argv = str2opts("-b1024", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_fail(scale_max_threads() >= 1);
+    opts_free(argc, argv);
+}
+
+#endif
+
+
+/* ==== pcopy.c tests ======================================================= */
+
+
+#if HAVE_PTHREAD_H
+
+void pcopy_chunks_sweep(void)
+{
+    size_t   chunks[PCOPY_CHUNKS_MAX];
+    size_t   n;
+    char   **argv;
+    int      argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * chunks grow 4 times from PCOPY_CHUNK_MIN, and the last one  gives
+     * every thread single chunk
+     */
+
+    argv = str2opts("-b1048576 -n4", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    n = pcopy_chunks(chunks);
+    mt_assert(n == 4);
+    mt_fail(chunks[0] == 4 * 1024);
+    mt_fail(chunks[1] == 16 * 1024);
+    mt_fail(chunks[2] == 64 * 1024);
+    mt_fail(chunks[3] == 256 * 1024);
+    opts_free(argc, argv);
+
+    /*
+     * even chunk is rounded up, so threads don't leave a tail behind
+     */
+
+    argv = str2opts("-b100000 -n3", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    n = pcopy_chunks(chunks);
+    mt_assert(n == 3);
+    mt_fail(chunks[1] == 16 * 1024);
+    mt_fail(chunks[2] == 33334);
+    opts_free(argc, argv);
+
+    /*
+     * buffer smaller than PCOPY_CHUNK_MIN has only the even chunk
+     */
+
+    argv = str2opts("-b1000 -n2", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_assert(pcopy_chunks(chunks) == 1);
+    mt_fail(chunks[0] == 500);
+    opts_free(argc, argv);
+}
+
+
+/* ==========================================================================
+   ========================================================================== */
+
+
+void pcopy_run_covers_block(void)
+{
+    static const size_t   chunks[] = { 1, 4096, 33334, 100000, 200000 };
+    struct pcopy_pool     pool;
+    struct pcopy_worker   workers[3];
+    pthread_t             tids[3];
+    size_t                block;
+    size_t                i;
+    size_t                k;
+    unsigned long         n;
+    int                   mode;
+    char                **argv;
+    int                   argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    argv = str2opts("-b100000", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    block = opts.block_size;
+
+    memset(&pool, 0, sizeof(pool));
+    pool.tids = tids;
+    mt_assert(pool.src = malloc(block));
+    mt_assert(pool.dst = malloc(block + 1));
+
+    for (i = 0; i != block; ++i)
     {
-        sprintf(param, "-l%luG", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+        pool.src[i] = (unsigned char)(i % 251 + 1);
+    }
 
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == 10);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == i * 1024 * 1024 * 1024);
+    /*
+     * every chunk size, with last chunk shorter, longer than block, or
+     * not at all, with every mode and number of threads must copy whole
+     * block, and nothing past it
+     */
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    for (n = 1; n <= 3; ++n)
+    {
+        mt_assert(pcopy_pool_start(&pool, workers, n) == 0);
 
-        opts_free(argc, argv);
+        for (mode = 0; mode != PCOPY_MODE_MAX; ++mode)
+        {
+            for (k = 0; k != sizeof(chunks) / sizeof(*chunks); ++k)
+            {
+                memset(pool.dst, 0, block + 1);
+                pcopy_chunk(&pool, (enum pcopy_mode)mode, chunks[k]);
+                pcopy_run(&pool);
+
+                mt_fail(memcmp(pool.dst, pool.src, block) == 0);
+                mt_fail(pool.dst[block] == 0);
+            }
+        }
+
+        pcopy_pool_stop(&pool);
+    }
+
+    free(pool.dst);
+    free(pool.src);
+    opts_free(argc, argv);
+}
+
+#endif
+
+
+/* ==== atomic.c tests ====================================================== */
+
+
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+
+void atomic_operand_place(void)
+{
+    unsigned char  *mem;
+    unsigned char  *first;
+    unsigned char  *p;
+    unsigned long   i;
+    size_t          off;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    mt_assert(mem = malloc(8 * ATOMIC_SPREAD + ATOMIC_SPREAD + 3));
+
+    /*
+     * whatever alignment memory has, operands are aligned to spread and
+     * fit in it
+     */
+
+    for (off = 0; off != 4; ++off)
+    {
+        first = atomic_operand(mem + off, 0, 0);
+        mt_fail((size_t)first % ATOMIC_SPREAD == 0);
+        mt_fail(first > mem + off);
+
+        /*
+         * shared operand is the same for all threads
+         */
+
+        for (i = 0; i != 8; ++i)
+        {
+            mt_fail(atomic_operand(mem + off, 0, i) == first);
+        }
+
+        /*
+         * spread ones are each on its own pair of lines, and first thread
+         * still has the shared one
+         */
+
+        for (i = 0; i != 8; ++i)
+        {
+            p = atomic_operand(mem + off, 1, i);
+            mt_fail(p == first + i * ATOMIC_SPREAD);
+            mt_fail(p + sizeof(unsigned long) <=
+                    mem + off + 8 * ATOMIC_SPREAD + ATOMIC_SPREAD);
+        }
     }
+
+    free(mem);
 }
 
 
@@ -1324,112 +4326,195 @@ void opts_parse_opt_l_gbytes(void)
    ========================================================================== */
 
 
-void opts_parse_opt_i(void)
+void atomic_conf_single(void)
 {
-    char         **argv;
-    int            argc;
-    unsigned long  i;
-    char           param[16];
+    size_t  c;
+    size_t  k;
+    int     op;
+    int     place;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (i = 1; i < 1000000; i <<= 1)
+    /*
+     * with one thread count, every operation runs once, with shared
+     * operand, as spread is the same address for single thread
+     */
+
+    for (c = 0; c != 5; ++c)
     {
-        sprintf(param, "-i%lu", i);
-        argv = str2opts(param, &argc);
-        opts_parse(argc, argv);
+        atomic_conf(c, 1, &op, &place, &k);
+        mt_fail(op == (int)c);
+        mt_fail(place == ATOMIC_PLACE_SHARED);
+        mt_fail(k == 0);
+    }
 
-        mt_fail(opts.block_size == 16 * 1024);
-        mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-        mt_fail(opts.num_intvl == i);
-        mt_fail(opts.method == METHOD_MEMCPY);
-        mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    /*
+     * with more threads, single thread run is followed by shared and
+     * spread ones with more threads
+     */
 
-    #if HAVE_CLOCK_GETTIME
-        mt_fail(opts.clock == CLK_REALTIME);
-    #else
-        mt_fail(opts.clock == CLK_CLOCK);
-    #endif
+    atomic_conf(3, 2, &op, &place, &k);
+    mt_fail(op == 1);
+    mt_fail(place == ATOMIC_PLACE_SHARED);
+    mt_fail(k == 0);
 
-        opts_free(argc, argv);
-    }
+    atomic_conf(4, 2, &op, &place, &k);
+    mt_fail(op == 1);
+    mt_fail(place == ATOMIC_PLACE_SHARED);
+    mt_fail(k == 1);
+
+    atomic_conf(5, 2, &op, &place, &k);
+    mt_fail(op == 1);
+    mt_fail(place == ATOMIC_PLACE_SPREAD);
+    mt_fail(k == 1);
 }
 
+#endif
 
-/* ==========================================================================
-   ========================================================================== */
 
+/* ==== zero.c tests ======================================================== */
 
-void opts_parse_opt_i_invalid_param(void)
+
+#if ZERO_HAVE_NT
+
+void zero_nt_bounds(void)
 {
-    char  **argv;
-    int     argc;
+    unsigned char  buf[256 + 64];
+    size_t         off;
+    size_t         n;
+    size_t         i;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("-ianan", &argc);
+    /*
+     * every alignment of start, and lengths that end in the middle of
+     * 16 byte store, before first aligned address, and past 64 byte loop
+     * must clear exactly 'n' bytes
+     */
 
-    mt_fail(opts_parse(argc, argv) == -2);
+    for (off = 0; off != 32; ++off)
+    {
+        for (n = 0; n != 200; ++n)
+        {
+            memset(buf, 0xaa, sizeof(buf));
+            zero_nt(buf + off, n);
+
+            for (i = 0; i != sizeof(buf); ++i)
+            {
+                if (i >= off && i < off + n)
+                {
+                    mt_assert(buf[i] == 0);
+                }
+                else
+                {
+                    mt_assert(buf[i] == 0xaa);
+                }
+            }
+        }
+    }
+}
 
-    opts_free(argc, argv);
+#endif
 
 
-    argv = str2opts("-i5K", &argc);
+/* ==== grow.c tests ======================================================== */
 
-    mt_fail(opts_parse(argc, argv) == -2);
 
+void grow_copy_accounting(void)
+{
+    struct grow_result  r;
+    char              **argv;
+    int                 argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * memcpy copies every size before doubling, 4k + 8k + ... + 4m, and
+     * new buffer is always at new address
+     */
+
+    argv = str2opts("-b8M", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_fail(grow_run(GROW_COPY, &r) == 0);
+    mt_fail(r.copied == opts.block_size - 4096);
+    mt_fail(r.moved == r.copied);
+    mt_fail(r.moves == 11);
+    mt_fail(r.peak >= opts.block_size / 2);
     opts_free(argc, argv);
+}
 
 
-    argv = str2opts("-i", &argc);
+/* ==========================================================================
+   ========================================================================== */
 
-    mt_fail(opts_parse(argc, argv) == -2);
 
+void grow_realloc_accounting(void)
+{
+    struct grow_result  r;
+    char              **argv;
+    int                 argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * realloc may move with or without copying, so only moves are known,
+     * and copied is left at zero for report to print as unknown, peak
+     * is not checked as heap may reuse pages freed by earlier tests
+     */
+
+    argv = str2opts("-b8M", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_fail(grow_run(GROW_REALLOC, &r) == 0);
+    mt_fail(r.copied == 0);
+    mt_fail(r.moves <= 11);
+    mt_fail(r.moved <= opts.block_size - 4096);
     opts_free(argc, argv);
 }
 
 
+#if HAVE_MREMAP
+
 /* ==========================================================================
    ========================================================================== */
 
 
-void opts_parse_opt_m(void)
+void grow_mremap_accounting(void)
 {
-    char **argv;
-    int    argc;
+    struct grow_result  r;
+    char              **argv;
+    int                 argc;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("-mmemcpy", &argc);
-    opts_parse(argc, argv);
+    /*
+     * mremap never copies, even when it moves buffer
+     */
 
-    mt_fail(opts.block_size == 16 * 1024);
-    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-    mt_fail(opts.num_intvl == 10);
-    mt_fail(opts.method == METHOD_MEMCPY);
-    mt_fail(opts.cache_size == 1 * 1024 * 1024);
+    argv = str2opts("-b8M", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_fail(grow_run(GROW_MREMAP, &r) == 0);
+    mt_fail(r.copied == 0);
+    mt_fail(r.moves <= 11);
+    mt_fail(r.moved <= opts.block_size - 4096);
+    mt_fail(r.peak >= opts.block_size / 2);
+    opts_free(argc, argv);
+}
 
-#if HAVE_CLOCK_GETTIME
-    mt_fail(opts.clock == CLK_REALTIME);
-#else
-    mt_fail(opts.clock == CLK_CLOCK);
 #endif
 
-    opts_free(argc, argv);
 
+/* ==== overlap.c tests ===================================================== */
 
-    argv = str2opts("-mbbb", &argc);
-    opts_parse(argc, argv);
 
-    mt_fail(opts.block_size == 16 * 1024);
-    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-    mt_fail(opts.num_intvl == 10);
-    mt_fail(opts.method == METHOD_BBB);
-    mt_fail(opts.cache_size == 1 * 1024 * 1024);
+void overlap_tile_small(void)
+{
+    /*
+     * two tiles must fit in block, tile is multiple of step and never
+     * bigger than OVERLAP_TILE
+     */
 
-#if HAVE_CLOCK_GETTIME
-    mt_fail(opts.clock == CLK_REALTIME);
-#else
-    mt_fail(opts.clock == CLK_CLOCK);
-#endif
-    opts_free(argc, argv);
+    mt_fail(overlap_tile(2 * OVERLAP_STEP - 1) == 0);
+    mt_fail(overlap_tile(2 * OVERLAP_STEP) == OVERLAP_STEP);
+    mt_fail(overlap_tile(5 * OVERLAP_STEP) == 2 * OVERLAP_STEP);
+    mt_fail(overlap_tile(2 * OVERLAP_TILE - 1) ==
+            OVERLAP_TILE - OVERLAP_STEP);
+    mt_fail(overlap_tile(2 * OVERLAP_TILE) == OVERLAP_TILE);
+    mt_fail(overlap_tile(64 * OVERLAP_TILE) == OVERLAP_TILE);
 }
 
 
@@ -1437,85 +4522,153 @@ void opts_parse_opt_m(void)
    ========================================================================== */
 
 
-void opts_parse_opt_m_invalid_param(void)
+void overlap_pass_same_acc(void)
 {
-    char  **argv;
-    int     argc;
+    unsigned char   *src;
+    unsigned char   *work[2];
+    unsigned long    acc;
+    size_t           block;
+    size_t           tile;
+    size_t           ntiles;
+    size_t           i;
+    char           **argv;
+    int              argc;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("-manan", &argc);
+    argv = str2opts("-b1024", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
 
-    mt_fail(opts_parse(argc, argv) == -2);
+    /*
+     * blocks smaller and bigger than two whole tiles, every mode that
+     * computes must see the same words in the same order
+     */
 
-    opts_free(argc, argv);
+    for (block = 5 * OVERLAP_STEP; block <= 5 * OVERLAP_TILE; block *= 4)
+    {
+        tile = overlap_tile(block);
+        ntiles = block / tile;
+        mt_assert(src = malloc(ntiles * tile));
+        mt_assert(work[0] = malloc(tile));
+        mt_assert(work[1] = malloc(tile));
 
+        for (i = 0; i != ntiles * tile; ++i)
+        {
+            src[i] = (unsigned char)(i * 7 + i / 251);
+        }
 
-    argv = str2opts("-m", &argc);
+        memset(work[0], 0, tile);
+        memset(work[1], 0, tile);
+        acc = overlap_pass(OVERLAP_DIRECT, src, work, tile, ntiles, 3);
+
+        mt_fail(overlap_pass(OVERLAP_SERIAL, src, work, tile, ntiles, 3) ==
+                acc);
+        mt_fail(overlap_pass(OVERLAP_PIPELINE, src, work, tile, ntiles,
+                             3) == acc);
+#if OVERLAP_HAVE_PREFETCH
+        mt_fail(overlap_pass(OVERLAP_PREFETCH, src, work, tile, ntiles,
+                             3) == acc);
+#endif
 
-    mt_fail(opts_parse(argc, argv) == -2);
+        /*
+         * copy doesn't compute, so it leaves acc alone
+         */
+
+        mt_fail(overlap_pass(OVERLAP_COPY, src, work, tile, ntiles, 3) ==
+                3);
+
+        free(src);
+        free(work[0]);
+        free(work[1]);
+    }
 
     opts_free(argc, argv);
 }
 
 
-/* ==========================================================================
-   ========================================================================== */
+/* ==== alloc.c tests ======================================================= */
 
 
-void opts_parse_opt_c(void)
+#if HAVE_PTHREAD_H
+
+void alloc_two_threads(void)
 {
-    char **argv;
-    int    argc;
+    static const char  *names[] = { "libc", "arena", "pool" };
+    struct hist         lat[ALLOC_OP_MAX];
+    double              rate;
+    long                live;
+    size_t              a;
+    int                 op;
+    char              **argv;
+    int                 argc;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("-cclock", &argc);
-    opts_parse(argc, argv);
-
-    mt_fail(opts.block_size == 16 * 1024);
-    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-    mt_fail(opts.num_intvl == 10);
-    mt_fail(opts.method == METHOD_MEMCPY);
-    mt_fail(opts.cache_size == 1 * 1024 * 1024);
-    mt_fail(opts.clock == CLK_CLOCK);
+    /*
+     * blocks are freed by the other thread, for libc, and every block
+     * that was allocated must be handed back to allocator, each thread
+     * allocates batch of 1024 blocks with malloc and calloc every round
+     */
 
-    opts_free(argc, argv);
+    argv = str2opts("-b256 -r64K -n2", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
 
-#if HAVE_CLOCK_GETTIME
-    argv = str2opts("-crealtime", &argc);
-    opts_parse(argc, argv);
+    for (a = 0; a != sizeof(names) / sizeof(*names); ++a)
+    {
+        mt_fail(alloc_interval(names[a], 2, lat, &live) == 0);
+        mt_fail(live == 0);
+        mt_fail(lat[ALLOC_MALLOC].n == 2 * 2 * 1024);
+        mt_fail(lat[ALLOC_CALLOC].n == lat[ALLOC_MALLOC].n);
+        mt_fail(lat[ALLOC_FREE].n == 2 * lat[ALLOC_MALLOC].n);
 
-    mt_fail(opts.block_size == 16 * 1024);
-    mt_fail(opts.report_intvl == 100 * 1024 * 1024);
-    mt_fail(opts.num_intvl == 10);
-    mt_fail(opts.method == METHOD_MEMCPY);
-    mt_fail(opts.cache_size == 1 * 1024 * 1024);
-    mt_fail(opts.clock == CLK_REALTIME);
+        for (op = 0; op != ALLOC_OP_MAX; ++op)
+        {
+            rate = alloc_rate(&lat[op]);
+            mt_fail(rate == rate && rate - rate == 0);
+            mt_fail(rate >= 0);
+        }
+    }
 
+    mt_fail(alloc_interval("none", 2, lat, &live) == -1);
     opts_free(argc, argv);
-#endif
 }
 
+#endif
+
 
-/* ==========================================================================
-   ========================================================================== */
+/* ==== neighbour.c tests =================================================== */
 
 
-void opts_parse_opt_c_invalid_param(void)
+#if HAVE_FORK
+
+void neighbour_start_stop(void)
 {
+    pid_t   pids[2];
+    int     i;
     char  **argv;
     int     argc;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    argv = str2opts("-canan", &argc);
-
-    mt_fail(opts_parse(argc, argv) == -2);
+    /*
+     * both aggressors run when start returns, and are reaped by stop, so
+     * there is no child left to wait for
+     */
 
-    opts_free(argc, argv);
+    argv = str2opts("-n2", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_assert(neighbour_start(FLOOD_READ, pids, NULL, 0) == 0);
 
+    for (i = 0; i != 2; ++i)
+    {
+        mt_fail(pids[i] > 0);
+        mt_fail(waitpid(pids[i], NULL, WNOHANG) == 0);
+    }
 
-    argv = str2opts("-c", &argc);
+    neighbour_stop(pids, 2);
 
-    mt_fail(opts_parse(argc, argv) == -2);
+    for (i = 0; i != 2; ++i)
+    {
+        mt_fail(waitpid(pids[i], NULL, WNOHANG) == -1);
+        mt_fail(errno == ECHILD);
+    }
 
     opts_free(argc, argv);
 }
@@ -1525,79 +4678,104 @@ void opts_parse_opt_c_invalid_param(void)
    ========================================================================== */
 
 
-void opts_parse_unknown_opts(void)
+void neighbour_pin_any(void)
 {
-    static const char *allowed_opts = "hvbrlimc";
-
+    int     cpus[4];
     char  **argv;
     int     argc;
-    char    c;
-    char    param[16];
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (c = 'a'; c != 'z' + 1; ++c)
-    {
-        sprintf(param, "-%c", c);
-        argv = str2opts(param, &argc);
-
-        if (is_in_array(c, allowed_opts))
-        {
-            mt_fail(opts_parse(argc, argv) != -3);
-        }
-        else
-        {
-            mt_fail(opts_parse(argc, argv) == -3);
-        }
+    /*
+     * without -a other, nothing is pinned and no cpu is given away
+     */
 
-        opts_free(argc, argv);
-    }
+    argv = str2opts("-b1024", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_fail(opts.place == PLACE_ANY);
+    mt_fail(neighbour_pin(cpus, 4) == 0);
+    opts_free(argc, argv);
 }
 
+#endif
 
-/* ==========================================================================
-   ========================================================================== */
 
+/* ==== bench.c tests ======================================================= */
 
-void opts_parse_syntax_error(void)
+
+void bench_latency_pcts(void)
 {
-    char  **argv;
-    int     argc;
-    char    c;
-    char    param[16];
+    struct bench_lat  l;
+    struct hist       h;
+    unsigned long     v;
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    for (c = 'A'; c != 'Z' + 1; ++c)
-    {
-        sprintf(param, "-%c", c);
-        argv = str2opts(param, &argc);
+    /*
+     * 1000 fast copies and one slow, slow one is only seen by max
+     */
 
-        mt_fail(opts_parse(argc, argv) == -1);
+    hist_reset(&h);
 
-        opts_free(argc, argv);
+    for (v = 1; v <= 1000; ++v)
+    {
+        hist_add(&h, v);
     }
 
-    argv = str2opts("banan", &argc);
-    mt_fail(opts_parse(argc, argv) == -1);
-    opts_free(argc, argv);
-
-    argv = str2opts("-", &argc);
-    mt_fail(opts_parse(argc, argv) == -1);
-    opts_free(argc, argv);
-
-    argv = str2opts("--", &argc);
-    mt_fail(opts_parse(argc, argv) == -1);
-    opts_free(argc, argv);
-
-    argv = str2opts("-10b", &argc);
-    mt_fail(opts_parse(argc, argv) == -1);
-    opts_free(argc, argv);
+    hist_add(&h, 100000);
+    bench_latency(&h, &l);
+
+    mt_fail(l.min == 1);
+    mt_fail(l.min == hist_pct(&h, 0));
+    mt_fail(l.p50 == hist_pct(&h, 50));
+    mt_fail(l.p90 == hist_pct(&h, 90));
+    mt_fail(l.p99 == hist_pct(&h, 99));
+    mt_fail(l.p999 == hist_pct(&h, 99.9));
+    mt_fail(l.max == hist_pct(&h, 100));
+    mt_fail(l.max == 100000);
+    mt_fail(l.p50 >= 500 - 500 / HIST_SUB && l.p50 <= 500 + 500 / HIST_SUB);
+    mt_fail(l.p999 <= 1000 + 1000 / HIST_SUB);
 }
 
 
-/* ==== bench.c tests ======================================================= */
+/* ==========================================================================
+   ========================================================================== */
 
 
+void bench_short(void)
+{
+    unsigned char  *dst;
+    unsigned char  *src;
+    unsigned char  *f1;
+    unsigned char  *f2;
+    char          **argv;
+    int             argc;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /*
+     * short run of every method must finish, and copy the block
+     */
 
+    argv = str2opts("-b1024 -r16384 -i2 -l4096", &argc);
+    mt_assert(opts_parse(argc, argv) == 0);
+    mt_assert(dst = calloc(1, opts.block_size));
+    mt_assert(src = malloc(opts.block_size));
+    mt_assert(f1 = malloc(opts.cache_size));
+    mt_assert(f2 = calloc(1, opts.cache_size));
+    memset(src, 0x5a, opts.block_size);
+
+    mt_fail(bench(dst, src, f1, f2) == 0);
+    mt_fail(memcmp(dst, src, opts.block_size) == 0);
+
+    opts.method = METHOD_BBB;
+    memset(dst, 0, opts.block_size);
+    mt_fail(bench(dst, src, f1, f2) == 0);
+    mt_fail(memcmp(dst, src, opts.block_size) == 0);
+
+    free(f2);
+    free(f1);
+    free(src);
+    free(dst);
+    opts_free(argc, argv);
+}
 
 
 /* ==== Public functions ==================================================== */
@@ -1606,7 +4784,6 @@ void opts_parse_syntax_error(void)
 int main(void)
 {
 #if HAVE_CLOCK_GETTIME
-    mt_run(ts_new_realtime);
     mt_run(ts_realtime);
     mt_run(ts_reset_realtime);
     mt_run(ts_add_diff_realtime_single_simple);
@@ -1616,14 +4793,116 @@ int main(void)
     mt_run(ts_add_diff_realtime_multi_combined);
 #endif
 
-    mt_run(ts_new_clock);
     mt_run(ts_clock);
     mt_run(ts_reset_clock);
 
     mt_run(ts_add_diff_clock_single);
     mt_run(ts_add_diff_clock_multi);
+    mt_run(ts_add_diff_overhead);
+    mt_run(ts_init_overhead);
+
+#if HAVE_CLOCK_GETTIME && HAVE_DECL_CLOCK_MONOTONIC_RAW
+    mt_run(ts_monotonic_raw);
+    mt_run(ts_add_diff_monotonic_raw);
+#endif
+
+#if HAVE_RDTSC
+    mt_run(ts_tsc);
+    mt_run(ts_add_diff_tsc);
+    mt_run(ts2cycles_clock);
+#endif
 
     mt_run(bytes2jedec_test);
+    mt_run(ts2ns_clock);
+    mt_run(ts2sec_test);
+#if HAVE_CLOCK_GETTIME
+    mt_run(ts2ns_realtime);
+#endif
+    mt_run(rnd_test);
+    mt_run(rss_grows);
+#if HAVE_PTHREAD_H
+    mt_run(barrier_resize_releases);
+#endif
+
+#if HAVE_CLFLUSH
+    mt_run(flush_has_fallback);
+    mt_run(flush_line_fallback);
+#endif
+
+    mt_run(hist_exact_small_values);
+    mt_run(hist_pct_accuracy);
+    mt_run(hist_big_values);
+    mt_run(hist_merge_test);
+    mt_run(hist_empty);
+
+    mt_run(arena_alloc_aligned);
+    mt_run(arena_realloc_in_place);
+    mt_run(arena_reset_reuses_memory);
+    mt_run(pool_alloc_free);
+    mt_run(pool_tiny_and_huge_objects);
+
+    mt_run(stats_basic);
+    mt_run(stats_many_samples);
+    mt_run(stats_outliers);
+    mt_run(stats_outliers_zero_mad);
+    mt_run(stats_outliers_all);
+    mt_run(stats_empty);
+    mt_run(stats_done_test);
+    mt_run(stats_next_test);
+    mt_run(stats_welch_test);
+    mt_run(base_csv);
+    mt_run(base_json);
+    mt_run(base_no_file);
+    mt_run(out_escape_test);
+    mt_run(roofline_flops_test);
+    mt_run(roofline_sweep_test);
+    mt_run(small_shuffle_counts);
+#if ZERO_HAVE_NT
+    mt_run(zero_nt_bounds);
+#endif
+#if HAVE_PTHREAD_H
+    mt_run(loaded_chain_cycle);
+    mt_run(scale_counts_test);
+    mt_run(scale_knee_test);
+    mt_run(scale_max_threads_test);
+    mt_run(pcopy_chunks_sweep);
+    mt_run(pcopy_run_covers_block);
+#endif
+#if HAVE_PTHREAD_H && HAVE_SYNC_BUILTINS
+    mt_run(atomic_operand_place);
+    mt_run(atomic_conf_single);
+#endif
+    mt_run(grow_copy_accounting);
+    mt_run(grow_realloc_accounting);
+#if HAVE_MREMAP
+    mt_run(grow_mremap_accounting);
+#endif
+    mt_run(overlap_tile_small);
+    mt_run(overlap_pass_same_acc);
+#if HAVE_PTHREAD_H
+    mt_run(alloc_two_threads);
+#endif
+#if HAVE_FORK
+    mt_run(neighbour_start_stop);
+    mt_run(neighbour_pin_any);
+#endif
+    mt_run(bench_latency_pcts);
+    mt_run(bench_short);
+    mt_run(pmc_none);
+    mt_run(pmc_sw_events);
+    mt_run(freq_fallback);
+    mt_run(freq_interval);
+    mt_run(noise_faults);
+    mt_run(quiet_irqs_parse);
+    mt_run(quiet_pick_test);
+    mt_run(replay_parse_valid);
+    mt_run(replay_parse_invalid);
+    mt_run(tracehist_bucket_bounds);
+    mt_run(tracehist_bucket_all_bits);
+    mt_run(tracehist_bucket_monotonic);
+    mt_run(tracehist_align_classes);
+    mt_run(tracehist_line_replay);
+
     mt_run(opts_parse_default_all);
 
     mt_run(opts_parse_opt_b_bytes);
@@ -1650,6 +4929,31 @@ int main(void)
     mt_run(opts_parse_opt_i_invalid_param);
     mt_run(opts_parse_opt_m_invalid_param);
     mt_run(opts_parse_opt_c_invalid_param);
+    mt_run(opts_parse_opt_t);
+    mt_run(opts_parse_opt_t_invalid_param);
+    mt_run(opts_parse_opt_d);
+    mt_run(opts_parse_opt_d_invalid_param);
+    mt_run(opts_parse_opt_n);
+    mt_run(opts_parse_opt_n_invalid_param);
+    mt_run(opts_parse_opt_w);
+    mt_run(opts_parse_opt_w_invalid_param);
+    mt_run(opts_parse_opt_e_p);
+    mt_run(opts_parse_opt_e_p_invalid_param);
+    mt_run(opts_parse_opt_o);
+    mt_run(opts_parse_opt_o_invalid_param);
+    mt_run(opts_parse_opt_f_g);
+    mt_run(opts_parse_opt_f_g_invalid_param);
+    mt_run(opts_parse_opt_k);
+    mt_run(opts_parse_opt_k_invalid_param);
+    mt_run(opts_parse_opt_s);
+    mt_run(opts_parse_opt_s_invalid_param);
+    mt_run(opts_parse_opt_q);
+    mt_run(opts_parse_opt_a);
+    mt_run(opts_parse_opt_a_invalid_param);
+    mt_run(opts_parse_opt_x);
+    mt_run(opts_parse_opt_x_invalid_param);
+    mt_run(opts_parse_opt_u);
+    mt_run(opts_parse_opt_u_invalid_param);
     mt_run(opts_parse_unknown_opts);
     mt_run(opts_parse_syntax_error);
 
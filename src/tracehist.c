@@ -0,0 +1,125 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "tracehist.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+
+/* ==== Public functions ==================================================== */
+
+
+/* ==========================================================================
+    returns bucket of size 'n'.  Sizes above MEMTRACE_OCTAVES powers of  2
+    go to the last bucket.  Shifts never reach width of size_t, so it  is
+    safe with 32 bit size_t too.
+   ========================================================================== */
+
+
+size_t tracehist_bucket
+(
+    size_t  n     /* size of call */
+)
+{
+    size_t  o;    /* highest set bit of 'n' */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (n <= MEMTRACE_EXACT)
+    {
+        return n;
+    }
+
+    for (o = 8; o + 1 < sizeof(n) * CHAR_BIT && (n >> (o + 1)); ++o);
+
+    if (o - 8 >= MEMTRACE_OCTAVES)
+    {
+        return MEMTRACE_SIZES - 1;
+    }
+
+    return MEMTRACE_EXACT + 1 + (o - 8) * MEMTRACE_SUBS +
+        ((n >> (o - 2)) & (MEMTRACE_SUBS - 1));
+}
+
+
+/* ==========================================================================
+    returns smallest size that falls into bucket 'b', first bucket  above
+    exact ones starts at 256, which itself is counted in exact bucket
+   ========================================================================== */
+
+
+double tracehist_size
+(
+    size_t  b     /* bucket */
+)
+{
+    double  step; /* width of sub-buckets of bucket's power of 2 */
+    size_t  o;    /* power of 2 of bucket, counted from 256 */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (b <= MEMTRACE_EXACT)
+    {
+        return (double)b;
+    }
+
+    /*
+     * power of 2 can be bigger than long, so it's computed in double
+     */
+
+    b -= MEMTRACE_EXACT + 1;
+
+    for (o = 0, step = 256 / MEMTRACE_SUBS; o != b / MEMTRACE_SUBS; ++o)
+    {
+        step *= 2;
+    }
+
+    return step * (MEMTRACE_SUBS + b % MEMTRACE_SUBS);
+}
+
+
+/* ==========================================================================
+    returns alignment class of 'addr', 0 for 1 byte alignment, up to 6 for
+    cache line
+   ========================================================================== */
+
+
+int tracehist_align
+(
+    size_t  addr  /* address of call */
+)
+{
+    int     a;    /* alignment class */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for (a = 0; a != MEMTRACE_ALIGNS - 1 && !(addr & ((size_t)1 << a)); ++a);
+    return a;
+}
+
+
+/* ==========================================================================
+    formats histogram line of bucket 'b' and alignment class 'a' into 'buf'
+    of TRACEHIST_LINE_MAX bytes, as size, alignment and count, which  is
+    what memperf -treplay -u reads
+
+    returns:
+            length of line
+   ========================================================================== */
+
+
+int tracehist_line
+(
+    char           *buf,   /* line will be stored here */
+    size_t          b,     /* size bucket */
+    int             a,     /* alignment class */
+    unsigned long   count  /* number of calls */
+)
+{
+    return sprintf(buf, "%.0f %d %lu\n", tracehist_size(b), 1 << a, count);
+}
@@ -0,0 +1,30 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef TRACEHIST_H
+#define TRACEHIST_H 1
+
+#include <stddef.h>
+
+#include "memtrace.h"
+
+/*
+ * max length of histogram line, with nul
+ */
+
+#define TRACEHIST_LINE_MAX 64
+
+/*
+ * size and alignment buckets of memtrace.so, apart from the library, so
+ * tests can use them without interposing memcpy on themselves
+ */
+
+size_t tracehist_bucket(size_t n);
+double tracehist_size(size_t b);
+int tracehist_align(size_t addr);
+int tracehist_line(char *buf, size_t b, int a, unsigned long count);
+
+#endif
@@ -8,212 +8,412 @@
 
 
 #include "config.h"
-#include "opts.h"
-#include "utils.h"
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 #include <time.h>
 
+#if HAVE_SYSCONF
+#include <unistd.h>
+#endif
 
-/* ==== Public functions ==================================================== */
+#if HAVE_RDTSC && HAVE_CPUID_H
+#include <cpuid.h>
+#endif
+
+#include "opts.h"
+#include "utils.h"
+
+
+/* ==== Public variables ==================================================== */
+
+
+/*
+ * function reading selected clock, and time it takes to read it, both set
+ * in ts_init()
+ */
+
+tick_t (*ts_read)(void);
+tick_t ts_overhead;
+
+
+/* ==== Private variables =================================================== */
+
+
+/*
+ * number of ticks per second of clock selected in ts_init()
+ */
+
+static double ts_hz;
+
+#if HAVE_RDTSC
+
+/*
+ * frequency of time stamp counter calibrated in ts_init()
+ */
+
+static double tsc_hz;
+
+#endif
+
+
+/* ==== Private functions =================================================== */
+
+
+#if HAVE_CLOCK_GETTIME
 
 
 /* ==========================================================================
-    function returns timestamp in 'tm' location depending on the  clock  set
-    in opts.h.  If clock option set doesn't match passed 'tm' object,  (like
-    clock_t for CLK_CLOCK) behaviour is undefinied
+    posix doesn't require CLOCK_MONOTONIC to be implemented, so we use
+    CLOCK_REALTIME which may ocasionally jump forward or backward, but tests
+    are relatively short, so this should not be a problem.
    ========================================================================== */
 
 
-void ts
-(
-    void  *tm  /* pointer to time where to store current timestamp */
-)
+static tick_t ts_read_realtime(void)
 {
-#if HAVE_CLOCK_GETTIME
-    if (opts.clock == CLK_REALTIME)
-    {
-        /*
-         * posix doesn't require CLOCK_MONOTONIC to be implemented, so we use
-         * CLOCK_REALTIME which may ocasionally jump forward or backward, but
-         * tests are relatively short, so this should not be a problem.
-         */
+    struct timespec  t;  /* current time */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-        clock_gettime(CLOCK_REALTIME, tm);
-    }
-    else
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (tick_t)t.tv_sec * 1000000000l + t.tv_nsec;
+}
+
+
+#if HAVE_DECL_CLOCK_MONOTONIC_RAW
+
+
+/* ==========================================================================
+    linux specific clock, that is neither stepped nor slewed by ntp, so  it
+    never jumps
+   ========================================================================== */
+
+
+static tick_t ts_read_monotonic_raw(void)
+{
+    struct timespec  t;  /* current time */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+    return (tick_t)t.tv_sec * 1000000000l + t.tv_nsec;
+}
+
+#endif
 #endif
 
-    if (opts.clock == CLK_CLOCK)
-    {
-        *(clock_t *)tm = clock();
-    }
-    else
-    {
-        assert(0 && "clock not supported, should not get here");
-    }
+
+/* ==========================================================================
+    C89 processor time, available everywhere
+   ========================================================================== */
+
+
+static tick_t ts_read_clock(void)
+{
+    return clock();
 }
 
 
+#if HAVE_RDTSC
+
+
 /* ==========================================================================
-    creates new object for timestamp, returned pointer should be  passed  to
-    free() when it is no longer needed
+    returns current value of time stamp counter.  Reading is serialized with
+    lfence, so instructions from before and after the read do not  leak  in
+    or out of the measured region.  rdtscp waits for previous  instructions
+    on its own, so only following ones need to be fenced
    ========================================================================== */
 
 
-void *ts_new(void)
+static tick_t ts_read_rdtscp(void)
 {
-#if HAVE_CLOCK_GETTIME
-    if (opts.clock == CLK_REALTIME)
+    unsigned  lo;  /* lower 32 bits of counter */
+    unsigned  hi;  /* upper 32 bits of counter */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    __asm__ __volatile__("rdtscp; lfence"
+                         : "=a"(lo), "=d"(hi) :: "ecx", "memory");
+
+    return (tick_t)hi << 32 | lo;
+}
+
+
+/* ==========================================================================
+    same as ts_read_rdtscp() but for cpus that lack rdtscp instruction
+   ========================================================================== */
+
+
+static tick_t ts_read_rdtsc(void)
+{
+    unsigned  lo;  /* lower 32 bits of counter */
+    unsigned  hi;  /* upper 32 bits of counter */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    __asm__ __volatile__("lfence; rdtsc; lfence"
+                         : "=a"(lo), "=d"(hi) :: "memory");
+
+    return (tick_t)hi << 32 | lo;
+}
+
+
+/* ==========================================================================
+    returns function that should be used to read tsc on this cpu
+   ========================================================================== */
+
+
+static tick_t (*tsc_reader(void))(void)
+{
+#if HAVE_CPUID_H
+    unsigned int  a;  /* eax register */
+    unsigned int  b;  /* ebx register */
+    unsigned int  c;  /* ecx register */
+    unsigned int  d;  /* edx register */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (__get_cpuid(0x80000001, &a, &b, &c, &d) && (d & (1u << 27)))
     {
-        return malloc(sizeof(struct timespec));
+        return ts_read_rdtscp;
     }
-    else
 #endif
 
-    if (opts.clock == CLK_CLOCK)
-    {
-        return malloc(sizeof(clock_t));
-    }
-    else
-    {
-        assert(0 && "clock not suppoert, should not get here");
-    }
+    return ts_read_rdtsc;
 }
 
 
 /* ==========================================================================
-    sets pointer to zero value.  Check ts() for more  information  regarding
-    undefinied behaviour that may occur
+    returns number of seconds, from some unspecified point in time, read from
+    the best clock other than tsc.  Used only to calibrate tsc
    ========================================================================== */
 
 
-void ts_reset
-(
-    void  *tm  /* time object to zero */
-)
+static double tsc_ref_sec(void)
 {
 #if HAVE_CLOCK_GETTIME
-    if (opts.clock == CLK_REALTIME)
-    {
-        memset(tm, 0, sizeof(struct timespec));
-    }
-    else
+#if HAVE_DECL_CLOCK_MONOTONIC_RAW
+    return ts_read_monotonic_raw() / 1000000000.0;
+#else
+    return ts_read_realtime() / 1000000000.0;
+#endif
+#else
+    return (double)ts_read_clock() / CLOCKS_PER_SEC;
 #endif
+}
 
-    if (opts.clock == CLK_CLOCK)
-    {
-        memset(tm, 0, sizeof(clock_t));
-    }
-    else
-    {
-        assert(0 && "clock not supported, should not get here");
-    }
+
+/* ==========================================================================
+    calibrates frequency of the time stamp counter against other clock  by
+    spinning for TSC_CALIBRATE_SEC, so tsc ticks can be converted to  time,
+    and time of other clocks to cycles
+   ========================================================================== */
+
+
+static void tsc_calibrate(void)
+{
+    tick_t    (*read)(void);  /* function reading tsc */
+    tick_t      c0;           /* tsc at the beginning of calibration */
+    tick_t      c1;           /* tsc at the end of calibration */
+    double      t0;           /* time at the beginning of calibration */
+    double      t1;           /* time at the end of calibration */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    read = tsc_reader();
+    t0 = tsc_ref_sec();
+    c0 = read();
+
+    while ((t1 = tsc_ref_sec()) - t0 < TSC_CALIBRATE_SEC);
+
+    c1 = read();
+    tsc_hz = (c1 - c0) / (t1 - t0);
 }
 
+#endif
+
 
 /* ==========================================================================
-    function adds difference between 'finish' and 'start' to  'tm'.   Simply
-    put it is tm  +=  finish  -  start;  Check  ts()  for  more  information
-    regarding undefinied behaviour that may occur
+    converts 'tm' into units of clock running with 'hz' frequency.  Bigger
+    unit is always divided by, or multiplied with, the ratio  of  the  two
+    clocks, so conversion between clocks with integer ratio (like ns to us)
+    is exact
    ========================================================================== */
 
 
-void ts_add_diff
+static double ts_conv
 (
-    void  *tm,     /* finish - start will be added here */
-    void  *start,  /* first point in time to differate */
-    void  *finish  /* second point in time to differate */
+    const struct ts  *tm,  /* time to convert */
+    double            hz   /* frequency of clock to convert to */
 )
 {
-#if HAVE_CLOCK_GETTIME
-    if (opts.clock == CLK_REALTIME)
+    if (ts_hz >= hz)
     {
-        struct timespec   d;  /* diff between finish and start */
-        struct timespec  *t;  /* tm pointer */
-        struct timespec  *s;  /* start pointer */
-        struct timespec  *f;  /* finish pointer */
-        /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+        return tm->t / (ts_hz / hz);
+    }
 
-        t = tm;
-        s = start;
-        f = finish;
+    return tm->t * (hz / ts_hz);
+}
 
-        if ((f->tv_nsec - s->tv_nsec) < 0)
-        {
-            d.tv_sec = f->tv_sec - s->tv_sec - 1;
-            d.tv_nsec = f->tv_nsec - s->tv_nsec + 1000000000;
-        }
-        else
-        {
-            d.tv_sec = f->tv_sec - s->tv_sec;
-            d.tv_nsec = f->tv_nsec - s->tv_nsec;
-        }
 
-        t->tv_sec += d.tv_sec;
-        t->tv_nsec += d.tv_nsec;
+/* ==== Public functions ==================================================== */
 
-        if (t->tv_nsec >= 1000000000)
-        {
-            t->tv_sec += 1;
-            t->tv_nsec -= 1000000000;
-        }
+
+/* ==========================================================================
+    initializes clock set in opts.h, must be called before any  other  ts
+    function and each time opts.clock changes.  Function that  reads  the
+    clock is selected here, so measuring does not branch  on  clock  type.
+    Then time it takes to read the clock  is  measured,  so  it  can  be
+    subtracted from every measured period.  On first call tsc frequency is
+    calibrated as well.
+   ========================================================================== */
+
+
+void ts_init(void)
+{
+    struct ts  start;   /* first of back to back timestamps */
+    struct ts  finish;  /* second of back to back timestamps */
+    tick_t     min;     /* lowest difference between timestamps */
+    int        i;       /* loop iterator */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+#if HAVE_RDTSC
+    if (tsc_hz == 0)
+    {
+        tsc_calibrate();
     }
-    else
 #endif
 
-    if (opts.clock == CLK_CLOCK)
+    switch (opts.clock)
     {
-        clock_t  *t;  /* tm pointer */
-        clock_t  *s;  /* start pointer */
-        clock_t  *f;  /* finish pointer */
-        /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+#if HAVE_CLOCK_GETTIME
+    case CLK_REALTIME:
+        ts_read = ts_read_realtime;
+        ts_hz = 1000000000.0;
+        break;
+
+#if HAVE_DECL_CLOCK_MONOTONIC_RAW
+    case CLK_MONOTONIC_RAW:
+        ts_read = ts_read_monotonic_raw;
+        ts_hz = 1000000000.0;
+        break;
+#endif
+#endif
+
+#if HAVE_RDTSC
+    case CLK_TSC:
+        ts_read = tsc_reader();
+        ts_hz = tsc_hz;
+        break;
+#endif
 
-        t = tm;
-        s = start;
-        f = finish;
+    case CLK_CLOCK:
+        ts_read = ts_read_clock;
+        ts_hz = CLOCKS_PER_SEC;
+        break;
 
-        *t += *f -*s;
+    default:
+        assert(0 && "clock not supported, should not get here");
     }
-    else
+
+    /*
+     * take lowest value, as this is the real cost of reading the  clock,
+     * anything above that is noise, like interrupts or cache misses
+     */
+
+    ts_overhead = 0;
+    min = (tick_t)-1;
+
+    for (i = 0; i != TS_OVERHEAD_LOOPS; ++i)
     {
-        assert(0 && "clock not supported, should not get here");
+        ts(&start);
+        ts(&finish);
+
+        if (finish.t - start.t < min)
+        {
+            min = finish.t - start.t;
+        }
     }
+
+    ts_overhead = min;
 }
 
 
 /* ==========================================================================
-    function converts 'tm' object into microseconds.  Check  ts()  for  more
-    information   regarding   undefinied   behaviour    that    may    occur
+    returns calibrated frequency of time stamp counter in Hz, or 0 when tsc
+    is not available
+   ========================================================================== */
+
+
+double ts_tsc_hz(void)
+{
+#if HAVE_RDTSC
+    return tsc_hz;
+#else
+    return 0;
+#endif
+}
+
+
+/* ==========================================================================
+    function converts 'tm' object into microseconds
    ========================================================================== */
 
 
 unsigned long ts2us
 (
-    void  *tm  /* time to convert to microseconds */
+    const struct ts  *tm  /* time to convert to microseconds */
 )
 {
-#if HAVE_CLOCK_GETTIME
-    if (opts.clock == CLK_REALTIME)
-    {
-        struct timespec  *t = tm;
-        /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+    return ts_conv(tm, 1000000.0);
+}
 
-        return t->tv_sec * 1000000l + t->tv_nsec / 1000;
-    }
-    else
-#endif
 
-    if (opts.clock == CLK_CLOCK)
-    {
-        return *(clock_t *)tm / (CLOCKS_PER_SEC / 1000000);
-    }
-    else
+/* ==========================================================================
+    function converts 'tm' object into nanoseconds.  Value is  meant  to  be
+    used for short periods, as it will overflow after about 4 seconds  when
+    long is 32 bit wide.
+   ========================================================================== */
+
+
+unsigned long ts2ns
+(
+    const struct ts  *tm  /* time to convert to nanoseconds */
+)
+{
+    return ts_conv(tm, 1000000000.0);
+}
+
+
+/* ==========================================================================
+    function converts 'tm' object into seconds, without rounding to  any
+    unit and without overflow, to be used when exact time is needed
+   ========================================================================== */
+
+
+double ts2sec
+(
+    const struct ts  *tm  /* time to convert to seconds */
+)
+{
+    return ts_conv(tm, 1.0);
+}
+
+
+/* ==========================================================================
+    function converts 'tm' object into number of tsc cycles.  For clocks
+    other than tsc, time is converted using calibrated tsc frequency.  0 is
+    returned when tsc is not available.
+   ========================================================================== */
+
+
+double ts2cycles
+(
+    const struct ts  *tm  /* time to convert to cycles */
+)
+{
+    if (ts_tsc_hz() == 0)
     {
-        assert(0 && "clock not supported, should not get here");
+        return 0;
     }
+
+    return ts_conv(tm, ts_tsc_hz());
 }
 
 
@@ -254,3 +454,185 @@ void bytes2jedec
         jedec->pre = 'G';
     }
 }
+
+
+/* ==========================================================================
+    returns next pseudo random 32 bit number from xorshift  generator  with
+    state kept in 'seed'.  Unlike rand() this is safe to  call  from  many
+    threads at once, as long as each thread uses its own 'seed'.   'seed'
+    must not be 0.
+   ========================================================================== */
+
+
+unsigned long rnd
+(
+    unsigned long  *seed  /* state of the generator */
+)
+{
+    unsigned long   x;    /* generated number */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    x = *seed & 0xfffffffful;
+    x ^= (x << 13) & 0xfffffffful;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xfffffffful;
+
+    return *seed = x;
+}
+
+
+/* ==========================================================================
+    returns number of bytes of memory that process currently has  resident
+    in ram.  Value is read from /proc, so 0 is returned on systems that  do
+    not provide it.
+   ========================================================================== */
+
+
+size_t rss(void)
+{
+#if HAVE_SYSCONF
+    FILE           *f;      /* /proc/self/statm file */
+    unsigned long   pages;  /* resident pages */
+    int             n;      /* number of fields read */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if ((f = fopen("/proc/self/statm", "r")) == NULL)
+    {
+        return 0;
+    }
+
+    n = fscanf(f, "%*s %lu", &pages);
+    fclose(f);
+
+    if (n != 1)
+    {
+        return 0;
+    }
+
+    return pages * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+
+#if HAVE_PTHREAD_H
+
+
+/* ==========================================================================
+    initializes barrier 'b' that will be released when 'count' threads call
+    barrier_wait() on it.  pthread_barrier is an optional  part  of  posix,
+    so we roll our own on top of mutex and condition variable.
+
+    returns:
+             0      barrier initialized
+            -1      mutex or condition couldn't be created
+   ========================================================================== */
+
+
+int barrier_init
+(
+    struct barrier  *b,     /* barrier to initialize */
+    unsigned         count  /* number of threads to wait for */
+)
+{
+    if (pthread_mutex_init(&b->lock, NULL) != 0)
+    {
+        return -1;
+    }
+
+    if (pthread_cond_init(&b->cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&b->lock);
+        return -1;
+    }
+
+    b->count = count;
+    b->waiting = 0;
+    b->phase = 0;
+
+    return 0;
+}
+
+
+/* ==========================================================================
+    blocks calling thread until 'count' threads are waiting on barrier 'b'
+   ========================================================================== */
+
+
+void barrier_wait
+(
+    struct barrier  *b      /* barrier to wait on */
+)
+{
+    unsigned long    phase; /* phase of barrier at the moment we came in */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    pthread_mutex_lock(&b->lock);
+    phase = b->phase;
+
+    if (++b->waiting == b->count)
+    {
+        /*
+         * we are the last one, release everybody and start new phase, so
+         * barrier can be reused right away
+         */
+
+        b->waiting = 0;
+        ++b->phase;
+        pthread_cond_broadcast(&b->cond);
+    }
+    else
+    {
+        while (phase == b->phase)
+        {
+            pthread_cond_wait(&b->cond, &b->lock);
+        }
+    }
+
+    pthread_mutex_unlock(&b->lock);
+}
+
+
+/* ==========================================================================
+    changes number of threads barrier 'b' waits for to 'count', releasing
+    threads that already wait, when there are that many of them.  Used to
+    let go threads that wait for others, which couldn't be started.
+   ========================================================================== */
+
+
+void barrier_resize
+(
+    struct barrier  *b,     /* barrier to resize */
+    unsigned         count  /* new number of threads to wait for */
+)
+{
+    pthread_mutex_lock(&b->lock);
+    b->count = count;
+
+    if (b->waiting && b->waiting >= b->count)
+    {
+        b->waiting = 0;
+        ++b->phase;
+        pthread_cond_broadcast(&b->cond);
+    }
+
+    pthread_mutex_unlock(&b->lock);
+}
+
+
+/* ==========================================================================
+    releases resources allocated by barrier_init()
+   ========================================================================== */
+
+
+void barrier_destroy
+(
+    struct barrier  *b  /* barrier to destroy */
+)
+{
+    pthread_cond_destroy(&b->cond);
+    pthread_mutex_destroy(&b->lock);
+}
+
+#endif
@@ -9,10 +9,18 @@
 
 #include <stddef.h>
 
+#include "config.h"
+
+#if HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #ifdef TESTS
 /*
- * disable prints when unit testing
+ * disable prints when unit testing, stdio.h must be seen before that, or
+ * its declarations would be broken, when utils.h comes first
  */
+#include <stdio.h>
 #define fprintf (void)sizeof
 #define printf (void)sizeof
 #endif
@@ -23,11 +31,114 @@ struct jedec
     char pre;
 };
 
-void ts(void *tm);
-void ts_add_diff(void *taken, void *start, void *finish);
-void *ts_new(void);
-void ts_reset(void *tm);
-unsigned long ts2us(void *tm);
+#if HAVE_PTHREAD_H
+struct barrier
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned count;
+    unsigned waiting;
+    unsigned long phase;
+};
+#endif
+
+/*
+ * time spent on calibrating tsc frequency on startup
+ */
+
+#define TSC_CALIBRATE_SEC 0.05
+
+/*
+ * number of back to back timestamps taken to find out how much time
+ * reading the clock takes
+ */
+
+#define TS_OVERHEAD_LOOPS 1000
+
+/*
+ * clock ticks, nanoseconds for clock_gettime() clocks,  cycles  for  tsc
+ * and clock_t units for clock()
+ */
+
+#if HAVE_UNSIGNED_LONG_LONG_INT
+typedef unsigned long long tick_t;
+#else
+typedef unsigned long tick_t;
+#endif
+
+struct ts
+{
+    tick_t t;
+};
+
+extern tick_t (*ts_read)(void);
+extern tick_t ts_overhead;
+
+void ts_init(void);
+double ts_tsc_hz(void);
+unsigned long ts2us(const struct ts *tm);
+unsigned long ts2ns(const struct ts *tm);
+double ts2sec(const struct ts *tm);
+double ts2cycles(const struct ts *tm);
 void bytes2jedec(float bytes, struct jedec *jedec);
+unsigned long rnd(unsigned long *seed);
+size_t rss(void);
+
+#if HAVE_PTHREAD_H
+int barrier_init(struct barrier *b, unsigned count);
+void barrier_wait(struct barrier *b);
+void barrier_resize(struct barrier *b, unsigned count);
+void barrier_destroy(struct barrier *b);
+#endif
+
+
+/* ==========================================================================
+    stores current timestamp in 'tm', using clock selected in ts_init()
+   ========================================================================== */
+
+
+static inline void ts
+(
+    struct ts  *tm  /* pointer to time where to store current timestamp */
+)
+{
+    tm->t = ts_read();
+}
+
+
+/* ==========================================================================
+    sets 'tm' to zero value
+   ========================================================================== */
+
+
+static inline void ts_reset
+(
+    struct ts  *tm  /* time object to zero */
+)
+{
+    tm->t = 0;
+}
+
+
+/* ==========================================================================
+    adds difference between 'finish' and 'start' to 'tm', minus  time  it
+    takes to read the clock itself.  Simply put it is tm += finish - start
+    - ts_overhead, where difference never goes below 0.
+   ========================================================================== */
+
+
+static inline void ts_add_diff
+(
+    struct ts        *tm,     /* finish - start will be added here */
+    const struct ts  *start,  /* first point in time to differate */
+    const struct ts  *finish  /* second point in time to differate */
+)
+{
+    tick_t            d;      /* difference between finish and start */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    d = finish->t - start->t;
+    tm->t += d > ts_overhead ? d - ts_overhead : 0;
+}
 
 #endif
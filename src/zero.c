@@ -0,0 +1,500 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+/* ==== Include files ======================================================= */
+
+
+#include "config.h"
+#include "zero.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_MMAP && HAVE_MADVISE
+#include <sys/mman.h>
+#define ZERO_HAVE_DONTNEED 1
+#endif
+
+#if ZERO_HAVE_NT
+#include <emmintrin.h>
+#endif
+
+#include "opts.h"
+#include "out.h"
+#include "stats.h"
+#include "utils.h"
+
+
+/* ==== Private declarations ================================================ */
+
+
+enum zero_method
+{
+    ZERO_MEMSET,
+    ZERO_CALLOC_FRESH,
+    ZERO_CALLOC_REUSED,
+#if ZERO_HAVE_DONTNEED
+    ZERO_DONTNEED,
+#endif
+#if ZERO_HAVE_NT
+    ZERO_NT,
+#endif
+#if HAVE_EXPLICIT_BZERO
+    ZERO_EXPLICIT_BZERO,
+#endif
+    ZERO_MAX
+};
+
+struct zero_buf
+{
+    unsigned char  *buf;    /* buffer that is cleared in place */
+    unsigned char  *map;    /* page aligned mapping for madvise */
+    void           *f1;     /* first pointer used to flush cpu cache */
+    void           *f2;     /* second pointer used to flush cpu cache */
+    void          **fresh;  /* blocks kept alive so calloc gets fresh memory */
+};
+
+
+/* ==== Private variables =================================================== */
+
+
+static const char *method_names[ZERO_MAX] =
+{
+    "memset",
+    "calloc-fresh",
+    "calloc-reused",
+#if ZERO_HAVE_DONTNEED
+    "dontneed",
+#endif
+#if ZERO_HAVE_NT
+    "nt-store",
+#endif
+#if HAVE_EXPLICIT_BZERO
+    "explicit_bzero"
+#endif
+};
+
+
+/* ==== Private functions =================================================== */
+
+
+/* ==========================================================================
+    clears block of memory with method 'm' and returns  pointer  to  cleared
+    memory.  'j' is index of current loop, needed to keep  fresh  callocs
+    alive.
+
+    returns:
+            pointer to zeroed block, or NULL when system is out of memory
+            or pages couldn't be dropped
+   ========================================================================== */
+
+
+static unsigned char *zero_do
+(
+    enum zero_method   m,   /* method to clear memory with */
+    struct zero_buf   *zb,  /* buffers for the test */
+    size_t             j    /* index of current loop */
+)
+{
+    unsigned char     *p;   /* cleared memory */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    switch (m)
+    {
+    case ZERO_MEMSET:
+        memset(zb->buf, 0, opts.block_size);
+        return zb->buf;
+
+    case ZERO_CALLOC_FRESH:
+        return zb->fresh[j] = calloc(1, opts.block_size);
+
+    case ZERO_CALLOC_REUSED:
+        return calloc(1, opts.block_size);
+
+#if ZERO_HAVE_DONTNEED
+    case ZERO_DONTNEED:
+        /*
+         * pages are dropped, and will be refaulted as zero pages on first
+         * access, so real cost is paid on first use
+         */
+
+        if (madvise(zb->map, opts.block_size, MADV_DONTNEED) != 0)
+        {
+            fprintf(stderr, "Couldn't drop pages with madvise: %s\n",
+                    strerror(errno));
+            return NULL;
+        }
+
+        return zb->map;
+#endif
+
+#if ZERO_HAVE_NT
+    case ZERO_NT:
+        zero_nt(zb->buf, opts.block_size);
+        return zb->buf;
+#endif
+
+#if HAVE_EXPLICIT_BZERO
+    case ZERO_EXPLICIT_BZERO:
+        explicit_bzero(zb->buf, opts.block_size);
+        return zb->buf;
+#endif
+
+    default:
+        p = NULL;
+    }
+
+    return p;
+}
+
+
+/* ==========================================================================
+    clears block of memory with method 'm', opts.report_intvl  bytes  in
+    total, and then writes to the whole block as its next user would.  Time
+    spent on both is stored in 'zero' and 'use'.
+
+    returns:
+             0      test finished
+            -1      system is out of memory
+   ========================================================================== */
+
+
+static int zero_run
+(
+    enum zero_method   m,       /* method to clear memory with */
+    struct zero_buf   *zb,      /* buffers for the test */
+    struct ts         *zero,    /* time spent on clearing memory */
+    struct ts         *use,     /* time spent on first use of memory */
+    size_t            *loops    /* number of cleared blocks */
+)
+{
+    unsigned char     *p;       /* cleared memory */
+    struct ts          start;   /* timer indicating operation start */
+    struct ts          finish;  /* timer indicating operation finish */
+    size_t             j;       /* iterator for loop */
+    int                rc;      /* return code */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    ts_reset(zero);
+    ts_reset(use);
+
+    *loops = opts.report_intvl / opts.block_size;
+    *loops = *loops ? *loops : 1;
+
+    if (m == ZERO_CALLOC_FRESH &&
+        (zb->fresh = calloc(*loops, sizeof(*zb->fresh))) == NULL)
+    {
+        goto error;
+    }
+
+    for (j = 0; j != *loops; ++j)
+    {
+        if (opts.cache_size)
+        {
+            memcpy(zb->f1, zb->f2, opts.cache_size);
+        }
+
+        ts(&start);
+        p = zero_do(m, zb, j);
+        ts(&finish);
+        ts_add_diff(zero, &start, &finish);
+
+        if (p == NULL)
+        {
+            goto error;
+        }
+
+        ts(&start);
+        memset(p, 0x5a, opts.block_size);
+        ts(&finish);
+        ts_add_diff(use, &start, &finish);
+
+        if (m == ZERO_CALLOC_REUSED)
+        {
+            /*
+             * next calloc will most likely get the same, now dirty, block
+             */
+
+            free(p);
+        }
+    }
+
+    rc = 0;
+
+error:
+    if (zb->fresh)
+    {
+        for (j = 0; j != *loops; ++j)
+        {
+            free(zb->fresh[j]);
+        }
+
+        free(zb->fresh);
+        zb->fresh = NULL;
+    }
+
+    return rc;
+}
+
+
+/* ==========================================================================
+    prints result of clearing memory with method 'm'
+   ========================================================================== */
+
+
+static void zero_report
+(
+    unsigned long     intvl,    /* interval number, counted from 1 */
+    enum zero_method  m,        /* method that was used */
+    struct ts        *zero,     /* time spent on clearing memory */
+    struct ts        *use,      /* time spent on first use of memory */
+    size_t            loops     /* number of cleared blocks */
+)
+{
+    unsigned long     zero_us;  /* time spent on clearing in us */
+    unsigned long     use_us;   /* time spent on first use in us */
+    float             bps;      /* bytes cleared per second */
+    struct jedec      jd_bps;   /* bytes per second in jedec format */
+    double            bytes;    /* bytes cleared */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if (!out_text())
+    {
+        bytes = (double)loops * opts.block_size;
+
+        out_record("interval");
+        out_ulong("interval", intvl);
+        out_str("name", method_names[m]);
+        out_double("bytes", bytes);
+        out_double("zero_ns", ts2sec(zero) * 1000000000.0);
+        out_double("use_ns", ts2sec(use) * 1000000000.0);
+        out_double("total_ns", (ts2sec(zero) + ts2sec(use)) * 1000000000.0);
+        out_double("rate_bps", ts2sec(zero) > 0 ? bytes / ts2sec(zero) : 0);
+        out_record_end();
+        return;
+    }
+
+    zero_us = ts2us(zero);
+    use_us = ts2us(use);
+
+    bps = (float)loops * opts.block_size / (zero_us ? zero_us : 1);
+    bps *= 1000000;
+    bytes2jedec(bps, &jd_bps);
+
+    printf("%-14s zero %7lu us, rate %5lu %cB/s, first use %7lu us, "
+           "total %7lu us\n",
+           method_names[m],
+           zero_us,
+           jd_bps.val,
+           jd_bps.pre,
+           use_us,
+           zero_us + use_us);
+}
+
+
+/* ==== Public functions ==================================================== */
+
+
+#if ZERO_HAVE_NT
+
+
+/* ==========================================================================
+    clears 'n' bytes of 'dst' with non temporal stores,  which  bypass  cpu
+    cache and go straight to memory.  Unaligned head and tail  are  cleared
+    with ordinary memset.
+   ========================================================================== */
+
+
+void zero_nt
+(
+    void           *dst,   /* memory to clear */
+    size_t          n      /* number of bytes to clear */
+)
+{
+    unsigned char  *p;     /* current position in dst */
+    size_t          head;  /* bytes before first 16 byte aligned address */
+    __m128i         z;     /* 16 bytes of zeros */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    p = dst;
+    z = _mm_setzero_si128();
+    head = (16 - ((size_t)p & 15)) & 15;
+    head = head < n ? head : n;
+
+    memset(p, 0, head);
+    p += head;
+    n -= head;
+
+    for (; n >= 64; n -= 64, p += 64)
+    {
+        _mm_stream_si128((__m128i *)p, z);
+        _mm_stream_si128((__m128i *)(p + 16), z);
+        _mm_stream_si128((__m128i *)(p + 32), z);
+        _mm_stream_si128((__m128i *)(p + 48), z);
+    }
+
+    for (; n >= 16; n -= 16, p += 16)
+    {
+        _mm_stream_si128((__m128i *)p, z);
+    }
+
+    /*
+     * non temporal stores are weakly ordered, make sure they are visible
+     * before anyone uses cleared memory
+     */
+
+    _mm_sfence();
+    memset(p, 0, n);
+}
+
+#endif
+
+
+/* ==========================================================================
+    compares ways of clearing memory - memset, calloc of fresh  and  reused
+    memory, dropping pages with MADV_DONTNEED, non temporal stores and
+    explicit_bzero.  Cleared block is then written as whole, as  its  next
+    user would, because some methods (like MADV_DONTNEED) defer real  cost
+    until memory is touched.
+
+    returns:
+             0      benchmark finished
+            -1      couldn't allocate memory
+   ========================================================================== */
+
+
+int zero_bench(void)
+{
+    struct zero_buf  zb;             /* buffers for the test */
+    struct ts        zero;           /* time spent on clearing memory */
+    struct ts        use;            /* time spent on first use */
+    struct stats     total[ZERO_MAX];/* total time of each method in us */
+    double           sec;            /* total time of method in seconds */
+    size_t           loops;          /* number of cleared blocks */
+    unsigned long    i;              /* iterator for loop */
+    int              m;              /* iterator for loop */
+    int              rc;             /* return code */
+    struct jedec     jd_block_size;  /* block size in jedec format */
+    struct jedec     jd_intvl;       /* report interval in jedec format */
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    rc = -1;
+    memset(&zb, 0, sizeof(zb));
+
+    for (m = 0; m != ZERO_MAX; ++m)
+    {
+        stats_init(&total[m]);
+    }
+
+    zb.buf = malloc(opts.block_size);
+    zb.f1 = malloc(opts.cache_size);
+    zb.f2 = malloc(opts.cache_size);
+
+#if ZERO_HAVE_DONTNEED
+    zb.map = mmap(NULL, opts.block_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    zb.map = (void *)zb.map == MAP_FAILED ? NULL : zb.map;
+
+    if (zb.map == NULL)
+    {
+        fprintf(stderr, "Couldn't map requested memory block\n");
+        goto error;
+    }
+#endif
+
+    if (zb.buf == NULL || zb.f1 == NULL || zb.f2 == NULL)
+    {
+        fprintf(stderr, "Couldn't allocate requested memory block\n");
+        goto error;
+    }
+
+    /*
+     * make sure buffers are really allocated and dirty, so first  method
+     * does not pay for page faults
+     */
+
+    memset(zb.buf, 0x5a, opts.block_size);
+
+    if (zb.map)
+    {
+        memset(zb.map, 0x5a, opts.block_size);
+    }
+
+    bytes2jedec(opts.block_size, &jd_block_size);
+    bytes2jedec(opts.report_intvl, &jd_intvl);
+
+    if (out_text())
+    {
+        printf("block size: %lu %cB, report every %lu %cB, iterations %lu\n",
+               jd_block_size.val,
+               jd_block_size.pre,
+               jd_intvl.val,
+               jd_intvl.pre,
+               opts.num_intvl);
+    }
+
+    for (i = 0; stats_next(total, ZERO_MAX, i); ++i)
+    {
+        for (m = 0; m != ZERO_MAX; ++m)
+        {
+            if (zero_run(m, &zb, &zero, &use, &loops) != 0)
+            {
+                fprintf(stderr, "Couldn't clear memory with %s\n",
+                        method_names[m]);
+                goto error;
+            }
+
+            if (stats_warmup(i))
+            {
+                continue;
+            }
+
+            zero_report(i - opts.warmup + 1, m, &zero, &use, loops);
+
+            sec = ts2sec(&zero) + ts2sec(&use);
+
+            if (stats_add(&total[m], sec * 1000000) != 0)
+            {
+                fprintf(stderr, "Couldn't allocate memory for samples\n");
+                goto error;
+            }
+        }
+    }
+
+    if (out_text())
+    {
+        printf("summary of total time\n");
+    }
+
+    for (m = 0; m != ZERO_MAX; ++m)
+    {
+        stats_compute(&total[m], opts.outlier_mad);
+        stats_print(&total[m], method_names[m], "us");
+    }
+
+    rc = 0;
+
+error:
+    for (m = 0; m != ZERO_MAX; ++m)
+    {
+        stats_destroy(&total[m]);
+    }
+
+#if ZERO_HAVE_DONTNEED
+    if (zb.map)
+    {
+        munmap(zb.map, opts.block_size);
+    }
+#endif
+
+    free(zb.buf);
+    free(zb.f1);
+    free(zb.f2);
+    return rc;
+}
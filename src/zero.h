@@ -0,0 +1,25 @@
+/* ==========================================================================
+    Licensed under BSD 2clause license. See LICENSE file for more information
+    Author: Michał Łyszczek <michal.lyszczek@bofc.pl>
+   ========================================================================== */
+
+
+#ifndef ZERO_H
+#define ZERO_H 1
+
+#include <stddef.h>
+
+#include "config.h"
+
+/*
+ * non temporal stores are done with sse2 intrinsics
+ */
+
+#if HAVE_EMMINTRIN_H && defined(__SSE2__)
+#define ZERO_HAVE_NT 1
+void zero_nt(void *dst, size_t n);
+#endif
+
+int zero_bench(void);
+
+#endif